@@ -2,6 +2,7 @@
 #include <WiFi.h>
 #include <OneButton.h>
 #include "esp_bt.h"
+#include "esp_system.h"
 #include "app_state.h"
 #include "config.h"
 #include "button.h"
@@ -11,24 +12,41 @@
 #include "display_task.h"
 #include "timing_constants.h"
 #include "face_manager.h"
-
-#if SCREENSHOT_MODE
-  #include "screenshot_server.h"
-#else
+#include "frame_scheduler.h"
+#include "metrics.h"
+#include "screenshot_server.h"
+#include "serial_console.h"
+#include "clock_source.h"
+#include "system_monitor.h"
+#include "telemetry.h"
+#include "task_trace.h"
+#include "log_ring.h"
+#include "input_latency.h"
+#include "render_watchdog.h"
+#include "energy.h"
+#include "boot_profile.h"
+
+#if !SCREENSHOT_MODE
   #include "startup_screen.h"
   #include "ntp.h"
   #include "wifi_monitor.h"
+
+  static FrameScheduler frameScheduler;
 #endif
 
 void setup() {
+  bootProfileMark(BOOT_PHASE_STARTUP);
+
   // Initialize serial communication
-  Serial.begin(115200);
+  Serial.begin(SERIAL_BAUD);
   delay(1500);
+  bootProfileMark(BOOT_PHASE_SERIAL);
 
   // Disable BT device.
   btStop();
   esp_bt_controller_disable();
   esp_bt_controller_deinit();
+  bootProfileMark(BOOT_PHASE_BLUETOOTH);
 
   Serial.println("\n\nESP32 WiFi Clock");
   Serial.println("=================");
@@ -36,6 +54,21 @@ void setup() {
   Serial.print("Flash chip size: "); Serial.println(ESP.getFlashChipSize());
   Serial.print("Free heap:       "); Serial.println(ESP.getFreeHeap());
   Serial.println("=================");
+  logRingTaskStart();
+  #if TASK_TRACE
+    if (taskTraceSetup()) {
+      Serial.println("Task trace ring allocated.");
+    }
+    else {
+      Serial.println("Not enough heap for the task trace ring, tracing disabled.");
+    }
+  #endif
+  energySetup();
+  systemMonitorTaskStart();
+  telemetryEvent("boot", esp_reset_reason());
+  renderWatchdogSetup();
+  renderWatchdogTaskStart();
+  bootProfileMark(BOOT_PHASE_SERVICES);
 
   // Initialize TFT display.
   displaySetup();
@@ -44,6 +77,7 @@ void setup() {
   TFT_display.setRotation(0);
   TFT_display.fillScreen(COLOR_BACKGROUND);
   giveDisplayMutex();
+  bootProfileMark(BOOT_PHASE_DISPLAY);
 
   #if !SCREENSHOT_MODE
     startupScreenTaskStart();
@@ -59,7 +93,7 @@ void setup() {
       },
       #if !DISABLE_ENCODER
         []() {
-          Serial.println("On single clock");
+          logDebug("On single click");
           faceManagerOnSingleClick();
         },
         [](int delta) {
@@ -70,6 +104,7 @@ void setup() {
         nullptr
       #endif
     );
+    bootProfileMark(BOOT_PHASE_UI);
   #endif
 
   #if SCREENSHOT_MODE
@@ -77,14 +112,25 @@ void setup() {
     Serial.print("SCREENSHOT MODE ACTIVE");
     Serial.print("=================");
     loadConfig();
+    bootProfileMark(BOOT_PHASE_CONFIG);
+    struct tm screenshotTime = {};
+    screenshotTime.tm_year = SCREENSHOT_YEAR - 1900;
+    screenshotTime.tm_mon  = SCREENSHOT_MONTH - 1;
+    screenshotTime.tm_mday = SCREENSHOT_DAY;
+    screenshotTime.tm_hour = SCREENSHOT_HOUR;
+    screenshotTime.tm_min  = SCREENSHOT_MIN;
+    clockSourceSetFixed((int64_t)mktime(&screenshotTime) * 1000000LL);
     if (!connectWifi()) {
       Serial.println("WiFi connection failed!");
     }
+    bootProfileMark(BOOT_PHASE_WIFI);
 
     setAppState(CONNECTED_SYNCED);
     Serial.print("Largest free contiguous block: ");
     Serial.println(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
-    screenshotServerSetup();
+    screenshotServerTaskStart();
+    serialConsoleTaskStart();
+    bootProfileMark(BOOT_PHASE_TASKS);
   #else
     if (!loadConfig()) {
       setAppState(NOT_CONFIGURED);
@@ -92,51 +138,78 @@ void setup() {
       displayWifiSetupInstructions();
       giveDisplayMutex();
     }
-
-    // Initialize WiFi configuration (web portal)
-    if (!connectWifi()) {
-      takeDisplayMutex();
-      displayWifiError();
-      giveDisplayMutex();
-      delay(30000UL);
-      ESP.restart();
+    bootProfileMark(BOOT_PHASE_CONFIG);
+
+    // Initialize WiFi configuration (web portal). When the portal has to be
+    // opened it runs in the background and the clock starts anyway.
+    bool wifiConnected = connectWifi();
+    bootProfileMark(BOOT_PHASE_WIFI);
+    if (wifiConnected) {
+      // Initialize NTP sync.
+      syncTimeWithNTP([](const char* msg) {
+        setStatusText(msg, 3000);
+        Serial.print("NTP status: ");
+        Serial.println(msg);
+      });
+      bootProfileMark(BOOT_PHASE_NTP);
+    }
+    else {
+      Serial.println("WiFi not connected, continuing without it.");
     }
-
-    // Initialize NTP sync.
-    syncTimeWithNTP([](const char* msg) {
-      setStatusText(msg, 3000);
-      Serial.print("NTP status: ");
-      Serial.println(msg);
-    });
 
     // Start NTP Sync  task.
     wifiMonitorTaskStart();
     ntpTaskStart();
+    screenshotServerTaskStart();
+    serialConsoleTaskStart();
+    bootProfileMark(BOOT_PHASE_TASKS);
   #endif
 
   #if SCREENSHOT_MODE
     setClockFace(getInstance(SCREENSHOT_FACE));
   #else
     setConfiguredClockFace();
+    frameSchedulerInit(frameScheduler);
   #endif
 
+  bootProfileMark(BOOT_PHASE_FACE);
+
   setInited();
+  bootProfileSave();
   Serial.println("Setup complete!");
 }
 
 void loop() {
   #if SCREENSHOT_MODE
+    takeDisplayMutex();
     redrawDisplay();
-    screenshotServerLoop();
+    giveDisplayMutex();
   #else
-    static unsigned long lastRedraw = 0;
-    unsigned long currentMillis = millis();
-
-    if (currentMillis - lastRedraw >= BLINK_INTERVAL_MS) {
-      lastRedraw = currentMillis;
+    if (inputLatencyAwaitingFrame()) {
+      frameSchedulerRequest(frameScheduler);
+    }
+    int64_t wallUs = getDisplayWallClockUs();
+    FrameReason reason = frameSchedulerPoll(frameScheduler, clockSourceMillis(), wallUs);
+
+    // State changes are drawn right away instead of waiting for the next tick.
+    // The flag is consumed on every pass, so a change already covered by a
+    // scheduled frame does not cause a second redraw.
+    bool stateChanged = consumeAppStateChange();
+    if (reason != FRAME_NONE || stateChanged) {
       takeDisplayMutex();
       redrawDisplay();
       giveDisplayMutex();
+
+      if (reason == FRAME_SECOND) {
+        // How late after the true second boundary the frame started and ended.
+        uint32_t startLateUs = (uint32_t)(wallUs % 1000000LL);
+        uint32_t doneLateUs = (uint32_t)(getDisplayWallClockUs() - (wallUs - startLateUs));
+        metricsSet(METRIC_FRAME_ALIGN_LAST_US, startLateUs);
+        metricsSet(METRIC_FRAME_DONE_LAST_US, doneLateUs);
+        if (startLateUs > metricsGet(METRIC_FRAME_ALIGN_MAX_US)) {
+          metricsSet(METRIC_FRAME_ALIGN_MAX_US, startLateUs);
+        }
+      }
     }
 
     buttonLoop();
@@ -2,6 +2,9 @@
 #include "Arduino.h"
 #include "app_state.h"
 #include "timing_constants.h"
+#include "clock_source.h"
+#include "task_trace.h"
+#include "log_ring.h"
 
 #define STATUS_TEXT_MAX_LENGTH 32
 
@@ -17,6 +20,7 @@ static char statusText[STATUS_TEXT_MAX_LENGTH] = "";
 static unsigned long statusTextExpiry = 0;
 
 static std::atomic<bool> ntpSyncRequested(false);
+static std::atomic<bool> appStateChanged(false);
 
 void setInited() {
   inited = true;
@@ -31,8 +35,9 @@ void setAppState(AppState newState) {
   if (newState != currentState) {
     previousState = currentState;
     currentState  = newState;
-    Serial.print("AppState changed: ");
-    Serial.println(currentState);
+    appStateChanged = true;
+    TASK_TRACE_INSTANT("app_state", newState);
+    logInfo("AppState changed: %d", currentState);
   }
 }
 
@@ -45,12 +50,12 @@ AppState getPreviousState() {
 }
 
 void updateLastNtpSync() {
-  lastNtpSync = millis();
+  lastNtpSync = clockSourceMillis();
   Serial.println("NTP sync timestamp updated.");
 }
 
 void updateLastReconnectAttempt() {
-  lastReconnectAttempt = millis();
+  lastReconnectAttempt = clockSourceMillis();
   Serial.println("Reconnect attempt timestamp updated.");
 }
 
@@ -58,20 +63,20 @@ bool isNtpSyncDue() {
   if (lastNtpSync == 0) {
     return true;
   }
-  return (millis() - lastNtpSync) >= NTP_SYNC_INTERVAL_MS;
+  return (clockSourceMillis() - lastNtpSync) >= NTP_SYNC_INTERVAL_MS;
 }
 
 bool isReconnectDue() {
   if (lastReconnectAttempt == 0) {
     return true;
   }
-  return (millis() - lastReconnectAttempt) >= RECONNECT_INTERVAL_MS;
+  return (clockSourceMillis() - lastReconnectAttempt) >= RECONNECT_INTERVAL_MS;
 }
 
 void setStatusText(const char* text, unsigned long timeoutMs) {
   strncpy(statusText, text, STATUS_TEXT_MAX_LENGTH - 1);
   statusText[STATUS_TEXT_MAX_LENGTH - 1] = '\0';
-  statusTextExpiry = millis() + timeoutMs;
+  statusTextExpiry = clockSourceMillis() + timeoutMs;
   Serial.print("StatusText set: ");
   Serial.println(statusText);
 }
@@ -84,7 +89,7 @@ bool isStatusTextActive() {
   if (strlen(statusText) == 0) {
     return false;
   }
-  if (millis() >= statusTextExpiry) {
+  if (clockSourceMillis() >= statusTextExpiry) {
     statusText[0] = '\0';
     return false;
   }
@@ -93,7 +98,7 @@ bool isStatusTextActive() {
 
 void requestNtpSync() {
   ntpSyncRequested = true;
-  Serial.println("NTP sync requested.");
+  logInfo("NTP sync requested.");
 }
 
 bool isNtpSyncRequested() {
@@ -103,3 +108,7 @@ bool isNtpSyncRequested() {
 void clearNtpSyncRequest() {
   ntpSyncRequested = false;
 }
+
+bool consumeAppStateChange() {
+  return appStateChanged.exchange(false);
+}
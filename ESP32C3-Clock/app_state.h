@@ -35,4 +35,7 @@ void requestNtpSync();
 bool isNtpSyncRequested();
 void clearNtpSyncRequest();
 
+// Consumer (core 1 - render loop): returns true once after each state change.
+bool consumeAppStateChange();
+
 #endif
@@ -0,0 +1,205 @@
+#include <Preferences.h>
+#include "Arduino.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "boot_profile.h"
+
+static const uint32_t HISTORY_VERSION = 1;
+
+static const char* PHASE_NAMES[BOOT_PHASE_COUNT] = {
+  "startup",
+  "serial",
+  "bluetooth",
+  "services",
+  "display",
+  "ui",
+  "config",
+  "wifi",
+  "ntp",
+  "tasks",
+  "face",
+};
+
+// Indexed by esp_reset_reason_t.
+static const char* RESET_REASON_NAMES[] = {
+  "unknown",
+  "poweron",
+  "ext",
+  "sw",
+  "panic",
+  "int_wdt",
+  "task_wdt",
+  "wdt",
+  "deepsleep",
+  "brownout",
+  "sdio",
+};
+static const int RESET_REASON_COUNT = sizeof(RESET_REASON_NAMES) / sizeof(RESET_REASON_NAMES[0]);
+
+struct BootRecord {
+  uint32_t sequence;
+  uint32_t resetReason;
+  uint32_t phaseEndMs[BOOT_PHASE_COUNT];  // 0 for phases that did not run
+};
+
+// Stored in NVS as one blob.
+struct BootHistory {
+  uint32_t version;
+  uint32_t count;
+  BootRecord records[BOOT_PROFILE_HISTORY];  // newest first
+};
+
+static BootRecord current;
+static BootHistory history;
+// Set once the history is loaded; the web server and the console may ask
+// before setup() has finished.
+static volatile bool historyReady = false;
+
+static const char* resetReasonName(uint32_t reason) {
+  return reason < (uint32_t)RESET_REASON_COUNT ? RESET_REASON_NAMES[reason] : "unknown";
+}
+
+void bootProfileMark(BootPhase phase) {
+  uint32_t ms = (uint32_t)(esp_timer_get_time() / 1000);
+  current.phaseEndMs[phase] = ms > 0 ? ms : 1;
+}
+
+// Duration of each phase since the end of the last phase before it that
+// ran; 0 for phases that did not run.
+static void phaseDurations(const BootRecord& record, uint32_t* durations, uint32_t* totalMs) {
+  uint32_t lastEndMs = 0;
+  for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+    uint32_t endMs = record.phaseEndMs[i];
+    durations[i] = endMs != 0 ? endMs - lastEndMs : 0;
+    if (endMs != 0) {
+      lastEndMs = endMs;
+    }
+  }
+  *totalMs = lastEndMs;
+}
+
+void bootProfileSave() {
+  current.resetReason = (uint32_t)esp_reset_reason();
+
+  Preferences preferences;
+  preferences.begin("boot-profile", false);
+  if (
+    preferences.getBytes("history", &history, sizeof(history)) != sizeof(history)
+    || history.version != HISTORY_VERSION
+    || history.count > BOOT_PROFILE_HISTORY
+  ) {
+    memset(&history, 0, sizeof(history));
+    history.version = HISTORY_VERSION;
+  }
+  current.sequence = history.count > 0 ? history.records[0].sequence + 1 : 1;
+  memmove(&history.records[1], &history.records[0], sizeof(BootRecord) * (BOOT_PROFILE_HISTORY - 1));
+  history.records[0] = current;
+  if (history.count < BOOT_PROFILE_HISTORY) {
+    history.count++;
+  }
+  preferences.putBytes("history", &history, sizeof(history));
+  preferences.end();
+  historyReady = true;
+
+  uint32_t durations[BOOT_PHASE_COUNT];
+  uint32_t totalMs;
+  phaseDurations(current, durations, &totalMs);
+  int longest = 0;
+  for (int i = 1; i < BOOT_PHASE_COUNT; i++) {
+    if (durations[i] > durations[longest]) {
+      longest = i;
+    }
+  }
+  Serial.print("Boot ");
+  Serial.print(current.sequence);
+  Serial.print(" after ");
+  Serial.print(resetReasonName(current.resetReason));
+  Serial.print(" reset took ");
+  Serial.print(totalMs);
+  Serial.print(" ms, longest phase ");
+  Serial.print(PHASE_NAMES[longest]);
+  Serial.print(" ");
+  Serial.print(durations[longest]);
+  Serial.println(" ms.");
+}
+
+void bootProfileWriteText(ImageWriteFn write, void* context) {
+  if (!historyReady) {
+    return;
+  }
+  char line[REPORT_LINE_LENGTH];
+  int length = snprintf(
+    line, sizeof(line),
+    "# HELP clock_boot_phase_seconds Duration of a boot phase, labeled with the boot's sequence number\n"
+  );
+  writeTextLine(write, context, line, length);
+  length = snprintf(line, sizeof(line), "# TYPE clock_boot_phase_seconds gauge\n");
+  writeTextLine(write, context, line, length);
+  for (uint32_t b = 0; b < history.count; b++) {
+    uint32_t durations[BOOT_PHASE_COUNT];
+    uint32_t totalMs;
+    phaseDurations(history.records[b], durations, &totalMs);
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+      if (history.records[b].phaseEndMs[i] == 0) {
+        continue;
+      }
+      length = snprintf(
+        line, sizeof(line), "clock_boot_phase_seconds{boot=\"%lu\",phase=\"%s\"} %lu.%03lu\n",
+        (unsigned long)history.records[b].sequence, PHASE_NAMES[i],
+        (unsigned long)(durations[i] / 1000), (unsigned long)(durations[i] % 1000)
+      );
+      writeTextLine(write, context, line, length);
+    }
+  }
+
+  length = snprintf(line, sizeof(line), "# HELP clock_boot_total_seconds Time from application start to the end of setup()\n");
+  writeTextLine(write, context, line, length);
+  length = snprintf(line, sizeof(line), "# TYPE clock_boot_total_seconds gauge\n");
+  writeTextLine(write, context, line, length);
+  for (uint32_t b = 0; b < history.count; b++) {
+    uint32_t durations[BOOT_PHASE_COUNT];
+    uint32_t totalMs;
+    phaseDurations(history.records[b], durations, &totalMs);
+    length = snprintf(
+      line, sizeof(line), "clock_boot_total_seconds{boot=\"%lu\",reset_reason=\"%s\"} %lu.%03lu\n",
+      (unsigned long)history.records[b].sequence, resetReasonName(history.records[b].resetReason),
+      (unsigned long)(totalMs / 1000), (unsigned long)(totalMs % 1000)
+    );
+    writeTextLine(write, context, line, length);
+  }
+}
+
+void bootProfileWriteReport(ImageWriteFn write, void* context) {
+  char line[REPORT_LINE_LENGTH];
+  int length;
+  if (!historyReady) {
+    length = snprintf(line, sizeof(line), "Boot not finished yet.\n");
+    writeTextLine(write, context, line, length);
+    return;
+  }
+
+  length = appendText(line, 0, "%5s %-9s", "boot", "reset");
+  for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+    length = appendText(line, length, " %9s", PHASE_NAMES[i]);
+  }
+  length = appendText(line, length, " %7s\n", "total");
+  writeTextLine(write, context, line, length);
+
+  for (uint32_t b = 0; b < history.count; b++) {
+    const BootRecord& record = history.records[b];
+    uint32_t durations[BOOT_PHASE_COUNT];
+    uint32_t totalMs;
+    phaseDurations(record, durations, &totalMs);
+    length = appendText(line, 0, "%5lu %-9s", (unsigned long)record.sequence, resetReasonName(record.resetReason));
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+      if (record.phaseEndMs[i] == 0) {
+        length = appendText(line, length, " %9s", "-");
+      }
+      else {
+        length = appendText(line, length, " %9lu", (unsigned long)durations[i]);
+      }
+    }
+    length = appendText(line, length, " %7lu\n", (unsigned long)totalMs);
+    writeTextLine(write, context, line, length);
+  }
+}
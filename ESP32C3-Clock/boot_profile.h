@@ -0,0 +1,46 @@
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <stdint.h>
+#include "text_writer.h"
+
+// Boot phase timing. setup() marks the end of each phase with the time
+// since the application started (esp_timer), so the first phase covers
+// the ESP-IDF and Arduino startup before setup(); the ROM and second
+// stage bootloader before that are not included. At the end of setup()
+// the profile is stored in NVS together with the reset reason, keeping the
+// last BOOT_PROFILE_HISTORY boots.
+
+#define BOOT_PROFILE_HISTORY 8
+
+enum BootPhase {
+  BOOT_PHASE_STARTUP,    // until setup() is called
+  BOOT_PHASE_SERIAL,     // Serial.begin() and the wait for the monitor
+  BOOT_PHASE_BLUETOOTH,  // Bluetooth teardown
+  BOOT_PHASE_SERVICES,   // log drain, energy, system monitor and watchdog
+  BOOT_PHASE_DISPLAY,    // display mutex, shadow framebuffer and panel init
+  BOOT_PHASE_UI,         // startup screen and buttons
+  BOOT_PHASE_CONFIG,     // settings from NVS
+  BOOT_PHASE_WIFI,       // WiFiManager connect, or opening the portal
+  BOOT_PHASE_NTP,        // first NTP sync
+  BOOT_PHASE_TASKS,      // WiFi monitor, NTP, web server and console tasks
+  BOOT_PHASE_FACE,       // clock face setup
+  BOOT_PHASE_COUNT
+};
+
+// Marks the end of a phase. Phases that are not marked, such as the NTP
+// sync without WiFi, are left out of the profile.
+void bootProfileMark(BootPhase phase);
+// Stores the profile of this boot in NVS and prints a summary. Call once,
+// at the end of setup().
+void bootProfileSave();
+
+// Writes the stored boots, newest first, as
+// clock_boot_phase_seconds{boot="42",phase="..."} and
+// clock_boot_total_seconds{boot="42",reset_reason="..."}, labeled with the
+// boot's sequence number so a series keeps describing the same boot.
+void bootProfileWriteText(ImageWriteFn write, void* context);
+// One line per stored boot with its reset reason and phase times.
+void bootProfileWriteReport(ImageWriteFn write, void* context);
+
+#endif
@@ -4,6 +4,10 @@
 #include "pins.h"
 #include "app_state.h"
 #include "timing_constants.h"
+#include "task_trace.h"
+#include "log_ring.h"
+#include "input_latency.h"
+#include "esp_timer.h"
 
 static OneButton buttonBoot(BOOT_BUTTON_PIN, true);
 #if !DISABLE_ENCODER
@@ -12,6 +16,41 @@ static OneButton buttonBoot(BOOT_BUTTON_PIN, true);
 
 static unsigned long resetPendingStart = 0;
 
+// Time of the last edge on each input pin, for the input latency. The pins
+// are still polled; the interrupts only take the time.
+static volatile uint32_t bootEdgeUs = 0;
+#if !DISABLE_ENCODER
+  static volatile uint32_t encoderSwEdgeUs = 0;
+  static volatile uint32_t encoderClkEdgeUs = 0;
+#endif
+
+static void IRAM_ATTR onBootEdge() {
+  bootEdgeUs = (uint32_t)esp_timer_get_time();
+}
+
+#if !DISABLE_ENCODER
+  static void IRAM_ATTR onEncoderSwEdge() {
+    encoderSwEdgeUs = (uint32_t)esp_timer_get_time();
+  }
+
+  static void IRAM_ATTR onEncoderClkEdge() {
+    encoderClkEdgeUs = (uint32_t)esp_timer_get_time();
+  }
+#endif
+
+// Both buttons report double clicks and long presses; the one touched last
+// made it.
+static uint32_t lastButtonEdgeUs() {
+  uint32_t edgeUs = bootEdgeUs;
+  #if !DISABLE_ENCODER
+    uint32_t nowUs = inputLatencyNowUs();
+    if (nowUs - encoderSwEdgeUs < nowUs - edgeUs) {
+      edgeUs = encoderSwEdgeUs;
+    }
+  #endif
+  return edgeUs;
+}
+
 static void (*_onResetConfirm)() = nullptr;
 static void (*_onDoubleClick)() = nullptr;
 static void (*_onSingleClick)() = nullptr;
@@ -20,15 +59,17 @@ static void (*_onSingleClick)() = nullptr;
 #endif
 
 static void handleDoubleClick() {
-  Serial.println("Button double click.");
+  logInfo("Button double click.");
+  TASK_TRACE_INSTANT("button_double_click", getAppState());
   if (getAppState() == RESET_PENDING) {
-    Serial.println("Reset confirmed!");
+    logInfo("Reset confirmed!");
     if (_onResetConfirm) {
       _onResetConfirm();
     }
   }
   else {
-    Serial.println("Double click in normal state.");
+    logDebug("Double click in normal state.");
+    inputLatencyBegin(INPUT_DOUBLE_CLICK, lastButtonEdgeUs());
     if (_onDoubleClick) {
       _onDoubleClick();
     }
@@ -36,15 +77,20 @@ static void handleDoubleClick() {
 }
 
 static void handleLongPressStop() {
-  Serial.println("Button long press stop.");
+  logInfo("Button long press stop.");
+  TASK_TRACE_INSTANT("button_long_press", getAppState());
+  inputLatencyBegin(INPUT_LONG_PRESS, lastButtonEdgeUs());
   setAppState(RESET_PENDING);
+  inputLatencyApplied(INPUT_LONG_PRESS);
   resetPendingStart = millis();
-  Serial.println("Reset pending — waiting for confirmation...");
+  logInfo("Reset pending — waiting for confirmation...");
 }
 
 #if !DISABLE_ENCODER
   static void handleSingleClick() {
-    Serial.println("Encoder button single click.");
+    logInfo("Encoder button single click.");
+    TASK_TRACE_INSTANT("encoder_click", getAppState());
+    inputLatencyBegin(INPUT_CLICK, encoderSwEdgeUs);
     if (_onSingleClick) {
       _onSingleClick();
     }
@@ -72,6 +118,7 @@ void buttonSetup(
   buttonBoot.setLongPressIntervalMs(LONG_PRESS_TIME_MS);
   buttonBoot.attachDoubleClick(handleDoubleClick);
   buttonBoot.attachLongPressStop(handleLongPressStop);
+  attachInterrupt(digitalPinToInterrupt(BOOT_BUTTON_PIN), onBootEdge, CHANGE);
 
   #if !DISABLE_ENCODER
     buttonEncoder.setDebounceMs(BUTTON_DEBOUNCE_MS);
@@ -81,6 +128,8 @@ void buttonSetup(
     buttonEncoder.attachClick(handleSingleClick);
     buttonEncoder.attachDoubleClick(handleDoubleClick);
     buttonEncoder.attachLongPressStop(handleLongPressStop);
+    attachInterrupt(digitalPinToInterrupt(PIN_ENCODER_SW), onEncoderSwEdge, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(PIN_ENCODER_CLK), onEncoderClkEdge, FALLING);
   #endif
 }
 
@@ -106,7 +155,9 @@ void buttonLoop() {
           lastRotationMs = now;
           int dt = digitalRead(PIN_ENCODER_DT);
           int delta = (dt == HIGH) ? 1 : -1;
-          Serial.print("Rotation "); Serial.println(delta);
+          logDebug("Rotation %d", delta);
+          TASK_TRACE_INSTANT("encoder_rotation", delta);
+          inputLatencyBegin(INPUT_ROTATION, encoderClkEdgeUs);
           if (_onRotation) {
             _onRotation(delta);
           }
@@ -118,7 +169,7 @@ void buttonLoop() {
   // Reset confirmation timeout — shared by both buttons.
   if (getAppState() == RESET_PENDING) {
     if (millis() - resetPendingStart >= RESET_TIMEOUT_MS) {
-      Serial.println("Reset confirmation timed out. Returning to previous state.");
+      logInfo("Reset confirmation timed out. Returning to previous state.");
       setAppState(getPreviousState());
     }
   }
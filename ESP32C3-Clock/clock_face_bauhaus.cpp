@@ -114,6 +114,8 @@ void ClockFaceBauhaus::draw(
   bool blinkState = ctx.blinkState;
   tm timeinfo = ctx.timeinfo;
   if (_needsFullRedraw) {
+    RENDER_WATCHDOG_STAGE(RENDER_STAGE_BACKGROUND);
+    RENDER_PROFILE_STAGE(RENDER_STAGE_BACKGROUND);
     drawBackground();
     drawFaceRing();
     _lastHourAngle = -1.0f;
@@ -142,7 +144,18 @@ void ClockFaceBauhaus::draw(
       _theme.background,
       isClippedBauhaus
     );
-    drawCounterweight(hourAngle);
+    drawCounterweight(
+      hourAngle,
+      COUNTERWEIGHT_DIST,
+      COUNTERWEIGHT_RADIUS,
+      COUNTERWEIGHT_CLIP_R,
+      _lastCounterweightValid,
+      _lastCounterweightX,
+      _lastCounterweightY,
+      _theme.counterweight,
+      _theme.face,
+      _theme.background
+    );
     _lastHourAngle = hourAngle;
   }
 
@@ -162,10 +175,11 @@ void ClockFaceBauhaus::draw(
   }
 
   char timeBuf[6];
-  sprintf(timeBuf, "%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min);
+  snprintf(timeBuf, sizeof(timeBuf), "%02u:%02u", (unsigned)timeinfo.tm_hour % 24u, (unsigned)timeinfo.tm_min % 60u);
   if (strcmp(timeBuf, _lastTimeText) != 0) {
     drawDigitalTime(timeinfo.tm_hour, timeinfo.tm_min);
-    strncpy(_lastTimeText, timeBuf, sizeof(_lastTimeText) - 1);
+    memcpy(_lastTimeText, timeBuf, sizeof(_lastTimeText) - 1);
+    _lastTimeText[sizeof(_lastTimeText) - 1] = '\0';
   }
 
   drawStatusDot(state, blinkState);
@@ -193,31 +207,9 @@ void ClockFaceBauhaus::drawFaceRing() {
   }
 }
 
-void ClockFaceBauhaus::drawCounterweight(float hourAngleDeg) {
-  float rad = (hourAngleDeg + 180.0f) * PI / 180.0f;
-  int cx = CENTER_X + (int)roundf(COUNTERWEIGHT_DIST * cosf(rad));
-  int cy = CENTER_Y + (int)roundf(COUNTERWEIGHT_DIST * sinf(rad));
-
-  if (_lastCounterweightValid) {
-    TFT_display.fillCircle(_lastCounterweightX, _lastCounterweightY, COUNTERWEIGHT_RADIUS, _theme.background);
-    TFT_display.drawCircle(_lastCounterweightX, _lastCounterweightY, COUNTERWEIGHT_RADIUS, _theme.face);
-    _lastCounterweightValid = false;
-  }
-
-  int dx = cx - CENTER_X;
-  int dy = cy - CENTER_Y;
-  if (dx * dx + dy * dy >= COUNTERWEIGHT_CLIP_R * COUNTERWEIGHT_CLIP_R) {
-    return;
-  }
-
-  TFT_display.fillCircle(cx, cy, COUNTERWEIGHT_RADIUS, _theme.counterweight);
-  TFT_display.drawCircle(cx, cy, COUNTERWEIGHT_RADIUS, _theme.face);
-  _lastCounterweightX = (int16_t)cx;
-  _lastCounterweightY = (int16_t)cy;
-  _lastCounterweightValid = true;
-}
-
 void ClockFaceBauhaus::drawDigitalTime(int hour, int minute) {
+  RENDER_WATCHDOG_STAGE(RENDER_STAGE_TEXT);
+  RENDER_PROFILE_STAGE(RENDER_STAGE_TEXT);
   char buf[6];
   sprintf(buf, "%02d:%02d", hour, minute);
   TFT_display.fillRect(TIME_TEXT_X, TIME_TEXT_Y, TIME_TEXT_W, TIME_CHAR_H, _theme.background);
@@ -228,6 +220,8 @@ void ClockFaceBauhaus::drawDigitalTime(int hour, int minute) {
 }
 
 void ClockFaceBauhaus::drawStatusDot(AppState state, bool blinkState) {
+  RENDER_WATCHDOG_STAGE(RENDER_STAGE_ICONS);
+  RENDER_PROFILE_STAGE(RENDER_STAGE_ICONS);
   uint16_t color;
   if (state == DISCONNECTED || state == NOT_CONFIGURED) {
     color = _theme.statusNoWifi;
@@ -62,7 +62,6 @@ private:
   void drawBackground();
   void drawFaceRing();
   void drawHands();
-  void drawCounterweight(float hourAngleDeg);
   void drawDigitalTime(int hour, int minute);
   void drawStatusDot(AppState state, bool blinkState);
 };
@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include <time.h>
 #include "clock_face_bauhaus_auto.h"
+#include "clock_source.h"
 
 static constexpr int BAUHAUS_LIGHT_HOUR_START = 7;
 static constexpr int BAUHAUS_DARK_HOUR_START = 19;
@@ -34,14 +35,12 @@ ClockFace* ClockFaceBauhausAuto::selectFace(int hour) {
 void ClockFaceBauhausAuto::draw(
   const DrawContext& ctx
 ) {
-  AppState state = ctx.state;
-  bool blinkState = ctx.blinkState;
   tm timeinfo = ctx.timeinfo;
   ClockFace* next;
 
   #if !DISABLE_ENCODER
     if (ctx.gracePeriodActive) {
-      unsigned long now = millis();
+      unsigned long now = clockSourceMillis();
       if (_previewSwitchMs == 0 || (now - _previewSwitchMs) >= PREVIEW_SWITCH_INTERVAL_MS) {
         _previewShowLight = (_previewSwitchMs == 0) ? true : !_previewShowLight;
         _previewSwitchMs = now;
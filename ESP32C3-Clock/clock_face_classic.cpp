@@ -53,6 +53,8 @@ void ClockFaceClassic::draw(
   bool blinkState = ctx.blinkState;
   tm timeinfo = ctx.timeinfo;
   if (_needsFullRedraw) {
+    RENDER_WATCHDOG_STAGE(RENDER_STAGE_BACKGROUND);
+    RENDER_PROFILE_STAGE(RENDER_STAGE_BACKGROUND);
     drawBackground();
     drawClockFace();
     drawTextBoxFrame();
@@ -117,6 +119,8 @@ void ClockFaceClassic::drawTextBoxFrame() {
 }
 
 void ClockFaceClassic::drawTextBoxContent(AppState state, tm timeinfo) {
+  RENDER_WATCHDOG_STAGE(RENDER_STAGE_TEXT);
+  RENDER_PROFILE_STAGE(RENDER_STAGE_TEXT);
   char text[16] = "";
 
   if (isStatusTextActive()) {
@@ -153,7 +157,7 @@ void ClockFaceClassic::drawTextBoxContent(AppState state, tm timeinfo) {
     return;
   }
 
-  strncpy(_lastText, text, sizeof(_lastText) - 1);
+  snprintf(_lastText, sizeof(_lastText), "%s", text);
 
   TFT_display.setTextColor(COLOR_YELLOW, COLOR_BACKGROUND);
   TFT_display.setTextSize(2);
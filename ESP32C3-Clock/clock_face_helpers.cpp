@@ -65,6 +65,8 @@ void drawHandDiff(
   uint16_t backgroundColor,
   bool (*clipFn)(int x, int y)
 ) {
+  RENDER_WATCHDOG_STAGE(RENDER_STAGE_HANDS);
+  RENDER_PROFILE_STAGE(RENDER_STAGE_HANDS);
   // Static buffer avoids Variable Length Array stack allocation.
   // Safe because all calls are serialised by the display mutex.
   static Pixel newPixels[HAND_PIXEL_BUF_MAX];
@@ -91,6 +93,65 @@ void drawHandDiff(
   lastCount = newCount;
 }
 
+void drawSingleArc(
+  float fraction,
+  int innerR,
+  int outerR,
+  float stepDeg,
+  uint16_t arcColor,
+  uint16_t trackColor
+) {
+  RENDER_WATCHDOG_STAGE(RENDER_STAGE_ARCS);
+  RENDER_PROFILE_STAGE(RENDER_STAGE_ARCS);
+  float filledDeg = fraction * 360.0f;
+  for (float angle = 0.0f; angle < 360.0f; angle += stepDeg) {
+    float rad = (angle - 90.0f) * PI / 180.0f;
+    uint16_t color = (angle < filledDeg) ? arcColor : trackColor;
+    for (int r = innerR; r <= outerR; r++) {
+      int x = CENTER_X + (int)roundf(r * cosf(rad));
+      int y = CENTER_Y + (int)roundf(r * sinf(rad));
+      TFT_display.drawPixel(x, y, color);
+    }
+  }
+}
+
+void drawCounterweight(
+  float hourAngleDeg,
+  int dist,
+  int radius,
+  int clipR,
+  bool& lastValid,
+  int16_t& lastX,
+  int16_t& lastY,
+  uint16_t color,
+  uint16_t outlineColor,
+  uint16_t backgroundColor
+) {
+  RENDER_WATCHDOG_STAGE(RENDER_STAGE_HANDS);
+  RENDER_PROFILE_STAGE(RENDER_STAGE_HANDS);
+  float rad = (hourAngleDeg + 180.0f) * PI / 180.0f;
+  int cx = CENTER_X + (int)roundf(dist * cosf(rad));
+  int cy = CENTER_Y + (int)roundf(dist * sinf(rad));
+
+  if (lastValid) {
+    TFT_display.fillCircle(lastX, lastY, radius, backgroundColor);
+    TFT_display.drawCircle(lastX, lastY, radius, outlineColor);
+    lastValid = false;
+  }
+
+  int dx = cx - CENTER_X;
+  int dy = cy - CENTER_Y;
+  if (dx * dx + dy * dy >= clipR * clipR) {
+    return;
+  }
+
+  TFT_display.fillCircle(cx, cy, radius, color);
+  TFT_display.drawCircle(cx, cy, radius, outlineColor);
+  lastX = (int16_t)cx;
+  lastY = (int16_t)cy;
+  lastValid = true;
+}
+
 void drawStatusIcons(
   AppState state,
   bool blinkState,
@@ -99,6 +160,8 @@ void drawStatusIcons(
   int ntpX,
   int ntpY
 ) {
+  RENDER_WATCHDOG_STAGE(RENDER_STAGE_ICONS);
+  RENDER_PROFILE_STAGE(RENDER_STAGE_ICONS);
   bool wifiVisible = true;
   bool wifiOk = true;
 
@@ -35,6 +35,28 @@ void drawHandDiff(
   bool (*clipFn)(int x, int y)
 );
 
+void drawSingleArc(
+  float fraction,
+  int innerR,
+  int outerR,
+  float stepDeg,
+  uint16_t arcColor,
+  uint16_t trackColor
+);
+
+void drawCounterweight(
+  float hourAngleDeg,
+  int dist,
+  int radius,
+  int clipR,
+  bool& lastValid,
+  int16_t& lastX,
+  int16_t& lastY,
+  uint16_t color,
+  uint16_t outlineColor,
+  uint16_t backgroundColor
+);
+
 void drawStatusIcons(
   AppState state,
   bool blinkState,
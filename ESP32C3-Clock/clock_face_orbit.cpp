@@ -119,6 +119,8 @@ void ClockFaceOrbit::draw(
 }
 
 void ClockFaceOrbit::drawBackground() {
+  RENDER_WATCHDOG_STAGE(RENDER_STAGE_BACKGROUND);
+  RENDER_PROFILE_STAGE(RENDER_STAGE_BACKGROUND);
   TFT_display.fillScreen(COLOR_BACKGROUND);
 }
 
@@ -134,46 +136,35 @@ static int daysInMonth(int month, int year) {
   return days[month];
 }
 
-static void drawSingleArc(float fraction, int innerR, int outerR, uint16_t arcColor) {
-  float filledDeg = fraction * 360.0f;
-  for (float angle = 0.0f; angle < 360.0f; angle += ARC_STEP_DEG) {
-    float rad = (angle - 90.0f) * PI / 180.0f;
-    uint16_t color = (angle < filledDeg) ? arcColor : COLOR_ORBIT_TRACK;
-    for (int r = innerR; r <= outerR; r++) {
-      int x = CENTER_X + (int)roundf(r * cosf(rad));
-      int y = CENTER_Y + (int)roundf(r * sinf(rad));
-      TFT_display.drawPixel(x, y, color);
-    }
-  }
-}
-
 void ClockFaceOrbit::drawArcTrack(const struct tm* timeinfo, int displayMinute) {
   float minuteFraction = (displayMinute < 0) ? 0.0f : displayMinute / 60.0f;
-  drawSingleArc(minuteFraction, ARC_MINUTE_INNER, ARC_MINUTE_OUTER, COLOR_ARC_MINUTE);
+  drawSingleArc(minuteFraction, ARC_MINUTE_INNER, ARC_MINUTE_OUTER, ARC_STEP_DEG, COLOR_ARC_MINUTE, COLOR_ORBIT_TRACK);
 
   if (timeinfo == nullptr) {
     return;
   }
 
   float dayFraction = (timeinfo->tm_hour * 60 + timeinfo->tm_min + 1) / 1440.0f;
-  drawSingleArc(dayFraction, ARC_DAY_INNER, ARC_DAY_OUTER, COLOR_ARC_DAY);
+  drawSingleArc(dayFraction, ARC_DAY_INNER, ARC_DAY_OUTER, ARC_STEP_DEG, COLOR_ARC_DAY, COLOR_ORBIT_TRACK);
 
   int totalDaysInMonth = daysInMonth(timeinfo->tm_mon, timeinfo->tm_year + 1900);
   float monthFraction = timeinfo->tm_mday / (float)totalDaysInMonth;
-  drawSingleArc(monthFraction, ARC_MONTH_INNER, ARC_MONTH_OUTER, COLOR_ARC_MONTH);
+  drawSingleArc(monthFraction, ARC_MONTH_INNER, ARC_MONTH_OUTER, ARC_STEP_DEG, COLOR_ARC_MONTH, COLOR_ORBIT_TRACK);
 
   int totalDaysInYear = isLeapYear(timeinfo->tm_year + 1900) ? 366 : 365;
   float yearFraction = (timeinfo->tm_yday + 1) / (float)totalDaysInYear;
-  drawSingleArc(yearFraction, ARC_YEAR_INNER, ARC_YEAR_OUTER, COLOR_ARC_YEAR);
+  drawSingleArc(yearFraction, ARC_YEAR_INNER, ARC_YEAR_OUTER, ARC_STEP_DEG, COLOR_ARC_YEAR, COLOR_ORBIT_TRACK);
 }
 
 void ClockFaceOrbit::drawTime(int hour, int minute) {
+  RENDER_WATCHDOG_STAGE(RENDER_STAGE_TEXT);
+  RENDER_PROFILE_STAGE(RENDER_STAGE_TEXT);
   char buf[8];
   if (hour < 0) {
     strcpy(buf, "--:--");
   }
   else {
-    sprintf(buf, "%02d:%02d", hour, minute);
+    snprintf(buf, sizeof(buf), "%02u:%02u", (unsigned)hour % 24u, (unsigned)minute % 60u);
   }
   int w = strlen(buf) * TIME_CHAR_W;
   int x = (SCREEN_WIDTH - w) / 2;
@@ -185,6 +176,8 @@ void ClockFaceOrbit::drawTime(int hour, int minute) {
 }
 
 void ClockFaceOrbit::drawDate(const struct tm* timeinfo) {
+  RENDER_WATCHDOG_STAGE(RENDER_STAGE_TEXT);
+  RENDER_PROFILE_STAGE(RENDER_STAGE_TEXT);
   // Line 1: YYYY-MM-DD
   char dateBuf[12];
   strftime(dateBuf, sizeof(dateBuf), "%Y-%m-%d", timeinfo);
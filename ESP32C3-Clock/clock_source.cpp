@@ -0,0 +1,97 @@
+#include <stddef.h>
+#include <sys/time.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "clock_source.h"
+#include "timing_constants.h"
+
+struct ClockState {
+  ClockMode mode;
+  uint32_t factor;
+  int64_t baseRealUs;
+  int64_t baseMonoUs;
+  int64_t baseWallUs;
+};
+
+// Mode changes come from the serial console while the render loop and the
+// other tasks read the state, so every access copies it under the lock.
+static ClockState state = { CLOCK_REAL, 1, 0, 0, 0 };
+static portMUX_TYPE stateLock = portMUX_INITIALIZER_UNLOCKED;
+
+static ClockState readState() {
+  portENTER_CRITICAL(&stateLock);
+  ClockState copy = state;
+  portEXIT_CRITICAL(&stateLock);
+  return copy;
+}
+
+static int64_t monoUs(const ClockState& clock, int64_t realUs) {
+  switch (clock.mode) {
+    case CLOCK_FIXED:
+      return clock.baseMonoUs;
+    case CLOCK_ACCELERATED:
+      return clock.baseMonoUs + (realUs - clock.baseRealUs) * clock.factor;
+    case CLOCK_REAL:
+    default:
+      return clock.baseMonoUs + (realUs - clock.baseRealUs);
+  }
+}
+
+static void publish(ClockMode mode, uint32_t factor, int64_t wallUs) {
+  int64_t realUs = esp_timer_get_time();
+  portENTER_CRITICAL(&stateLock);
+  state.baseMonoUs = monoUs(state, realUs);
+  state.baseRealUs = realUs;
+  state.baseWallUs = wallUs;
+  state.factor = factor;
+  state.mode = mode;
+  portEXIT_CRITICAL(&stateLock);
+}
+
+void clockSourceSetReal() {
+  publish(CLOCK_REAL, 1, 0);
+}
+
+void clockSourceSetFixed(int64_t wallUs) {
+  publish(CLOCK_FIXED, 0, wallUs);
+}
+
+void clockSourceSetAccelerated(uint32_t factor, int64_t startWallUs) {
+  publish(CLOCK_ACCELERATED, factor > 0 ? factor : 1, startWallUs);
+}
+
+void clockSourceAdvanceMs(uint32_t ms) {
+  portENTER_CRITICAL(&stateLock);
+  if (state.mode == CLOCK_FIXED) {
+    state.baseMonoUs += (int64_t)ms * 1000;
+    state.baseWallUs += (int64_t)ms * 1000;
+  }
+  portEXIT_CRITICAL(&stateLock);
+}
+
+ClockMode clockSourceMode() {
+  return readState().mode;
+}
+
+uint32_t clockSourceFactor() {
+  return readState().factor;
+}
+
+unsigned long clockSourceMillis() {
+  ClockState current = readState();
+  return (unsigned long)(monoUs(current, esp_timer_get_time()) / 1000);
+}
+
+int64_t clockSourceWallUs() {
+  ClockState current = readState();
+  if (current.mode != CLOCK_REAL) {
+    return current.baseWallUs + (monoUs(current, esp_timer_get_time()) - current.baseMonoUs);
+  }
+
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  if (tv.tv_sec < TIME_VALID_AFTER_EPOCH) {
+    return -1;
+  }
+  return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
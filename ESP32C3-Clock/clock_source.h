@@ -0,0 +1,43 @@
+#ifndef CLOCK_SOURCE_H
+#define CLOCK_SOURCE_H
+
+#include <cstdint>
+
+// The time the clock logic runs on. The timers in app_state and
+// face_manager, the render loop and the displayed time all read it instead
+// of millis() and the system clock, so the whole clock can run on a
+// simulated time:
+//
+//   CLOCK_REAL         millis() and the NTP synced system time
+//   CLOCK_FIXED        frozen at a chosen wall time, moved with
+//                      clockSourceAdvanceMs()
+//   CLOCK_ACCELERATED  runs factor times faster than real time from a
+//                      chosen wall time
+//
+// clockSourceMillis() never jumps backwards when the mode changes, so running
+// timers stay valid. Network timeouts, debouncing, the reset confirmation
+// timeout, the WiFi power save timer and energy accounting keep using
+// millis(), as they measure real time and must run out while the clock is
+// fixed. The mode may be changed from any task.
+
+enum ClockMode {
+  CLOCK_REAL,
+  CLOCK_FIXED,
+  CLOCK_ACCELERATED
+};
+
+void clockSourceSetReal();
+void clockSourceSetFixed(int64_t wallUs);
+void clockSourceSetAccelerated(uint32_t factor, int64_t startWallUs);
+// Moves a fixed clock forward. Does nothing in the other modes.
+void clockSourceAdvanceMs(uint32_t ms);
+
+ClockMode clockSourceMode();
+uint32_t clockSourceFactor();
+
+// Replacement for millis().
+unsigned long clockSourceMillis();
+// Wall clock in microseconds, negative while the real time is not known.
+int64_t clockSourceWallUs();
+
+#endif
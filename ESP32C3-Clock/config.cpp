@@ -1,7 +1,19 @@
 #include "Arduino.h"
+#include <esp_wifi.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "config.h"
 #include "app_state.h"
 #include "timezones.h"
+#include "timing_constants.h"
+#include "metrics.h"
+#include "display.h"
+#include "face_manager.h"
+#include "system_monitor.h"
+#include "telemetry.h"
+#include "task_trace.h"
+#include "input_latency.h"
+#include "energy.h"
 #if !DISABLE_ENCODER
   #include "clock_face_factory.h"
 #endif
@@ -21,9 +33,36 @@ const char* WIFI_HOTSPOT_PASSWORD = "clocksetup";
 static Preferences preferences;
 static char timezone_buffer[100];
 static char ntp_server_buffer[50];
+static char telemetry_buffer[64];
 static bool shouldSaveConfig = false;
 static bool powersafe_mode = true;
+static bool wifi_configured = false;
 static String default_face_id = "orbit";
+static bool lastReconnectFast = false;
+
+// The portal outlives connectWifi(): it is serviced by portalTask in
+// non-blocking mode, so the manager and its parameters are file scoped.
+static WiFiManager wifiManager;
+static TaskHandle_t portalTaskHandle = NULL;
+static WiFiManagerParameter custom_timezone_select(timezoneSelectBuf);
+static WiFiManagerParameter custom_ntp_server("ntp_server", "NTP Server", "", 50);
+static WiFiManagerParameter custom_telemetry("telemetry", "Telemetry collector (host:port, empty to disable)", "", 64);
+static WiFiManagerParameter custom_powersafe(powersafeSelectBuf);
+#if !DISABLE_ENCODER
+  static WiFiManagerParameter custom_face_select(faceSelectBuf);
+#endif
+
+// Last known access point. Kept in RTC memory so it survives soft resets,
+// mirrored to NVS so it also survives power cycles.
+#define WIFI_LINK_CACHE_MAGIC 0x4C4E4B32UL
+
+struct WifiLinkCache {
+  uint32_t magic;
+  uint8_t bssid[6];
+  int32_t channel;
+};
+
+RTC_DATA_ATTR static WifiLinkCache linkCache;
 
 static void saveConfigCallback() {
   Serial.println("Should save config");
@@ -70,7 +109,9 @@ bool loadConfig() {
   String saved_tz_iana = preferences.getString("timezone_iana", "");
   String saved_tz_legacy = preferences.getString("timezone", "");
   String saved_ntp = preferences.getString("ntp_server", "pool.ntp.org");
+  String saved_telemetry = preferences.getString("telemetry", "");
   bool wifiConfigured = preferences.getBool("wifi_configured", false);
+  wifi_configured = wifiConfigured;
   bool saved_powersafe = preferences.getBool("powersafe", true);
   powersafe_mode = saved_powersafe;
   String saved_face_id = preferences.getString("default_face", "orbit");
@@ -78,6 +119,17 @@ bool loadConfig() {
   Serial.print("Loaded default face: ");
   Serial.println(default_face_id);
 
+  if (linkCache.magic != WIFI_LINK_CACHE_MAGIC) {
+    WifiLinkCache stored;
+    if (
+      preferences.getBytes("wifi_link", &stored, sizeof(stored)) == sizeof(stored)
+      && stored.magic == WIFI_LINK_CACHE_MAGIC
+    ) {
+      linkCache = stored;
+      Serial.println("Loaded cached WiFi link from NVS.");
+    }
+  }
+
   preferences.end();
 
   // Migration logic: prefer IANA, fall back to legacy POSIX
@@ -103,6 +155,7 @@ bool loadConfig() {
 
   strcpy(ntp_server_buffer, saved_ntp.c_str());
   ntp_server = saved_ntp;
+  strncpy(telemetry_buffer, saved_telemetry.c_str(), sizeof(telemetry_buffer) - 1);
 
   Serial.print("Loaded NTP server: ");
   Serial.println(ntp_server_buffer);
@@ -147,68 +200,107 @@ static void buildPowersafeSelect(bool currentValue, char* buf, int bufSize) {
   }
 #endif
 
-bool connectWifi() {
-  setAppState(CONNECTING);
+static void saveLinkCache() {
+  WifiLinkCache fresh = {};
+  fresh.magic = WIFI_LINK_CACHE_MAGIC;
+  memcpy(fresh.bssid, WiFi.BSSID(), sizeof(fresh.bssid));
+  fresh.channel = WiFi.channel();
+
+  // Skip the flash write when the link is the same as before.
+  bool linkChanged = linkCache.magic != WIFI_LINK_CACHE_MAGIC
+    || memcmp(linkCache.bssid, fresh.bssid, sizeof(fresh.bssid)) != 0
+    || linkCache.channel != fresh.channel;
+  linkCache = fresh;
+
+  if (linkChanged) {
+    preferences.begin("clock-config", false);
+    preferences.putBytes("wifi_link", &linkCache, sizeof(linkCache));
+    preferences.end();
+    Serial.print("Cached WiFi link, channel ");
+    Serial.println(linkCache.channel);
+  }
+}
 
-  WiFiManager wm;
-  shouldSaveConfig = false;
+static void useDhcp() {
+  WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+}
 
-  buildTimezoneSelect("timezone", timezone_buffer, timezoneSelectBuf, TIMEZONE_SELECT_BUFFER_SIZE);
-  WiFiManagerParameter custom_timezone_select(timezoneSelectBuf);
-  WiFiManagerParameter custom_ntp_server("ntp_server", "NTP Server", ntp_server_buffer, 50);
+static bool waitForConnection(unsigned long timeoutMs, unsigned long pollMs) {
+  unsigned long start = millis();
+  while (WiFi.status() != WL_CONNECTED && (millis() - start) < timeoutMs) {
+    delay(pollMs);
+  }
+  return WiFi.status() == WL_CONNECTED;
+}
 
-  wm.addParameter(&custom_timezone_select);
-  wm.addParameter(&custom_ntp_server);
-  wm.setSaveParamsCallback(saveConfigCallback);
-  wm.setConfigPortalTimeout(180);
+// Joins the cached access point directly, skipping the channel scan. The
+// address still comes from DHCP: the lease the router granted is not known
+// here, and reusing an address past it could clash with another host.
+static bool fastReconnect(const wifi_config_t& conf) {
+  if (linkCache.magic != WIFI_LINK_CACHE_MAGIC || linkCache.channel <= 0) {
+    return false;
+  }
 
-  buildPowersafeSelect(powersafe_mode, powersafeSelectBuf, sizeof(powersafeSelectBuf));
-  WiFiManagerParameter custom_powersafe(powersafeSelectBuf);
-  wm.addParameter(&custom_powersafe);
+  useDhcp();
+  Serial.print("Fast reconnect, channel ");
+  Serial.println(linkCache.channel);
+
+  WiFi.begin((const char*)conf.sta.ssid, (const char*)conf.sta.password, linkCache.channel, linkCache.bssid);
+  if (waitForConnection(WIFI_FAST_RECONNECT_TIMEOUT_MS, WIFI_FAST_RECONNECT_POLL_MS)) {
+    saveLinkCache();
+    return true;
+  }
+
+  Serial.println("Fast reconnect failed.");
+  WiFi.disconnect();
+  return false;
+}
+
+static void applyPortalParams() {
+  Serial.println("Saving new configuration...");
+  strcpy(timezone_buffer, custom_timezone_select.getValue());
+  strcpy(ntp_server_buffer, custom_ntp_server.getValue());
+  strncpy(telemetry_buffer, custom_telemetry.getValue(), sizeof(telemetry_buffer) - 1);
+  powersafe_mode = strcmp(custom_powersafe.getValue(), "1") == 0;
 
   #if !DISABLE_ENCODER
-    buildFaceSelect(default_face_id.c_str(), faceSelectBuf, sizeof(faceSelectBuf));
-    WiFiManagerParameter custom_face_select(faceSelectBuf);
-    wm.addParameter(&custom_face_select);
+    const char* newFaceId = custom_face_select.getValue();
+    if (newFaceId != nullptr && strlen(newFaceId) > 0) {
+      default_face_id = String(newFaceId);
+    }
   #endif
 
-  Serial.println("Calling autoConnect...");
-  bool connected = wm.autoConnect(WIFI_HOTSPOT_SSID, WIFI_HOTSPOT_PASSWORD);
+  timezone = String(timezone_buffer);
+  ntp_server = String(ntp_server_buffer);
 
-  if (!connected) {
-    Serial.println("Failed to connect to WiFi");
-    setAppState(DISCONNECTED);
-    return false;
+  // Validate the IANA timezone
+  if (!isIanaFormat(timezone_buffer)) {
+    Serial.println("Warning: Received non-IANA timezone format, using default");
+    strcpy(timezone_buffer, "Europe/Budapest");
+    timezone = "Europe/Budapest";
   }
 
-  if (shouldSaveConfig) {
-    Serial.println("Saving new configuration...");
-    strcpy(timezone_buffer, custom_timezone_select.getValue());
-    strcpy(ntp_server_buffer, custom_ntp_server.getValue());
-    powersafe_mode = strcmp(custom_powersafe.getValue(), "1") == 0;
+  // Apply live: the new timezone shows up on the next frame and the new
+  // default face replaces the active one without a reboot.
+  setenv("TZ", getTimezone().c_str(), 1);
+  tzset();
 
-    #if !DISABLE_ENCODER
-      const char* newFaceId = custom_face_select.getValue();
-      if (newFaceId != nullptr && strlen(newFaceId) > 0) {
-        default_face_id = String(newFaceId);
-      }
-    #endif
-
-    timezone = String(timezone_buffer);
-    ntp_server = String(ntp_server_buffer);
+  takeDisplayMutex();
+  setConfiguredClockFace();
+  giveDisplayMutex();
+}
 
-    // Validate the IANA timezone
-    if (!isIanaFormat(timezone_buffer)) {
-      Serial.println("Warning: Received non-IANA timezone format, using default");
-      strcpy(timezone_buffer, "Europe/Budapest");
-      timezone = "Europe/Budapest";
-    }
+static void onWifiConnected() {
+  if (shouldSaveConfig) {
+    applyPortalParams();
+    shouldSaveConfig = false;
   }
 
   // Save everything including the wifi_configured flag
   preferences.begin("clock-config", false);
   preferences.putString("timezone_iana", timezone_buffer);
   preferences.putString("ntp_server", ntp_server_buffer);
+  preferences.putString("telemetry", telemetry_buffer);
   preferences.putBool("wifi_configured", true);
   preferences.putBool("powersafe", powersafe_mode);
   preferences.putString("default_face", default_face_id.c_str());
@@ -217,6 +309,7 @@ bool connectWifi() {
   preferences.remove("timezone");
 
   preferences.end();
+  wifi_configured = true;
 
   Serial.println("\nWiFi connected!");
   Serial.print("IP Address: ");
@@ -227,14 +320,106 @@ bool connectWifi() {
   Serial.print("Saved IANA timezone: ");
   Serial.println(timezone_buffer);
 
+  saveLinkCache();
   setAppState(CONNECTED_NOT_SYNCED);
-  return true;
+}
+
+static void setupPortal() {
+  static bool parametersAdded = false;
+
+  buildTimezoneSelect("timezone", timezone_buffer, timezoneSelectBuf, TIMEZONE_SELECT_BUFFER_SIZE);
+  custom_ntp_server.setValue(ntp_server_buffer, sizeof(ntp_server_buffer));
+  custom_telemetry.setValue(telemetry_buffer, sizeof(telemetry_buffer));
+  buildPowersafeSelect(powersafe_mode, powersafeSelectBuf, sizeof(powersafeSelectBuf));
+  #if !DISABLE_ENCODER
+    buildFaceSelect(default_face_id.c_str(), faceSelectBuf, sizeof(faceSelectBuf));
+  #endif
+
+  if (!parametersAdded) {
+    wifiManager.addParameter(&custom_timezone_select);
+    wifiManager.addParameter(&custom_ntp_server);
+    wifiManager.addParameter(&custom_telemetry);
+    wifiManager.addParameter(&custom_powersafe);
+    #if !DISABLE_ENCODER
+      wifiManager.addParameter(&custom_face_select);
+    #endif
+    wifiManager.setSaveParamsCallback(saveConfigCallback);
+    wifiManager.setConfigPortalBlocking(false);
+    parametersAdded = true;
+  }
+
+  // An unconfigured clock has nothing else to do, keep the portal open.
+  wifiManager.setConfigPortalTimeout(wifi_configured ? WIFI_PORTAL_TIMEOUT_S : 0);
+}
+
+static void portalTask(void* parameter) {
+  for (;;) {
+    if (wifiManager.process()) {
+      Serial.println("Config portal connected.");
+      onWifiConnected();
+      requestNtpSync();
+      break;
+    }
+    if (!wifiManager.getConfigPortalActive()) {
+      Serial.println("Config portal timed out.");
+      setAppState(wifi_configured ? DISCONNECTED : NOT_CONFIGURED);
+      break;
+    }
+    vTaskDelay(pdMS_TO_TICKS(WIFI_PORTAL_PROCESS_INTERVAL_MS));
+  }
+
+  portalTaskHandle = NULL;
+  systemMonitorRecordStack();
+  vTaskDelete(NULL);
+}
+
+bool isConfigPortalActive() {
+  return portalTaskHandle != NULL;
+}
+
+bool connectWifi() {
+  if (isConfigPortalActive()) {
+    return false;
+  }
+
+  TASK_TRACE_SCOPE("wifi_connect");
+  setAppState(CONNECTING);
+  energyRadioOn();
+  shouldSaveConfig = false;
+  setupPortal();
+
+  Serial.println("Calling autoConnect...");
+  bool connected = wifiManager.autoConnect(WIFI_HOTSPOT_SSID, WIFI_HOTSPOT_PASSWORD);
+
+  if (connected) {
+    onWifiConnected();
+    return true;
+  }
+
+  if (wifiManager.getConfigPortalActive()) {
+    // The clock keeps running while the portal is serviced in the background.
+    Serial.println("Config portal started in background.");
+    setAppState(wifi_configured ? DISCONNECTED : NOT_CONFIGURED);
+    xTaskCreatePinnedToCore(
+      portalTask,
+      "ConfigPortal",
+      6144,
+      NULL,
+      1,
+      &portalTaskHandle,
+      0  // core 0
+    );
+    return false;
+  }
+
+  Serial.println("Failed to connect to WiFi");
+  setAppState(DISCONNECTED);
+  return false;
 }
 
 void resetConfig() {
   Serial.println("Resetting WiFi configuration...");
-  WiFiManager wm;
-  wm.resetSettings();
+  wifiManager.resetSettings();
 
   preferences.begin("clock-config", false);
   preferences.clear();
@@ -265,33 +450,75 @@ String getNTPServer() {
   return ntp_server;
 }
 
+String getTelemetryCollector() {
+  return String(telemetry_buffer);
+}
+
 bool getPowersafeMode() {
   return powersafe_mode;
 }
 
+bool wasFastReconnect() {
+  return lastReconnectFast;
+}
+
 bool reconnectWifi() {
   Serial.println("Reconnecting to WiFi...");
+  TASK_TRACE_SCOPE("wifi_reconnect");
   setAppState(CONNECTING);
+  // With the radio off, a double click sync first shows the WiFi icon.
+  inputLatencyApplied(INPUT_DOUBLE_CLICK);
+  unsigned long start = millis();
+  lastReconnectFast = false;
 
+  energyRadioOn();
   WiFi.mode(WIFI_STA);
-  WiFi.begin();
 
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-    delay(500);
-    Serial.print(".");
-    attempts++;
+  wifi_config_t conf = {};
+  bool haveCredentials = esp_wifi_get_config(WIFI_IF_STA, &conf) == ESP_OK && conf.sta.ssid[0] != '\0';
+
+  if (haveCredentials && fastReconnect(conf)) {
+    lastReconnectFast = true;
+    metricsAdd(METRIC_WIFI_FAST_RECONNECTS, 1);
   }
+  else {
+    // Begin without the cached BSSID and channel so a moved or replaced
+    // access point is found by a full scan.
+    if (haveCredentials) {
+      WiFi.begin((const char*)conf.sta.ssid, (const char*)conf.sta.password);
+    }
+    else {
+      WiFi.begin();
+    }
+
+    int attempts = 0;
+    while (WiFi.status() != WL_CONNECTED && attempts < 20) {
+      delay(500);
+      Serial.print(".");
+      attempts++;
+    }
+    metricsAdd(METRIC_WIFI_FULL_RECONNECTS, 1);
+  }
+
+  unsigned long reconnectMs = millis() - start;
+  metricsSet(METRIC_WIFI_RECONNECT_LAST_MS, reconnectMs);
+  metricsAdd(METRIC_WIFI_RECONNECT_TOTAL_MS, reconnectMs);
+  energyAddReconnectWait(reconnectMs);
 
   if (WiFi.status() == WL_CONNECTED) {
     Serial.println("\nWiFi reconnected!");
     Serial.print("IP Address: ");
     Serial.println(WiFi.localIP());
+    if (!lastReconnectFast) {
+      saveLinkCache();
+    }
     setAppState(CONNECTED_NOT_SYNCED);
     return true;
   }
 
   Serial.println("\nReconnect failed, falling back to full connect...");
+  metricsAdd(METRIC_WIFI_RECONNECT_FAILURES, 1);
+  telemetryEvent("wifi_reconnect_failed", 1);
   return connectWifi();
 }
 
@@ -12,18 +12,25 @@ String getTimezone();
 String getTimezoneIana();
 bool isIanaFormat(const char* tz);
 String getNTPServer();
+// Empty when telemetry is disabled.
+String getTelemetryCollector();
 String getDefaultFaceId();
 
 // Lifecycle
 // Returns true if WiFi was previously configured.
 bool loadConfig();
 
-// Returns true if WiFi connected successfully.
+// Returns true if WiFi connected successfully. Returns false right away
+// when the configuration portal had to be opened; it keeps running in the
+// background and applies the saved settings once the clock connects.
 bool connectWifi();
+bool isConfigPortalActive();
 void resetConfig();
 
 // Returns true if WiFi reconnected successfully.
 bool reconnectWifi();
+// Returns true if the last reconnect joined the cached access point directly.
+bool wasFastReconnect();
 bool getPowersafeMode();
 void saveDefaultFaceId(const char* id);
 
@@ -9,57 +9,90 @@
 #include "timing_constants.h"
 #include "pins.h"
 #include "config.h"
+#include "clock_source.h"
+#include "metrics.h"
+#include "task_trace.h"
+#include "input_latency.h"
+#include "render_watchdog.h"
 #if !DISABLE_ENCODER
   #include "face_manager.h"
 #endif
 
-#if SCREENSHOT_MODE
-  CapturableTFT TFT_display(PIN_RST, PIN_DC, PIN_CS);
-#else
-  DIYables_TFT_GC9A01_Round TFT_display(PIN_RST, PIN_DC, PIN_CS);
-#endif
+ShadowTFT TFT_display(PIN_RST, PIN_DC, PIN_CS);
 
 static SemaphoreHandle_t displayMutex = NULL;
 static ClockFace* activeFace = NULL;
 
+int64_t getDisplayWallClockUs() {
+  return clockSourceWallUs();
+}
+
+bool getDisplayTimeMs(struct tm* timeinfo, int* millisecond) {
+  // Unlike getLocalTime() this never waits for the first sync and keeps the
+  // sub-second part SNTP delivers.
+  int64_t wallUs = getDisplayWallClockUs();
+  if (wallUs < 0) {
+    return false;
+  }
+  time_t seconds = (time_t)(wallUs / 1000000LL);
+  localtime_r(&seconds, timeinfo);
+  if (millisecond != NULL) {
+    *millisecond = (int)((wallUs % 1000000LL) / 1000);
+  }
+  return true;
+}
+
 bool getDisplayTime(struct tm* timeinfo) {
-  #if SCREENSHOT_MODE
-    *timeinfo = {};
-    timeinfo->tm_year = SCREENSHOT_YEAR - 1900;
-    timeinfo->tm_mon  = SCREENSHOT_MONTH - 1;
-    timeinfo->tm_mday = SCREENSHOT_DAY;
-    timeinfo->tm_hour = SCREENSHOT_HOUR;
-    timeinfo->tm_min  = SCREENSHOT_MIN;
-    timeinfo->tm_sec  = 0;
-    mktime(timeinfo);
-    return true;
-  #else
-    return getLocalTime(timeinfo);
-  #endif
+  return getDisplayTimeMs(timeinfo, NULL);
+}
+
+bool displayCopyShadowStrip(int strip, uint16_t* outBuffer, uint32_t* tileGenerations) {
+  if (!TFT_display.hasShadow()) {
+    return false;
+  }
+  takeDisplayMutex();
+  memcpy(outBuffer, TFT_display.shadowStrip(strip), SCREEN_WIDTH * SHADOW_STRIP_HEIGHT * sizeof(uint16_t));
+  if (tileGenerations != NULL) {
+    memcpy(tileGenerations, TFT_display.tileGenerations(strip), SHADOW_TILES_PER_ROW * sizeof(uint32_t));
+  }
+  giveDisplayMutex();
+  return true;
 }
 
-#if SCREENSHOT_MODE
-  void screenshotCaptureStrip(int stripY0, uint16_t* outBuffer) {
-    struct tm timeinfo;
-    TFT_display.beginCapture(stripY0);
-    if (activeFace != NULL && getDisplayTime(&timeinfo)) {
-      activeFace->reset();
-      DrawContext ctx = { CONNECTED_SYNCED, false, timeinfo, false };
-      activeFace->draw(ctx);
+uint32_t displayNextShadowGeneration(uint32_t since, bool* changedStrips) {
+  takeDisplayMutex();
+  uint32_t generation = TFT_display.nextGeneration();
+  if (changedStrips != NULL) {
+    for (int strip = 0; strip < SHADOW_STRIP_COUNT; strip++) {
+      const uint32_t* generations = TFT_display.tileGenerations(strip);
+      changedStrips[strip] = false;
+      for (int tile = 0; tile < SHADOW_TILES_PER_ROW; tile++) {
+        if (generations[tile] >= since) {
+          changedStrips[strip] = true;
+          break;
+        }
+      }
     }
-    TFT_display.endCapture();
-    memcpy(outBuffer, TFT_display.stripBuffer(), SCREEN_WIDTH * CAPTURE_STRIP_HEIGHT * sizeof(uint16_t));
   }
-#endif
+  giveDisplayMutex();
+  return generation;
+}
 
 void takeDisplayMutex() {
   if (displayMutex != NULL) {
+    TASK_TRACE_BEGIN("display_mutex_wait");
+    uint32_t waitStartMs = renderWatchdogMutexWait();
     xSemaphoreTake(displayMutex, portMAX_DELAY);
+    renderWatchdogMutexTaken(waitStartMs);
+    TASK_TRACE_END("display_mutex_wait");
+    TASK_TRACE_BEGIN("display_mutex");
   }
 }
 
 void giveDisplayMutex() {
   if (displayMutex != NULL) {
+    TASK_TRACE_END("display_mutex");
+    renderWatchdogMutexGiven();
     xSemaphoreGive(displayMutex);
   }
 }
@@ -67,6 +100,27 @@ void giveDisplayMutex() {
 void displaySetup() {
   displayMutex = xSemaphoreCreateMutex();
   Serial.println("Display mutex created.");
+
+  #if DISABLE_SHADOW_FRAMEBUFFER
+    Serial.println("Shadow framebuffer not built in, screenshots disabled.");
+  #else
+    if (TFT_display.allocateShadow()) {
+      metricsSet(METRIC_SHADOW_FRAMEBUFFER_BYTES, SHADOW_FRAMEBUFFER_BYTES);
+      Serial.println("Shadow framebuffer allocated.");
+    }
+    else {
+      Serial.println("Not enough heap for the shadow framebuffer, screenshots disabled.");
+    }
+  #endif
+
+  #if DISPLAY_TRACE
+    if (displayTraceSetup()) {
+      Serial.println("Display trace ring allocated.");
+    }
+    else {
+      Serial.println("Not enough heap for the display trace ring, tracing disabled.");
+    }
+  #endif
 }
 
 void setClockFace(ClockFace* face) {
@@ -79,6 +133,8 @@ void setClockFace(ClockFace* face) {
     static const int ARC_RADIUS = 117;
     static const float ARC_STEP_DEG = 0.5f;
     static const uint16_t ARC_COLOR = DIYables_TFT::colorRGB(0, 220, 255);
+    RENDER_WATCHDOG_STAGE(RENDER_STAGE_OVERLAY);
+    RENDER_PROFILE_STAGE(RENDER_STAGE_OVERLAY);
 
     float filledDeg = fraction * 360.0f;
     for (float angle = 0.0f; angle < 360.0f; angle += ARC_STEP_DEG) {
@@ -103,31 +159,52 @@ void redrawDisplay() {
   if (activeFace == NULL) {
     return;
   }
+  TASK_TRACE_SCOPE("redraw");
+  renderWatchdogCrumb(CRUMB_REDRAW);
+
+  #if DISPLAY_TRACE
+    displayTraceFrame();
+  #endif
 
   struct tm timeinfo;
   static bool blinkState = false;
   static unsigned long lastBlink = 0;
   static AppState lastState = NOT_CONFIGURED;
+  // lastState starts as NOT_CONFIGURED, so it can not tell whether the
+  // setup instructions are on the screen yet.
+  static bool setupInstructionsShown = false;
 
-  unsigned long now = millis();
+  unsigned long now = clockSourceMillis();
   if (now - lastBlink >= BLINK_INTERVAL_MS) {
     blinkState = !blinkState;
     lastBlink = now;
   }
 
   AppState state = getAppState();
+  if (state != NOT_CONFIGURED) {
+    setupInstructionsShown = false;
+  }
 
   if (state == RESET_PENDING) {
     if (lastState != state) {
+      renderWatchdogCrumb(CRUMB_RESET_QUESTION);
       displayResetQuestion();
     }
     lastState = state;
+    inputLatencyFrameShown();
+    renderWatchdogFrameDone();
     return;
   }
 
   if (state == NOT_CONFIGURED) {
-    displayWifiSetupInstructions();
+    // A full-screen repaint; drawn once, not on every blink frame.
+    if (!setupInstructionsShown) {
+      renderWatchdogCrumb(CRUMB_SETUP_INSTRUCTIONS);
+      displayWifiSetupInstructions();
+      setupInstructionsShown = true;
+    }
     lastState = state;
+    renderWatchdogFrameDone();
     return;
   }
 
@@ -144,6 +221,9 @@ void redrawDisplay() {
     #endif
 
     DrawContext ctx = { state, blinkState, timeinfo, gracePeriodActive };
+    RENDER_PROFILE_FRAME(activeFace->getId());
+    renderWatchdogFace(activeFace->getId());
+    unsigned long drawStartUs = micros();
     activeFace->draw(ctx);
 
     #if !DISABLE_ENCODER
@@ -151,22 +231,18 @@ void redrawDisplay() {
         drawGracePeriodOverlay(faceManagerGetGracePeriodFraction());
       }
     #endif
-  }
-}
-
-void displayWifiError() {
-  TFT_display.fillScreen(COLOR_BACKGROUND);
-  TFT_display.setTextColor(COLOR_RED, COLOR_BACKGROUND);
-  TFT_display.setTextSize(2);
-
-  static char str1[] = "WiFi Failed";
-  static char str2[] = "Restarting...";
 
-  TFT_display.setCursor((SCREEN_WIDTH - (strlen(str1) * 12)) / 2, CENTER_Y - 20);
-  TFT_display.print(str1);
-  TFT_display.setTextSize(2);
-  TFT_display.setCursor((SCREEN_WIDTH - (strlen(str2) * 12)) / 2, CENTER_Y + 15);
-  TFT_display.print(str2);
+    uint32_t drawUs = micros() - drawStartUs;
+    metricsAdd(METRIC_FRAMES, 1);
+    metricsSet(METRIC_FRAME_DRAW_LAST_US, drawUs);
+    metricsAdd(METRIC_FRAME_DRAW_TOTAL_US, drawUs);
+    if (drawUs > metricsGet(METRIC_FRAME_DRAW_MAX_US)) {
+      metricsSet(METRIC_FRAME_DRAW_MAX_US, drawUs);
+    }
+    metricsAddLabeled(METRIC_FAMILY_FACE_REDRAWS, activeFace->getId(), 1);
+    inputLatencyFrameShown();
+  }
+  renderWatchdogFrameDone();
 }
 
 void displayResetQuestion() {
@@ -2,62 +2,213 @@
 #define DISPLAY_H
 
 #include <time.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Arduino.h"
 #include <DIYables_TFT_Round.h>
 #include "display_constants.h"
 #include "clock_face.h"
-
-#if SCREENSHOT_MODE
-
-#define CAPTURE_STRIP_HEIGHT 16
-
-class CapturableTFT : public DIYables_TFT_GC9A01_Round {
+#include "display_trace.h"
+#include "render_profile.h"
+#include "render_watchdog.h"
+
+#define SHADOW_STRIP_HEIGHT 16
+#define SHADOW_STRIP_COUNT (SCREEN_HEIGHT / SHADOW_STRIP_HEIGHT)
+// Square tiles one strip high, used to track which parts of the screen changed.
+#define SHADOW_TILE_SIZE SHADOW_STRIP_HEIGHT
+#define SHADOW_TILES_PER_ROW (SCREEN_WIDTH / SHADOW_TILE_SIZE)
+// The largest allocation of the firmware. Builds with
+// -DDISABLE_SHADOW_FRAMEBUFFER=1 leave it out, and with it screenshots, the
+// live mirror and serial dumps.
+#define SHADOW_FRAMEBUFFER_BYTES (SCREEN_WIDTH * SCREEN_HEIGHT * 2)
+
+// Keeps a copy of everything drawn on the panel so screenshots can be served
+// without redrawing. The copy is split into strips because the heap rarely
+// has a single free block the size of the whole frame.
+//
+// Every tile also remembers the generation it was last written in. Readers
+// advance the generation with nextGeneration() and later pick the tiles
+// written since, which is what live mirroring sends.
+//
+// drawPixel() and fillScreen() are also timed with the cycle counter. Every
+// other drawing call ends up in them, and they wait for their SPI transfer
+// to finish, so the sum is the time the panel's SPI bus was busy.
+//
+// With DISPLAY_TRACE or RENDER_PROFILE the drawing calls used by the firmware
+// are wrapped as well and recorded by display_trace.cpp or counted by
+// render_profile.cpp.
+class ShadowTFT : public DIYables_TFT_GC9A01_Round {
 public:
-  CapturableTFT(uint8_t resPin, uint8_t dcPin, uint8_t csPin)
+  ShadowTFT(uint8_t resPin, uint8_t dcPin, uint8_t csPin)
     : DIYables_TFT_GC9A01_Round(resPin, dcPin, csPin),
-      _captureActive(false),
-      _stripY0(0),
-      _stripY1(0) {}
+      _shadowReady(false),
+      _generation(1),
+      _spiCycles(0) {
+    memset(_strips, 0, sizeof(_strips));
+    memset(_tileGenerations, 0, sizeof(_tileGenerations));
+  }
 
-  void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+  DISPLAY_TRACED void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+    DISPLAY_TRACE_CALL(TRACE_DRAW_PIXEL, x, y, 0, 0, color);
+    RENDER_PROFILE_CALL();
+    RENDER_PROFILE_PIXELS(1, RENDER_PROFILE_WINDOW_BYTES + 2);
+    uint32_t startCycles = ESP.getCycleCount();
     DIYables_TFT_GC9A01_Round::drawPixel(x, y, color);
-    if (_captureActive && y >= _stripY0 && y < _stripY1) {
-      _stripBuffer[(y - _stripY0) * SCREEN_WIDTH + x] = color;
+    _spiCycles += ESP.getCycleCount() - startCycles;
+    if (_shadowReady && x >= 0 && x < SCREEN_WIDTH && y >= 0 && y < SCREEN_HEIGHT) {
+      _strips[y / SHADOW_STRIP_HEIGHT][(y % SHADOW_STRIP_HEIGHT) * SCREEN_WIDTH + x] = color;
+      _tileGenerations[y / SHADOW_TILE_SIZE][x / SHADOW_TILE_SIZE] = _generation;
     }
   }
 
-  void fillScreen(uint16_t color) override {
+  DISPLAY_TRACED void fillScreen(uint16_t color) override {
+    DISPLAY_TRACE_CALL(TRACE_FILL_SCREEN, 0, 0, 0, 0, color);
+    RENDER_PROFILE_CALL();
+    RENDER_PROFILE_PIXELS(SCREEN_WIDTH * SCREEN_HEIGHT, RENDER_PROFILE_WINDOW_BYTES + SCREEN_WIDTH * SCREEN_HEIGHT * 2);
+    uint32_t startCycles = ESP.getCycleCount();
     DIYables_TFT_GC9A01_Round::fillScreen(color);
-    if (_captureActive) {
-      for (int i = 0; i < SCREEN_WIDTH * CAPTURE_STRIP_HEIGHT; i++) {
-        _stripBuffer[i] = color;
+    _spiCycles += ESP.getCycleCount() - startCycles;
+    if (_shadowReady) {
+      for (int strip = 0; strip < SHADOW_STRIP_COUNT; strip++) {
+        for (int i = 0; i < SCREEN_WIDTH * SHADOW_STRIP_HEIGHT; i++) {
+          _strips[strip][i] = color;
+        }
+        for (int tile = 0; tile < SHADOW_TILES_PER_ROW; tile++) {
+          _tileGenerations[strip][tile] = _generation;
+        }
       }
     }
   }
 
-  void beginCapture(int stripY0) {
-    _stripY0 = stripY0;
-    _stripY1 = stripY0 + CAPTURE_STRIP_HEIGHT;
-    memset(_stripBuffer, 0, sizeof(_stripBuffer));
-    _captureActive = true;
+#if DISPLAY_TRACE || RENDER_PROFILE
+  DISPLAY_TRACED void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    DISPLAY_TRACE_CALL(TRACE_DRAW_LINE, x0, y0, x1, y1, color);
+    RENDER_PROFILE_CALL();
+    DIYables_TFT_GC9A01_Round::drawLine(x0, y0, x1, y1, color);
   }
 
-  void endCapture() {
-    _captureActive = false;
+  DISPLAY_TRACED void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    DISPLAY_TRACE_CALL(TRACE_DRAW_RECT, x, y, w, h, color);
+    RENDER_PROFILE_CALL();
+    DIYables_TFT_GC9A01_Round::drawRect(x, y, w, h, color);
   }
 
-  const uint16_t* stripBuffer() const {
-    return _stripBuffer;
+  DISPLAY_TRACED void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    DISPLAY_TRACE_CALL(TRACE_FILL_RECT, x, y, w, h, color);
+    RENDER_PROFILE_CALL();
+    DIYables_TFT_GC9A01_Round::fillRect(x, y, w, h, color);
   }
 
-private:
-  bool _captureActive;
-  int _stripY0;
-  int _stripY1;
-  uint16_t _stripBuffer[SCREEN_WIDTH * CAPTURE_STRIP_HEIGHT];
-};
+  DISPLAY_TRACED void drawCircle(int16_t x, int16_t y, int16_t r, uint16_t color) {
+    DISPLAY_TRACE_CALL(TRACE_DRAW_CIRCLE, x, y, r, 0, color);
+    RENDER_PROFILE_CALL();
+    DIYables_TFT_GC9A01_Round::drawCircle(x, y, r, color);
+  }
+
+  DISPLAY_TRACED void fillCircle(int16_t x, int16_t y, int16_t r, uint16_t color) {
+    DISPLAY_TRACE_CALL(TRACE_FILL_CIRCLE, x, y, r, 0, color);
+    RENDER_PROFILE_CALL();
+    DIYables_TFT_GC9A01_Round::fillCircle(x, y, r, color);
+  }
+
+  DISPLAY_TRACED void drawRGBBitmap(int16_t x, int16_t y, const uint16_t* bitmap, int16_t w, int16_t h) {
+    DISPLAY_TRACE_CALL(TRACE_DRAW_RGB_BITMAP, x, y, w, h, displayTraceBitmapHash(bitmap, w * h));
+    RENDER_PROFILE_CALL();
+    DIYables_TFT_GC9A01_Round::drawRGBBitmap(x, y, bitmap, w, h);
+  }
+
+  DISPLAY_TRACED void setCursor(int16_t x, int16_t y) {
+    DISPLAY_TRACE_CALL(TRACE_SET_CURSOR, x, y, 0, 0, 0);
+    RENDER_PROFILE_CALL();
+    DIYables_TFT_GC9A01_Round::setCursor(x, y);
+  }
+
+  DISPLAY_TRACED void setTextSize(uint8_t size) {
+    DISPLAY_TRACE_CALL(TRACE_SET_TEXT_SIZE, 0, 0, 0, 0, size);
+    RENDER_PROFILE_CALL();
+    DIYables_TFT_GC9A01_Round::setTextSize(size);
+  }
 
+  DISPLAY_TRACED void setTextColor(uint16_t color) {
+    DISPLAY_TRACE_CALL(TRACE_SET_TEXT_COLOR, 0, 0, 0, 0, color | ((uint32_t)color << 16));
+    RENDER_PROFILE_CALL();
+    DIYables_TFT_GC9A01_Round::setTextColor(color);
+  }
+
+  DISPLAY_TRACED void setTextColor(uint16_t color, uint16_t bg) {
+    DISPLAY_TRACE_CALL(TRACE_SET_TEXT_COLOR, 0, 0, 0, 0, color | ((uint32_t)bg << 16));
+    RENDER_PROFILE_CALL();
+    DIYables_TFT_GC9A01_Round::setTextColor(color, bg);
+  }
+
+  // print() ends up in write() one character at a time. The characters are
+  // recorded with the call site of the print() they came from, and each is
+  // counted as a call of its own.
+  #if DISPLAY_TRACE
+    template<typename T>
+    DISPLAY_TRACED size_t print(T value) {
+      displayTraceSetTextCaller(__builtin_return_address(0));
+      size_t written = DIYables_TFT_GC9A01_Round::print(value);
+      displayTraceSetTextCaller(NULL);
+      return written;
+    }
+  #endif
+
+  DISPLAY_TRACED size_t write(uint8_t c) override {
+    #if DISPLAY_TRACE
+      DisplayTraceScope traceScope(TRACE_WRITE_CHAR, displayTraceTextCaller(__builtin_return_address(0)), 0, 0, 0, 0, c);
+    #endif
+    RENDER_PROFILE_CALL();
+    return DIYables_TFT_GC9A01_Round::write(c);
+  }
+  using DIYables_TFT_GC9A01_Round::write;
 #endif
 
+  bool allocateShadow() {
+    for (int strip = 0; strip < SHADOW_STRIP_COUNT; strip++) {
+      _strips[strip] = (uint16_t*)calloc(SCREEN_WIDTH * SHADOW_STRIP_HEIGHT, sizeof(uint16_t));
+      if (_strips[strip] == NULL) {
+        for (int i = 0; i < strip; i++) {
+          free(_strips[i]);
+          _strips[i] = NULL;
+        }
+        return false;
+      }
+    }
+    _shadowReady = true;
+    return true;
+  }
+
+  bool hasShadow() const {
+    return _shadowReady;
+  }
+
+  const uint16_t* shadowStrip(int strip) const {
+    return _strips[strip];
+  }
+
+  const uint32_t* tileGenerations(int strip) const {
+    return _tileGenerations[strip];
+  }
+
+  // Returns the generation being written and starts a new one.
+  uint32_t nextGeneration() {
+    return _generation++;
+  }
+
+  // CPU cycles spent in SPI transfers so far; wraps.
+  uint32_t spiCycles() const {
+    return _spiCycles;
+  }
+
+private:
+  bool _shadowReady;
+  uint16_t* _strips[SHADOW_STRIP_COUNT];
+  uint32_t _generation;
+  uint32_t _tileGenerations[SHADOW_STRIP_COUNT][SHADOW_TILES_PER_ROW];
+  volatile uint32_t _spiCycles;
+};
+
 // Colors
 #define COLOR_BACKGROUND DIYables_TFT::colorRGB(0, 0, 0)
 #define COLOR_CLOCKFACE DIYables_TFT::colorRGB(255, 255, 255)
@@ -65,12 +216,16 @@ private:
 #define COLOR_YELLOW DIYables_TFT::colorRGB(255, 255, 0)
 #define COLOR_RED DIYables_TFT::colorRGB(255, 0, 0)
 
-#if SCREENSHOT_MODE
-  extern CapturableTFT TFT_display;
-  void screenshotCaptureStrip(int stripY0, uint16_t* outBuffer);
-#else
-  extern DIYables_TFT_GC9A01_Round TFT_display;
-#endif
+extern ShadowTFT TFT_display;
+
+// Copies one strip of the shadow framebuffer under the display mutex, and
+// the generations of its tiles when tileGenerations is not NULL.
+// Returns false when the shadow could not be allocated.
+bool displayCopyShadowStrip(int strip, uint16_t* outBuffer, uint32_t* tileGenerations = NULL);
+// Closes the current shadow generation and returns it. Tiles written after
+// this call carry a higher generation. When changedStrips is not NULL it is
+// set for every strip with a tile of generation since or later.
+uint32_t displayNextShadowGeneration(uint32_t since = 0, bool* changedStrips = NULL);
 
 void takeDisplayMutex();
 void giveDisplayMutex();
@@ -78,10 +233,12 @@ void giveDisplayMutex();
 void displaySetup();
 
 void setClockFace(ClockFace* face);
+// Wall clock in microseconds, negative while the time is not known.
+int64_t getDisplayWallClockUs();
 bool getDisplayTime(struct tm* timeinfo);
+bool getDisplayTimeMs(struct tm* timeinfo, int* millisecond);
 void redrawDisplay();
 
-void displayWifiError();
 void displaySyncError();
 void displayResetQuestion();
 void displayWifiSetupInstructions();
@@ -0,0 +1,117 @@
+#include "Arduino.h"
+#include "display_trace.h"
+#include "display.h"
+#include "image_encoder.h"
+
+// Also used by host/trace_replay to recognise the bitmaps in a trace.
+uint32_t displayTraceBitmapHash(const uint16_t* pixels, int count) {
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < count; i++) {
+    hash = (hash ^ (pixels[i] & 0xFF)) * 16777619u;
+    hash = (hash ^ (pixels[i] >> 8)) * 16777619u;
+  }
+  return hash;
+}
+
+#if DISPLAY_TRACE
+
+static DisplayTraceRecord* ring = NULL;
+static uint32_t ringNext = 0;
+static uint32_t ringCount = 0;
+static uint32_t frameNumber = 0;
+static int depth = 0;
+static bool paused = false;
+static void* textCaller = NULL;
+
+// Written by the render loop under the display mutex, so the ring needs no
+// lock of its own.
+static void append(const DisplayTraceRecord& record) {
+  if (ring == NULL || paused) {
+    return;
+  }
+  ring[ringNext] = record;
+  ringNext = (ringNext + 1) % DISPLAY_TRACE_RECORDS;
+  if (ringCount < DISPLAY_TRACE_RECORDS) {
+    ringCount++;
+  }
+}
+
+bool displayTraceSetup() {
+  ring = (DisplayTraceRecord*)calloc(DISPLAY_TRACE_RECORDS, sizeof(DisplayTraceRecord));
+  return ring != NULL;
+}
+
+void displayTraceFrame() {
+  DisplayTraceRecord record = {};
+  record.timeUs = micros();
+  record.value = ++frameNumber;
+  record.op = TRACE_FRAME;
+  append(record);
+}
+
+void displayTraceSetTextCaller(void* caller) {
+  textCaller = caller;
+}
+
+void* displayTraceTextCaller(void* fallback) {
+  return textCaller != NULL ? textCaller : fallback;
+}
+
+void displayTraceWrite(ImageWriteFn write, void* context) {
+  takeDisplayMutex();
+  paused = true;
+  uint32_t count = ringCount;
+  uint32_t first = (ringNext + DISPLAY_TRACE_RECORDS - ringCount) % DISPLAY_TRACE_RECORDS;
+  giveDisplayMutex();
+
+  DisplayTraceHeader header;
+  memcpy(header.magic, DISPLAY_TRACE_MAGIC, sizeof(header.magic));
+  header.version = DISPLAY_TRACE_VERSION;
+  header.recordSize = sizeof(DisplayTraceRecord);
+  header.count = count;
+  write((const uint8_t*)&header, sizeof(header), context);
+
+  // Whole records per write, at most about one encoder chunk at a time.
+  const uint32_t perWrite = IMAGE_ENCODER_CHUNK_SIZE / sizeof(DisplayTraceRecord);
+  uint32_t done = 0;
+  while (done < count) {
+    uint32_t index = (first + done) % DISPLAY_TRACE_RECORDS;
+    uint32_t n = count - done;
+    n = n < perWrite ? n : perWrite;
+    n = n < DISPLAY_TRACE_RECORDS - index ? n : DISPLAY_TRACE_RECORDS - index;
+    write((const uint8_t*)&ring[index], n * sizeof(DisplayTraceRecord), context);
+    done += n;
+  }
+
+  takeDisplayMutex();
+  paused = false;
+  giveDisplayMutex();
+}
+
+DisplayTraceScope::DisplayTraceScope(DisplayTraceOp op, void* caller, int16_t a, int16_t b, int16_t c, int16_t d, uint32_t value) {
+  _outermost = depth++ == 0;
+  if (!_outermost) {
+    return;
+  }
+  _record.timeUs = micros();
+  _record.caller = (uint32_t)(uintptr_t)caller;
+  _record.value = value;
+  _record.args[0] = a;
+  _record.args[1] = b;
+  _record.args[2] = c;
+  _record.args[3] = d;
+  _record.op = op;
+  _record.reserved = 0;
+}
+
+DisplayTraceScope::~DisplayTraceScope() {
+  depth--;
+  if (!_outermost) {
+    return;
+  }
+  uint32_t elapsed = micros() - _record.timeUs;
+  _record.durationUs = elapsed < 0xFFFF ? elapsed : 0xFFFF;
+  append(_record);
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef DISPLAY_TRACE_H
+#define DISPLAY_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "text_writer.h"
+
+// Display command trace. Built with -DDISPLAY_TRACE=1, every call made on
+// TFT_display goes into a RAM ring with its start time, duration and call
+// site, and /trace serves the ring as a file for host/trace_replay. Calls
+// made by the library itself, such as the pixels of a fillCircle(), are
+// part of the outer call and not recorded on their own.
+
+#ifndef DISPLAY_TRACE_RECORDS
+  #define DISPLAY_TRACE_RECORDS 1024
+#endif
+
+#define DISPLAY_TRACE_MAGIC "TFTTRACE"
+#define DISPLAY_TRACE_VERSION 1
+
+enum DisplayTraceOp {
+  TRACE_FRAME,
+  TRACE_DRAW_PIXEL,
+  TRACE_FILL_SCREEN,
+  TRACE_DRAW_LINE,
+  TRACE_DRAW_RECT,
+  TRACE_FILL_RECT,
+  TRACE_DRAW_CIRCLE,
+  TRACE_FILL_CIRCLE,
+  TRACE_DRAW_RGB_BITMAP,
+  TRACE_SET_CURSOR,
+  TRACE_SET_TEXT_SIZE,
+  TRACE_SET_TEXT_COLOR,
+  TRACE_WRITE_CHAR,
+  TRACE_OP_COUNT
+};
+
+// One call, stored and written little-endian exactly as laid out here.
+//
+//   args   x, y, w, h / x0, y0, x1, y1 / x, y, r as the call takes them
+//   value  color; for text colors color | background << 16; the character
+//          for TRACE_WRITE_CHAR; the text size; an FNV-1a hash of the
+//          pixels for TRACE_DRAW_RGB_BITMAP; the frame number for
+//          TRACE_FRAME
+struct __attribute__((packed)) DisplayTraceRecord {
+  uint32_t timeUs;
+  uint32_t caller;
+  uint32_t value;
+  int16_t args[4];
+  uint16_t durationUs;
+  uint8_t op;
+  uint8_t reserved;
+};
+static_assert(sizeof(DisplayTraceRecord) == 24, "trace records are read by host tools");
+
+// The file served by /trace: this header followed by count records, oldest
+// first.
+struct __attribute__((packed)) DisplayTraceHeader {
+  char magic[8];
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t count;
+};
+
+bool displayTraceSetup();
+// Marks the start of a frame. Called by redrawDisplay().
+void displayTraceFrame();
+uint32_t displayTraceBitmapHash(const uint16_t* pixels, int count);
+// Call site of the print() being drawn, or NULL outside print().
+void displayTraceSetTextCaller(void* caller);
+// The print() call site if one is set, otherwise fallback.
+void* displayTraceTextCaller(void* fallback);
+// Writes the ring as a trace file. Recording pauses while it runs; call it
+// without holding the display mutex.
+void displayTraceWrite(ImageWriteFn write, void* context);
+
+// Records the call it is created in, unless it runs inside another recorded
+// call.
+class DisplayTraceScope {
+public:
+  DisplayTraceScope(DisplayTraceOp op, void* caller, int16_t a, int16_t b, int16_t c, int16_t d, uint32_t value);
+  ~DisplayTraceScope();
+
+private:
+  DisplayTraceRecord _record;
+  bool _outermost;
+};
+
+#if DISPLAY_TRACE
+  #define DISPLAY_TRACE_CALL(op, a, b, c, d, value) \
+    DisplayTraceScope traceScope(op, __builtin_return_address(0), a, b, c, d, value)
+  // Keeps the recorded methods out of line so the return address is the
+  // call site in the face code.
+  #define DISPLAY_TRACED __attribute__((noinline))
+#else
+  #define DISPLAY_TRACE_CALL(op, a, b, c, d, value)
+  #define DISPLAY_TRACED
+#endif
+
+#endif
@@ -0,0 +1,199 @@
+#include <WiFi.h>
+#include <time.h>
+#include "Arduino.h"
+#include "dns_cache.h"
+#include "timing_constants.h"
+#include "metrics.h"
+
+#define DNS_CACHE_MAGIC 0x444E5331UL
+
+static const int DNS_CACHE_NAME_COUNT = 6;
+static const int DNS_CACHE_ADDRS_PER_NAME = 3;
+static const int DNS_CACHE_NAME_MAX = 48;
+static const uint16_t RTT_UNKNOWN = 0xFFFF;
+static const uint8_t MAX_FAILURES = 3;
+
+struct DnsCacheAddress {
+  uint32_t ip;
+  uint16_t rttMs;
+  uint8_t failures;
+};
+
+struct DnsCacheEntry {
+  char name[DNS_CACHE_NAME_MAX];
+  time_t expiresAt;
+  uint32_t lastUsed;
+  uint8_t count;
+  DnsCacheAddress addresses[DNS_CACHE_ADDRS_PER_NAME];
+};
+
+struct DnsCacheTable {
+  uint32_t magic;
+  uint32_t useCounter;
+  DnsCacheEntry entries[DNS_CACHE_NAME_COUNT];
+};
+
+// RTC memory keeps the table across power save radio cycles and soft resets.
+RTC_DATA_ATTR static DnsCacheTable table;
+
+static void ensureInitialized() {
+  if (table.magic != DNS_CACHE_MAGIC) {
+    memset(&table, 0, sizeof(table));
+    table.magic = DNS_CACHE_MAGIC;
+  }
+}
+
+static DnsCacheEntry* findEntry(const char* name) {
+  for (int i = 0; i < DNS_CACHE_NAME_COUNT; i++) {
+    if (table.entries[i].name[0] != '\0' && strcmp(table.entries[i].name, name) == 0) {
+      return &table.entries[i];
+    }
+  }
+  return nullptr;
+}
+
+static DnsCacheEntry* allocateEntry(const char* name) {
+  DnsCacheEntry* victim = &table.entries[0];
+  for (int i = 0; i < DNS_CACHE_NAME_COUNT; i++) {
+    if (table.entries[i].name[0] == '\0') {
+      victim = &table.entries[i];
+      break;
+    }
+    if (table.entries[i].lastUsed < victim->lastUsed) {
+      victim = &table.entries[i];
+    }
+  }
+  memset(victim, 0, sizeof(*victim));
+  strncpy(victim->name, name, DNS_CACHE_NAME_MAX - 1);
+  return victim;
+}
+
+static DnsCacheAddress* findAddress(DnsCacheEntry* entry, uint32_t ip) {
+  for (int i = 0; i < entry->count; i++) {
+    if (entry->addresses[i].ip == ip) {
+      return &entry->addresses[i];
+    }
+  }
+  return nullptr;
+}
+
+static void addAddress(DnsCacheEntry* entry, uint32_t ip) {
+  if (findAddress(entry, ip) != nullptr) {
+    return;
+  }
+
+  DnsCacheAddress* slot;
+  if (entry->count < DNS_CACHE_ADDRS_PER_NAME) {
+    slot = &entry->addresses[entry->count++];
+  }
+  else {
+    // Replace the address with the most failures, then the slowest one.
+    slot = &entry->addresses[0];
+    for (int i = 1; i < entry->count; i++) {
+      DnsCacheAddress* candidate = &entry->addresses[i];
+      if (
+        candidate->failures > slot->failures
+        || (candidate->failures == slot->failures && candidate->rttMs > slot->rttMs)
+      ) {
+        slot = candidate;
+      }
+    }
+  }
+  slot->ip = ip;
+  slot->rttMs = RTT_UNKNOWN;
+  slot->failures = 0;
+}
+
+static const DnsCacheAddress* bestAddress(const DnsCacheEntry* entry) {
+  const DnsCacheAddress* best = nullptr;
+  for (int i = 0; i < entry->count; i++) {
+    const DnsCacheAddress* candidate = &entry->addresses[i];
+    if (
+      best == nullptr
+      || candidate->failures < best->failures
+      || (candidate->failures == best->failures && candidate->rttMs < best->rttMs)
+    ) {
+      best = candidate;
+    }
+  }
+  return best;
+}
+
+static bool isFresh(const DnsCacheEntry* entry) {
+  time_t now = time(nullptr);
+  // Before the first sync the wall clock is meaningless, so nothing is fresh.
+  if (now < DNS_CACHE_VALID_AFTER_EPOCH) {
+    return false;
+  }
+  return now < entry->expiresAt;
+}
+
+bool dnsCacheLookup(const char* name, IPAddress& address) {
+  if (name == nullptr || name[0] == '\0') {
+    return false;
+  }
+
+  // Numeric addresses need no resolving.
+  if (address.fromString(name)) {
+    return true;
+  }
+
+  ensureInitialized();
+  DnsCacheEntry* entry = findEntry(name);
+
+  const DnsCacheAddress* best = entry != nullptr ? bestAddress(entry) : nullptr;
+  if (best != nullptr && best->failures < MAX_FAILURES && isFresh(entry)) {
+    entry->lastUsed = ++table.useCounter;
+    address = IPAddress(best->ip);
+    metricsAdd(METRIC_DNS_CACHE_HITS, 1);
+    return true;
+  }
+
+  metricsAdd(METRIC_DNS_CACHE_MISSES, 1);
+  IPAddress resolved;
+  if (WiFi.hostByName(name, resolved) == 1 && (uint32_t)resolved != 0) {
+    if (entry == nullptr) {
+      entry = allocateEntry(name);
+    }
+    addAddress(entry, (uint32_t)resolved);
+    entry->expiresAt = time(nullptr) + DNS_CACHE_TTL_S;
+    entry->lastUsed = ++table.useCounter;
+
+    // A fresh answer may still lose to a known faster address of the pool.
+    best = bestAddress(entry);
+    address = IPAddress(best->ip);
+    return true;
+  }
+
+  if (best != nullptr) {
+    Serial.print("DNS failed, using stale address for ");
+    Serial.println(name);
+    entry->lastUsed = ++table.useCounter;
+    address = IPAddress(best->ip);
+    metricsAdd(METRIC_DNS_STALE_FALLBACKS, 1);
+    return true;
+  }
+
+  return false;
+}
+
+void dnsCacheReportResult(const char* name, const IPAddress& address, bool ok, uint32_t rttMs) {
+  ensureInitialized();
+  DnsCacheEntry* entry = findEntry(name);
+  if (entry == nullptr) {
+    return;
+  }
+
+  DnsCacheAddress* cached = findAddress(entry, (uint32_t)address);
+  if (cached == nullptr) {
+    return;
+  }
+
+  if (ok) {
+    cached->rttMs = rttMs < RTT_UNKNOWN ? (uint16_t)rttMs : RTT_UNKNOWN - 1;
+    cached->failures = 0;
+  }
+  else if (cached->failures < MAX_FAILURES) {
+    cached->failures++;
+  }
+}
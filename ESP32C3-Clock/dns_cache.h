@@ -0,0 +1,17 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <cstdint>
+#include <IPAddress.h>
+
+// Returns the address to use for the host name. Resolves through DNS when the
+// name is unknown or its TTL expired, and falls back to the stale entry when
+// DNS can not be reached. Of several known addresses the one that answered
+// fastest last time wins.
+bool dnsCacheLookup(const char* name, IPAddress& address);
+
+// Feeds back how the address performed so the next lookup can prefer it or
+// move on to another one.
+void dnsCacheReportResult(const char* name, const IPAddress& address, bool ok, uint32_t rttMs);
+
+#endif
@@ -0,0 +1,332 @@
+#include <stddef.h>
+#include "Arduino.h"
+#include "esp_freertos_hooks.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "energy.h"
+#include "display.h"
+
+#define ENERGY_CORES 2
+
+static const uint32_t LEDGER_MAGIC = 0x454e5231;  // "ENR1"
+static const uint32_t HOUR_MS = 60UL * 60UL * 1000UL;
+static const uint32_t DAY_MS = 24UL * HOUR_MS;
+
+static const char* WINDOW_NAMES[ENERGY_WINDOW_COUNT] = {
+  "hour",
+  "last_hour",
+  "day",
+  "last_day",
+};
+
+struct EnergyTotals {
+  uint32_t elapsedMs;
+  uint32_t radioOnMs;
+  uint32_t connectCycles;
+  uint32_t reconnectWaitMs;
+  uint32_t activeMs[ENERGY_CORES];
+  uint32_t idleMs[ENERGY_CORES];
+  uint32_t spiBusyMs;
+};
+
+struct EnergyLedger {
+  uint32_t magic;
+  EnergyTotals windows[ENERGY_WINDOW_COUNT];
+  uint32_t checksum;
+};
+
+// Left alone by the startup code, so it outlives a soft reset. After a
+// power cycle it holds noise, which the checksum rejects.
+RTC_NOINIT_ATTR static EnergyLedger ledger;
+
+// Counted by the tick hooks.
+static volatile uint32_t activeTicks[ENERGY_CORES];
+static volatile uint32_t idleTicks[ENERGY_CORES];
+
+// Collected from the WiFi code until the next sample.
+static bool radioOn = false;
+static uint32_t radioOnSinceMs = 0;
+static uint32_t pendingRadioOnMs = 0;
+static uint32_t pendingConnectCycles = 0;
+static uint32_t pendingReconnectWaitMs = 0;
+
+// Only used by energySample(), on the system monitor task.
+static bool ready = false;
+static uint32_t lastSampleMs = 0;
+static uint32_t lastActiveTicks[ENERGY_CORES];
+static uint32_t lastIdleTicks[ENERGY_CORES];
+static uint32_t lastSpiCycles = 0;
+static uint32_t spiRemainderCycles = 0;
+
+// Guards the pending figures and the ledger.
+static portMUX_TYPE energyLock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t ledgerChecksum() {
+  // FNV-1a over everything before the checksum.
+  const uint8_t* bytes = (const uint8_t*)&ledger;
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < offsetof(EnergyLedger, checksum); i++) {
+    hash = (hash ^ bytes[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+// Runs in the tick interrupt of each core, so the current task of the core
+// is the one the tick interrupted.
+static void IRAM_ATTR countTick() {
+  BaseType_t core = xPortGetCoreID();
+  if (xTaskGetCurrentTaskHandleForCPU(core) == xTaskGetIdleTaskHandleForCPU(core)) {
+    idleTicks[core]++;
+  }
+  else {
+    activeTicks[core]++;
+  }
+}
+
+void energySetup() {
+  if (ledger.magic == LEDGER_MAGIC && ledger.checksum == ledgerChecksum()) {
+    Serial.print("Energy windows kept, running day at ");
+    Serial.print(ledger.windows[ENERGY_DAY].elapsedMs / 1000);
+    Serial.println(" s.");
+  }
+  else {
+    memset(&ledger, 0, sizeof(ledger));
+    ledger.magic = LEDGER_MAGIC;
+    ledger.checksum = ledgerChecksum();
+    Serial.println("Energy windows started.");
+  }
+
+  for (int core = 0; core < ENERGY_CORES; core++) {
+    if (esp_register_freertos_tick_hook_for_cpu(countTick, core) != ESP_OK) {
+      Serial.print("No tick hook slot left on core ");
+      Serial.print(core);
+      Serial.println(", its CPU time is not counted.");
+    }
+  }
+
+  lastSampleMs = millis();
+  lastSpiCycles = TFT_display.spiCycles();
+  ready = true;
+}
+
+void energyRadioOn() {
+  uint32_t nowMs = millis();
+  portENTER_CRITICAL(&energyLock);
+  if (!radioOn) {
+    radioOn = true;
+    radioOnSinceMs = nowMs;
+    pendingConnectCycles++;
+  }
+  portEXIT_CRITICAL(&energyLock);
+}
+
+void energyRadioOff() {
+  uint32_t nowMs = millis();
+  portENTER_CRITICAL(&energyLock);
+  if (radioOn) {
+    radioOn = false;
+    pendingRadioOnMs += nowMs - radioOnSinceMs;
+  }
+  portEXIT_CRITICAL(&energyLock);
+}
+
+void energyAddReconnectWait(uint32_t ms) {
+  portENTER_CRITICAL(&energyLock);
+  pendingReconnectWaitMs += ms;
+  portEXIT_CRITICAL(&energyLock);
+}
+
+static void addTotals(EnergyTotals& totals, const EnergyTotals& delta) {
+  totals.elapsedMs += delta.elapsedMs;
+  totals.radioOnMs += delta.radioOnMs;
+  totals.connectCycles += delta.connectCycles;
+  totals.reconnectWaitMs += delta.reconnectWaitMs;
+  for (int core = 0; core < ENERGY_CORES; core++) {
+    totals.activeMs[core] += delta.activeMs[core];
+    totals.idleMs[core] += delta.idleMs[core];
+  }
+  totals.spiBusyMs += delta.spiBusyMs;
+}
+
+// Windows close at the sample that reaches their length, so they run up to
+// one sample interval long.
+static void closeWindow(EnergyWindow running, EnergyWindow last, uint32_t lengthMs) {
+  if (ledger.windows[running].elapsedMs >= lengthMs) {
+    ledger.windows[last] = ledger.windows[running];
+    memset(&ledger.windows[running], 0, sizeof(EnergyTotals));
+  }
+}
+
+void energySample() {
+  if (!ready) {
+    return;
+  }
+  uint32_t nowMs = millis();
+  EnergyTotals delta = {};
+  delta.elapsedMs = nowMs - lastSampleMs;
+  lastSampleMs = nowMs;
+
+  portENTER_CRITICAL(&energyLock);
+  if (radioOn) {
+    pendingRadioOnMs += nowMs - radioOnSinceMs;
+    radioOnSinceMs = nowMs;
+  }
+  delta.radioOnMs = pendingRadioOnMs;
+  delta.connectCycles = pendingConnectCycles;
+  delta.reconnectWaitMs = pendingReconnectWaitMs;
+  pendingRadioOnMs = 0;
+  pendingConnectCycles = 0;
+  pendingReconnectWaitMs = 0;
+  portEXIT_CRITICAL(&energyLock);
+
+  for (int core = 0; core < ENERGY_CORES; core++) {
+    uint32_t active = activeTicks[core];
+    uint32_t idle = idleTicks[core];
+    delta.activeMs[core] = (active - lastActiveTicks[core]) * portTICK_PERIOD_MS;
+    delta.idleMs[core] = (idle - lastIdleTicks[core]) * portTICK_PERIOD_MS;
+    lastActiveTicks[core] = active;
+    lastIdleTicks[core] = idle;
+  }
+
+  // The cycle count wraps after 17 seconds at 240MHz, more than twice the
+  // sample interval.
+  uint32_t spiCycles = TFT_display.spiCycles();
+  uint32_t cyclesPerMs = getCpuFrequencyMhz() * 1000;
+  spiRemainderCycles += spiCycles - lastSpiCycles;
+  lastSpiCycles = spiCycles;
+  delta.spiBusyMs = spiRemainderCycles / cyclesPerMs;
+  spiRemainderCycles %= cyclesPerMs;
+
+  portENTER_CRITICAL(&energyLock);
+  addTotals(ledger.windows[ENERGY_HOUR], delta);
+  addTotals(ledger.windows[ENERGY_DAY], delta);
+  closeWindow(ENERGY_HOUR, ENERGY_LAST_HOUR, HOUR_MS);
+  closeWindow(ENERGY_DAY, ENERGY_LAST_DAY, DAY_MS);
+  ledger.checksum = ledgerChecksum();
+  portEXIT_CRITICAL(&energyLock);
+}
+
+static EnergyTotals copyWindow(int window) {
+  portENTER_CRITICAL(&energyLock);
+  EnergyTotals totals = ledger.windows[window];
+  portEXIT_CRITICAL(&energyLock);
+  return totals;
+}
+
+static uint32_t estimateMahPerDay(const EnergyTotals& totals) {
+  if (totals.elapsedMs == 0) {
+    return 0;
+  }
+  uint64_t chargeMaMs = (uint64_t)ENERGY_IDLE_MA * totals.elapsedMs
+    + (uint64_t)ENERGY_RADIO_ON_MA * totals.radioOnMs
+    + (uint64_t)ENERGY_RECONNECT_MA * totals.reconnectWaitMs
+    + (uint64_t)ENERGY_SPI_BUSY_MA * totals.spiBusyMs;
+  for (int core = 0; core < ENERGY_CORES; core++) {
+    chargeMaMs += (uint64_t)ENERGY_CORE_ACTIVE_MA * totals.activeMs[core];
+  }
+  // The average current of the window, for 24 hours.
+  return (uint32_t)(chargeMaMs * 24 / totals.elapsedMs);
+}
+
+uint32_t energyEstimateMahPerDay(EnergyWindow window) {
+  return estimateMahPerDay(copyWindow(window));
+}
+
+struct EnergySeries {
+  const char* name;
+  const char* help;
+  size_t offset;  // of the field in EnergyTotals
+  bool perCore;
+  bool seconds;   // the field is in ms and is written in seconds
+};
+
+static const EnergySeries SERIES[] = {
+  { "clock_energy_elapsed_seconds",        "Uptime covered by the energy window",                offsetof(EnergyTotals, elapsedMs),       false, true },
+  { "clock_energy_radio_on_seconds",       "Time the WiFi radio was on",                         offsetof(EnergyTotals, radioOnMs),       false, true },
+  { "clock_energy_connect_cycles",         "Times the WiFi radio was turned on",                 offsetof(EnergyTotals, connectCycles),   false, false },
+  { "clock_energy_reconnect_wait_seconds", "Time reconnectWifi() waited for the link",           offsetof(EnergyTotals, reconnectWaitMs), false, true },
+  { "clock_energy_cpu_active_seconds",     "Time a core ran a task, sampled every tick",         offsetof(EnergyTotals, activeMs),        true,  true },
+  { "clock_energy_cpu_idle_seconds",       "Time a core ran its idle task, sampled every tick",  offsetof(EnergyTotals, idleMs),          true,  true },
+  { "clock_energy_spi_busy_seconds",       "Time spent in SPI transfers to the panel",           offsetof(EnergyTotals, spiBusyMs),       false, true },
+};
+
+static int formatValue(char* out, size_t size, uint32_t value, bool seconds) {
+  if (seconds) {
+    return snprintf(out, size, "%lu.%03lu", (unsigned long)(value / 1000), (unsigned long)(value % 1000));
+  }
+  return snprintf(out, size, "%lu", (unsigned long)value);
+}
+
+void energyWriteText(ImageWriteFn write, void* context) {
+  EnergyTotals windows[ENERGY_WINDOW_COUNT];
+  for (int w = 0; w < ENERGY_WINDOW_COUNT; w++) {
+    windows[w] = copyWindow(w);
+  }
+
+  char line[REPORT_LINE_LENGTH];
+  char value[16];
+  int length;
+  for (const EnergySeries& series : SERIES) {
+    length = snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s gauge\n", series.name, series.help, series.name);
+    writeTextLine(write, context, line, length);
+    for (int w = 0; w < ENERGY_WINDOW_COUNT; w++) {
+      const uint32_t* field = (const uint32_t*)((const uint8_t*)&windows[w] + series.offset);
+      for (int core = 0; core < (series.perCore ? ENERGY_CORES : 1); core++) {
+        formatValue(value, sizeof(value), field[core], series.seconds);
+        if (series.perCore) {
+          length = snprintf(line, sizeof(line), "%s{window=\"%s\",core=\"%d\"} %s\n", series.name, WINDOW_NAMES[w], core, value);
+        }
+        else {
+          length = snprintf(line, sizeof(line), "%s{window=\"%s\"} %s\n", series.name, WINDOW_NAMES[w], value);
+        }
+        writeTextLine(write, context, line, length);
+      }
+    }
+  }
+
+  length = snprintf(
+    line, sizeof(line),
+    "# HELP clock_energy_estimate_mah_per_day Average current of the window from the modelled currents, times 24 hours\n"
+  );
+  writeTextLine(write, context, line, length);
+  length = snprintf(line, sizeof(line), "# TYPE clock_energy_estimate_mah_per_day gauge\n");
+  writeTextLine(write, context, line, length);
+  for (int w = 0; w < ENERGY_WINDOW_COUNT; w++) {
+    length = snprintf(
+      line, sizeof(line), "clock_energy_estimate_mah_per_day{window=\"%s\"} %lu\n",
+      WINDOW_NAMES[w], (unsigned long)estimateMahPerDay(windows[w])
+    );
+    writeTextLine(write, context, line, length);
+  }
+}
+
+static uint32_t activePercent(const EnergyTotals& totals, int core) {
+  uint32_t ticks = totals.activeMs[core] + totals.idleMs[core];
+  return ticks > 0 ? (uint32_t)((uint64_t)totals.activeMs[core] * 100 / ticks) : 0;
+}
+
+void energyWriteReport(ImageWriteFn write, void* context) {
+  char line[REPORT_LINE_LENGTH];
+  int length = snprintf(
+    line, sizeof(line), "%-10s %9s %8s %6s %7s %5s %5s %7s %8s\n",
+    "window", "elapsed_s", "radio_s", "cycles", "wait_s", "cpu0%", "cpu1%", "spi_s", "mAh/day"
+  );
+  writeTextLine(write, context, line, length);
+
+  for (int w = 0; w < ENERGY_WINDOW_COUNT; w++) {
+    EnergyTotals totals = copyWindow(w);
+    length = snprintf(
+      line, sizeof(line), "%-10s %9lu %8lu %6lu %7lu %5lu %5lu %7lu %8lu\n",
+      WINDOW_NAMES[w],
+      (unsigned long)(totals.elapsedMs / 1000),
+      (unsigned long)(totals.radioOnMs / 1000),
+      (unsigned long)totals.connectCycles,
+      (unsigned long)(totals.reconnectWaitMs / 1000),
+      (unsigned long)activePercent(totals, 0),
+      (unsigned long)activePercent(totals, 1),
+      (unsigned long)(totals.spiBusyMs / 1000),
+      (unsigned long)estimateMahPerDay(totals)
+    );
+    writeTextLine(write, context, line, length);
+  }
+}
@@ -0,0 +1,59 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <stdint.h>
+#include "text_writer.h"
+
+// Energy accounting. Sums, per hour and per day of uptime, the time the
+// radio was on, the connect cycles, the time reconnectWifi() spent waiting
+// for the link, the time each core ran a task or sat idle, and the time
+// spent in SPI transfers to the panel. The system monitor folds the
+// figures in every SYSTEM_MONITOR_INTERVAL_MS.
+//
+// CPU time is sampled by a FreeRTOS tick hook on each core, which counts
+// the ticks that interrupt the idle task and those that interrupt any
+// other. SPI time is the time spent in the panel library's drawPixel()
+// and fillScreen(), which block on the transfer (see ShadowTFT).
+//
+// The windows are kept in RTC memory that a soft reset leaves alone, so a
+// restart does not start the day over. A power cycle does.
+
+// Rough currents after the power consumption table of the ESP32 datasheet,
+// used to turn the times into an estimate of mAh per day. They are for
+// comparing builds and schedules against each other, not for predicting
+// battery life; the panel and its backlight are not included.
+#define ENERGY_IDLE_MA 20          // both cores idle, radio off
+#define ENERGY_CORE_ACTIVE_MA 24   // extra per core while it runs a task
+#define ENERGY_RADIO_ON_MA 25      // extra while associated, modem sleep between beacons
+#define ENERGY_RECONNECT_MA 100    // extra while scanning and associating
+#define ENERGY_SPI_BUSY_MA 4       // extra while the SPI peripheral sends pixels
+
+enum EnergyWindow {
+  ENERGY_HOUR,       // the running hour
+  ENERGY_LAST_HOUR,
+  ENERGY_DAY,        // the running day
+  ENERGY_LAST_DAY,
+  ENERGY_WINDOW_COUNT
+};
+
+// Restores the windows after a soft reset and installs the tick hooks.
+// Call once at boot, before the system monitor starts.
+void energySetup();
+// Called when WiFi is started and when it is turned off for power saving.
+// Turning the radio on while it is off counts a connect cycle.
+void energyRadioOn();
+void energyRadioOff();
+void energyAddReconnectWait(uint32_t ms);
+// Folds the time since the last call into the windows. Called by the
+// system monitor.
+void energySample();
+// Average current of the window times 24 hours, 0 for an empty window.
+uint32_t energyEstimateMahPerDay(EnergyWindow window);
+
+// Writes the windows in the Prometheus text format, as clock_energy_*
+// gauges labeled with the window.
+void energyWriteText(ImageWriteFn write, void* context);
+// One line per window.
+void energyWriteReport(ImageWriteFn write, void* context);
+
+#endif
@@ -4,8 +4,11 @@
 #include "display.h"
 #include "app_state.h"
 #include "timing_constants.h"
+#include "clock_source.h"
 #include "config.h"
 #include "pins.h"
+#include "log_ring.h"
+#include "input_latency.h"
 
 void setConfiguredClockFace() {
   String id = getDefaultFaceId();
@@ -44,18 +47,20 @@ void setConfiguredClockFace() {
     _defaultIndex = findIndexByType(defaultType);
     _currentIndex = _defaultIndex;
     _gracePeriodStart = 0;
-    setClockFace(getFaceAt(_currentIndex));
+    ClockFace* face = getFaceAt(_currentIndex);
+    face->reset();
+    setClockFace(face);
   }
 
   void faceManagerOnRotation(int delta) {
     AppState state = getAppState();
-    Serial.print("Face manager rotation. Current state: "); Serial.println(state);
+    logDebug("Face manager rotation. Current state: %d", state);
     if (
       state == RESET_PENDING
       || state == NOT_CONFIGURED
       || state == CONNECTING
     ) {
-      Serial.println("Ignore because state.");
+      logDebug("Ignore because state.");
       return;
     }
 
@@ -64,15 +69,17 @@ void setConfiguredClockFace() {
 
     ClockFace* face = getFaceAt(_currentIndex);
     face->reset();
-    Serial.print("Set face: "); Serial.println(face->getId());
+    logInfo("Set face: %s", face->getId());
     setClockFace(face);
-    _gracePeriodStart = millis();
+    _gracePeriodStart = clockSourceMillis();
+    inputLatencyApplied(INPUT_ROTATION);
   }
 
   void faceManagerOnSingleClick() {
     if (_gracePeriodStart == 0) {
       return;
     }
+    // Guards against a bouncing button, so it measures real time.
     static unsigned long lastSaveMs = 0;
     if (millis() - lastSaveMs < 500) {
       return;
@@ -83,8 +90,8 @@ void setConfiguredClockFace() {
     _defaultIndex = _currentIndex;
     _gracePeriodStart = 0;
     getFaceAt(_currentIndex)->reset();
-    Serial.print("Default face saved: ");
-    Serial.println(id);
+    inputLatencyApplied(INPUT_CLICK);
+    logInfo("Default face saved: %s", id);
   }
 
   void faceManagerUpdate() {
@@ -92,8 +99,8 @@ void setConfiguredClockFace() {
       return;
     }
 
-    if ((millis() - _gracePeriodStart) >= FACE_GRACE_PERIOD_MS) {
-      Serial.println("Grace period expired. Reverting face.");
+    if ((clockSourceMillis() - _gracePeriodStart) >= FACE_GRACE_PERIOD_MS) {
+      logInfo("Grace period expired. Reverting face.");
       _gracePeriodStart = 0;
       _currentIndex = _defaultIndex;
       ClockFace* face = getFaceAt(_currentIndex);
@@ -110,7 +117,7 @@ void setConfiguredClockFace() {
     if (_gracePeriodStart == 0) {
       return 0.0f;
     }
-    unsigned long elapsed = millis() - _gracePeriodStart;
+    unsigned long elapsed = clockSourceMillis() - _gracePeriodStart;
     if (elapsed >= FACE_GRACE_PERIOD_MS) {
       return 0.0f;
     }
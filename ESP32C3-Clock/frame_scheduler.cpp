@@ -0,0 +1,62 @@
+#include "frame_scheduler.h"
+#include "timing_constants.h"
+
+static const int64_t US_PER_SECOND = 1000000;
+
+void frameSchedulerInit(FrameScheduler& scheduler) {
+  scheduler.lastFrameMs = 0;
+  scheduler.lastSecond = -1;
+  scheduler.inputRequested = false;
+}
+
+void frameSchedulerRequest(FrameScheduler& scheduler) {
+  scheduler.inputRequested = true;
+}
+
+static FrameReason requestedFrame(FrameScheduler& scheduler, uint32_t nowMs) {
+  if (!scheduler.inputRequested) {
+    return FRAME_NONE;
+  }
+  scheduler.inputRequested = false;
+  scheduler.lastFrameMs = nowMs;
+  return FRAME_INPUT;
+}
+
+FrameReason frameSchedulerPoll(FrameScheduler& scheduler, uint32_t nowMs, int64_t wallUs) {
+  bool blinkDue = (nowMs - scheduler.lastFrameMs) >= BLINK_INTERVAL_MS;
+
+  if (wallUs < 0) {
+    scheduler.lastSecond = -1;
+    if (blinkDue) {
+      scheduler.inputRequested = false;
+      scheduler.lastFrameMs = nowMs;
+      return FRAME_BLINK;
+    }
+    return requestedFrame(scheduler, nowMs);
+  }
+
+  int64_t second = wallUs / US_PER_SECOND;
+  if (scheduler.lastSecond >= 0 && second != scheduler.lastSecond) {
+    scheduler.lastSecond = second;
+    scheduler.inputRequested = false;
+    scheduler.lastFrameMs = nowMs;
+    return FRAME_SECOND;
+  }
+  scheduler.lastSecond = second;
+
+  if (!blinkDue) {
+    return requestedFrame(scheduler, nowMs);
+  }
+
+  // A blink frame started just before the boundary would still be drawing
+  // when the second turns; let the boundary frame cover it instead. An
+  // input does not wait for the boundary.
+  int64_t usToBoundary = US_PER_SECOND - (wallUs % US_PER_SECOND);
+  if (usToBoundary < (int64_t)FRAME_BOUNDARY_GUARD_MS * 1000) {
+    return requestedFrame(scheduler, nowMs);
+  }
+
+  scheduler.inputRequested = false;
+  scheduler.lastFrameMs = nowMs;
+  return FRAME_BLINK;
+}
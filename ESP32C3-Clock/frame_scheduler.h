@@ -0,0 +1,34 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <cstdint>
+
+// Decides when the render loop starts a frame. Frames still come at the blink
+// interval, plus one right after every wall-clock second boundary, so clocks
+// synced to the same NTP source flip their seconds together. Plain C++ so the
+// host simulation in host/ runs the same code.
+
+enum FrameReason {
+  FRAME_NONE,
+  FRAME_BLINK,
+  FRAME_SECOND,
+  // Requested for an input that is waiting to be shown.
+  FRAME_INPUT
+};
+
+struct FrameScheduler {
+  uint32_t lastFrameMs;
+  int64_t lastSecond;
+  bool inputRequested;
+};
+
+void frameSchedulerInit(FrameScheduler& scheduler);
+// Makes the next poll start a frame. A blink or second frame due at the
+// same time covers the request.
+void frameSchedulerRequest(FrameScheduler& scheduler);
+
+// nowMs is the monotonic millis() clock, wallUs the wall clock in
+// microseconds or a negative value while the time is not known yet.
+FrameReason frameSchedulerPoll(FrameScheduler& scheduler, uint32_t nowMs, int64_t wallUs);
+
+#endif
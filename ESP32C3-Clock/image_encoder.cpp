@@ -0,0 +1,582 @@
+#include <string.h>
+#include "image_encoder.h"
+
+static const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+// CRC-32 one nibble at a time; a full byte table would cost 1KB of flash.
+static const uint32_t CRC_NIBBLE_TABLE[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+// Deflate length codes 257..285 and distance codes 0..29.
+static const uint16_t LENGTH_BASE[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const uint8_t LENGTH_EXTRA[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+static const uint16_t DIST_BASE[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+static const uint8_t DIST_EXTRA[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+static const int MIN_MATCH = 3;
+static const int MAX_MATCH = 258;
+static const uint32_t ADLER_MOD = 65521;
+
+// Two RGB565 pixels in one little-endian word: the first in the low half.
+// Each mask picks the same channel of both pixels at once.
+static inline void expandPair(const uint16_t* pixels, uint32_t& r, uint32_t& g, uint32_t& b) {
+  uint32_t word;
+  memcpy(&word, __builtin_assume_aligned(pixels, 4), sizeof(word));
+  r = (word >> 8) & 0x00F800F8;
+  g = (word >> 3) & 0x00FC00FC;
+  b = (word << 3) & 0x00F800F8;
+}
+
+void rgb565ToRgb888(const uint16_t* pixels, uint8_t* out, int count) {
+  int i = 0;
+  for (; i + 1 < count; i += 2) {
+    uint32_t r, g, b;
+    expandPair(pixels + i, r, g, b);
+    out[0] = (uint8_t)r;
+    out[1] = (uint8_t)g;
+    out[2] = (uint8_t)b;
+    out[3] = (uint8_t)(r >> 16);
+    out[4] = (uint8_t)(g >> 16);
+    out[5] = (uint8_t)(b >> 16);
+    out += 6;
+  }
+  if (i < count) {
+    uint16_t pixel = pixels[i];
+    out[0] = (pixel >> 8) & 0xF8;
+    out[1] = (pixel >> 3) & 0xFC;
+    out[2] = (pixel << 3) & 0xF8;
+  }
+}
+
+void rgb565ToBgr888(const uint16_t* pixels, uint8_t* out, int count) {
+  int i = 0;
+  for (; i + 1 < count; i += 2) {
+    uint32_t r, g, b;
+    expandPair(pixels + i, r, g, b);
+    out[0] = (uint8_t)b;
+    out[1] = (uint8_t)g;
+    out[2] = (uint8_t)r;
+    out[3] = (uint8_t)(b >> 16);
+    out[4] = (uint8_t)(g >> 16);
+    out[5] = (uint8_t)(r >> 16);
+    out += 6;
+  }
+  if (i < count) {
+    uint16_t pixel = pixels[i];
+    out[0] = (pixel << 3) & 0xF8;
+    out[1] = (pixel >> 3) & 0xFC;
+    out[2] = (pixel >> 8) & 0xF8;
+  }
+}
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ CRC_NIBBLE_TABLE[crc & 0x0F];
+    crc = (crc >> 4) ^ CRC_NIBBLE_TABLE[crc & 0x0F];
+  }
+  return ~crc;
+}
+
+static void writeBe32(uint8_t* buf, uint32_t val) {
+  buf[0] = (val >> 24) & 0xFF;
+  buf[1] = (val >> 16) & 0xFF;
+  buf[2] = (val >> 8) & 0xFF;
+  buf[3] = val & 0xFF;
+}
+
+static void pngWriteChunk(PngEncoder& enc, const char* type, const uint8_t* data, uint32_t length) {
+  uint8_t header[8];
+  writeBe32(header, length);
+  memcpy(header + 4, type, 4);
+  enc.write(header, sizeof(header), enc.context);
+  if (length > 0) {
+    enc.write(data, length, enc.context);
+  }
+
+  uint8_t trailer[4];
+  writeBe32(trailer, crc32Update(crc32Update(0, header + 4, 4), data, length));
+  enc.write(trailer, sizeof(trailer), enc.context);
+}
+
+static void pngFlushIdat(PngEncoder& enc) {
+  if (enc.chunkLength > 0) {
+    pngWriteChunk(enc, "IDAT", enc.chunk, enc.chunkLength);
+    enc.chunkLength = 0;
+  }
+}
+
+static void pngPushByte(PngEncoder& enc, uint8_t byte) {
+  enc.chunk[enc.chunkLength++] = byte;
+  if (enc.chunkLength == sizeof(enc.chunk)) {
+    pngFlushIdat(enc);
+  }
+}
+
+// Deflate packs bits starting at the least significant bit.
+static void pngWriteBits(PngEncoder& enc, uint32_t value, int count) {
+  enc.bitBuffer |= value << enc.bitCount;
+  enc.bitCount += count;
+  while (enc.bitCount >= 8) {
+    pngPushByte(enc, (uint8_t)enc.bitBuffer);
+    enc.bitBuffer >>= 8;
+    enc.bitCount -= 8;
+  }
+}
+
+// Huffman codes are stored most significant bit first.
+static void pngWriteCode(PngEncoder& enc, uint32_t code, int length) {
+  uint32_t reversed = 0;
+  for (int i = 0; i < length; i++) {
+    reversed = (reversed << 1) | ((code >> i) & 1);
+  }
+  pngWriteBits(enc, reversed, length);
+}
+
+static void pngWriteSymbol(PngEncoder& enc, int symbol) {
+  if (symbol < 144) {
+    pngWriteCode(enc, 0x30 + symbol, 8);
+  }
+  else if (symbol < 256) {
+    pngWriteCode(enc, 0x190 + (symbol - 144), 9);
+  }
+  else if (symbol < 280) {
+    pngWriteCode(enc, symbol - 256, 7);
+  }
+  else {
+    pngWriteCode(enc, 0xC0 + (symbol - 280), 8);
+  }
+}
+
+static void pngWriteMatch(PngEncoder& enc, int length, int distance) {
+  int lengthCode = 28;
+  while (LENGTH_BASE[lengthCode] > length) {
+    lengthCode--;
+  }
+  pngWriteSymbol(enc, 257 + lengthCode);
+  pngWriteBits(enc, length - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+
+  int distCode = 29;
+  while (DIST_BASE[distCode] > distance) {
+    distCode--;
+  }
+  pngWriteCode(enc, distCode, 5);
+  pngWriteBits(enc, distance - DIST_BASE[distCode], DIST_EXTRA[distCode]);
+}
+
+static int matchLength(const uint8_t* data, const uint8_t* ref, int available) {
+  int limit = available < MAX_MATCH ? available : MAX_MATCH;
+  int length = 0;
+  while (length < limit && data[length] == ref[length]) {
+    length++;
+  }
+  return length;
+}
+
+static void pngCompressRow(PngEncoder& enc) {
+  int stride = 1 + enc.width * 3;
+  const uint8_t* row = enc.row;
+
+  uint32_t a = enc.adlerA;
+  uint32_t b = enc.adlerB;
+  for (int i = 0; i < stride; i++) {
+    a += row[i];
+    b += a;
+  }
+  enc.adlerA = a % ADLER_MOD;
+  enc.adlerB = b % ADLER_MOD;
+
+  // Only two candidates are tried: the previous pixel (runs of one colour,
+  // distance 3) and the same position in the previous row (distance stride).
+  int i = 0;
+  while (i < stride) {
+    int bestLength = 0;
+    int bestDistance = 0;
+    if (i >= 3) {
+      bestLength = matchLength(row + i, row + i - 3, stride - i);
+      bestDistance = 3;
+    }
+    if (enc.hasPrevRow) {
+      int length = matchLength(row + i, enc.prevRow + i, stride - i);
+      if (length > bestLength) {
+        bestLength = length;
+        bestDistance = stride;
+      }
+    }
+
+    if (bestLength >= MIN_MATCH) {
+      pngWriteMatch(enc, bestLength, bestDistance);
+      i += bestLength;
+    }
+    else {
+      pngWriteSymbol(enc, row[i]);
+      i++;
+    }
+  }
+
+  memcpy(enc.prevRow, row, stride);
+  enc.hasPrevRow = true;
+}
+
+void pngEncoderBegin(PngEncoder& enc, int width, int height, ImageWriteFn write, void* context) {
+  enc.write = write;
+  enc.context = context;
+  enc.width = width;
+  enc.height = height;
+  enc.rowsDone = 0;
+  enc.adlerA = 1;
+  enc.adlerB = 0;
+  enc.bitBuffer = 0;
+  enc.bitCount = 0;
+  enc.hasPrevRow = false;
+  enc.chunkLength = 0;
+
+  write(PNG_SIGNATURE, sizeof(PNG_SIGNATURE), context);
+
+  uint8_t ihdr[13];
+  writeBe32(ihdr, width);
+  writeBe32(ihdr + 4, height);
+  ihdr[8] = 8;   // bit depth
+  ihdr[9] = 2;   // color type RGB
+  ihdr[10] = 0;  // deflate
+  ihdr[11] = 0;  // adaptive filtering
+  ihdr[12] = 0;  // not interlaced
+  pngWriteChunk(enc, "IHDR", ihdr, sizeof(ihdr));
+
+  // zlib header (deflate, 32K window, fastest) and the only deflate block:
+  // final, fixed Huffman codes.
+  pngPushByte(enc, 0x78);
+  pngPushByte(enc, 0x01);
+  pngWriteBits(enc, 1, 1);
+  pngWriteBits(enc, 1, 2);
+}
+
+void pngEncoderAddRows(PngEncoder& enc, const uint16_t* pixels, int rows) {
+  for (int y = 0; y < rows && enc.rowsDone < enc.height; y++) {
+    enc.row[0] = 0;  // filter type None
+    rgb565ToRgb888(pixels + y * enc.width, enc.row + 1, enc.width);
+    pngCompressRow(enc);
+    enc.rowsDone++;
+  }
+}
+
+void pngEncoderEnd(PngEncoder& enc) {
+  pngWriteSymbol(enc, 256);
+  if (enc.bitCount > 0) {
+    pngWriteBits(enc, 0, 8 - enc.bitCount);
+  }
+
+  uint8_t adler[4];
+  writeBe32(adler, (enc.adlerB << 16) | enc.adlerA);
+  for (int i = 0; i < 4; i++) {
+    pngPushByte(enc, adler[i]);
+  }
+  pngFlushIdat(enc);
+  pngWriteChunk(enc, "IEND", NULL, 0);
+}
+
+static void qoiFlush(QoiEncoder& enc) {
+  if (enc.outLength > 0) {
+    enc.write(enc.out, enc.outLength, enc.context);
+    enc.outLength = 0;
+  }
+}
+
+static void qoiPush(QoiEncoder& enc, uint8_t byte) {
+  enc.out[enc.outLength++] = byte;
+  if (enc.outLength == sizeof(enc.out)) {
+    qoiFlush(enc);
+  }
+}
+
+static void qoiFlushRun(QoiEncoder& enc) {
+  if (enc.run > 0) {
+    qoiPush(enc, 0xC0 | (enc.run - 1));
+    enc.run = 0;
+  }
+}
+
+static void qoiEncodePixel(QoiEncoder& enc, const uint8_t* px) {
+  if (px[0] == enc.prev[0] && px[1] == enc.prev[1] && px[2] == enc.prev[2]) {
+    enc.run++;
+    if (enc.run == 62) {
+      qoiFlushRun(enc);
+    }
+    return;
+  }
+  qoiFlushRun(enc);
+
+  // Every pixel is opaque, so alpha is 255 in the hash and the index.
+  int slot = (px[0] * 3 + px[1] * 5 + px[2] * 7 + 255 * 11) % 64;
+  uint8_t* entry = enc.index[slot];
+  if (entry[0] == px[0] && entry[1] == px[1] && entry[2] == px[2] && entry[3] == 255) {
+    qoiPush(enc, slot);
+  }
+  else {
+    entry[0] = px[0];
+    entry[1] = px[1];
+    entry[2] = px[2];
+    entry[3] = 255;
+
+    int8_t dr = (int8_t)(px[0] - enc.prev[0]);
+    int8_t dg = (int8_t)(px[1] - enc.prev[1]);
+    int8_t db = (int8_t)(px[2] - enc.prev[2]);
+    int8_t drDg = dr - dg;
+    int8_t dbDg = db - dg;
+
+    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+      qoiPush(enc, 0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+    }
+    else if (dg >= -32 && dg <= 31 && drDg >= -8 && drDg <= 7 && dbDg >= -8 && dbDg <= 7) {
+      qoiPush(enc, 0x80 | (dg + 32));
+      qoiPush(enc, (drDg + 8) << 4 | (dbDg + 8));
+    }
+    else {
+      qoiPush(enc, 0xFE);
+      qoiPush(enc, px[0]);
+      qoiPush(enc, px[1]);
+      qoiPush(enc, px[2]);
+    }
+  }
+
+  enc.prev[0] = px[0];
+  enc.prev[1] = px[1];
+  enc.prev[2] = px[2];
+}
+
+void qoiEncoderBegin(QoiEncoder& enc, int width, int height, ImageWriteFn write, void* context) {
+  enc.write = write;
+  enc.context = context;
+  enc.width = width;
+  memset(enc.index, 0, sizeof(enc.index));
+  memset(enc.prev, 0, sizeof(enc.prev));
+  enc.run = 0;
+  enc.outLength = 0;
+
+  uint8_t header[14] = { 'q', 'o', 'i', 'f' };
+  writeBe32(header + 4, width);
+  writeBe32(header + 8, height);
+  header[12] = 3;  // RGB
+  header[13] = 0;  // sRGB with linear alpha
+  for (size_t i = 0; i < sizeof(header); i++) {
+    qoiPush(enc, header[i]);
+  }
+}
+
+void qoiEncoderAddRows(QoiEncoder& enc, const uint16_t* pixels, int rows) {
+  for (int y = 0; y < rows; y++) {
+    rgb565ToRgb888(pixels + y * enc.width, enc.rgb, enc.width);
+    for (int x = 0; x < enc.width; x++) {
+      qoiEncodePixel(enc, enc.rgb + x * 3);
+    }
+  }
+}
+
+void qoiEncoderEnd(QoiEncoder& enc) {
+  qoiFlushRun(enc);
+  static const uint8_t END_MARKER[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+  for (size_t i = 0; i < sizeof(END_MARKER); i++) {
+    qoiPush(enc, END_MARKER[i]);
+  }
+  qoiFlush(enc);
+}
+
+static void mirrorFlush(MirrorEncoder& enc) {
+  if (enc.outLength > 0) {
+    enc.write(enc.out, enc.outLength, enc.context);
+    enc.outLength = 0;
+  }
+}
+
+static void mirrorPush(MirrorEncoder& enc, uint8_t byte) {
+  enc.out[enc.outLength++] = byte;
+  if (enc.outLength == sizeof(enc.out)) {
+    mirrorFlush(enc);
+  }
+}
+
+static void mirrorPushRun(MirrorEncoder& enc, int count, uint16_t color) {
+  mirrorPush(enc, (uint8_t)(count - 1));
+  mirrorPush(enc, color & 0xFF);
+  mirrorPush(enc, color >> 8);
+}
+
+static void mirrorAddRect(MirrorEncoder& enc, const uint16_t* strip, int width, int x, int y, int w, int h) {
+  if (!enc.frameStarted) {
+    mirrorPush(enc, 'F');
+    for (int i = 0; i < 4; i++) {
+      mirrorPush(enc, (enc.seq >> (i * 8)) & 0xFF);
+    }
+    enc.frameStarted = true;
+  }
+
+  mirrorPush(enc, 'R');
+  mirrorPush(enc, x);
+  mirrorPush(enc, y);
+  mirrorPush(enc, w);
+  mirrorPush(enc, h);
+
+  uint16_t color = strip[x];
+  int run = 0;
+  for (int row = 0; row < h; row++) {
+    const uint16_t* pixels = strip + row * width + x;
+    for (int col = 0; col < w; col++) {
+      if (pixels[col] == color && run < 256) {
+        run++;
+        continue;
+      }
+      mirrorPushRun(enc, run, color);
+      color = pixels[col];
+      run = 1;
+    }
+  }
+  mirrorPushRun(enc, run, color);
+}
+
+void mirrorEncoderBegin(MirrorEncoder& enc, ImageWriteFn write, void* context) {
+  enc.write = write;
+  enc.context = context;
+  enc.seq = 0;
+  enc.frameStarted = false;
+  enc.outLength = 0;
+}
+
+void mirrorEncoderBeginFrame(MirrorEncoder& enc, uint32_t seq) {
+  enc.seq = seq;
+  enc.frameStarted = false;
+}
+
+int mirrorEncoderAddStrip(
+  MirrorEncoder& enc,
+  const uint16_t* strip,
+  int width,
+  int stripY,
+  int stripHeight,
+  const uint32_t* tileGenerations,
+  int tileSize,
+  uint32_t since
+) {
+  int tiles = width / tileSize;
+  int rects = 0;
+  int tile = 0;
+  while (tile < tiles) {
+    if (tileGenerations[tile] < since) {
+      tile++;
+      continue;
+    }
+    int first = tile;
+    while (tile < tiles && tileGenerations[tile] >= since) {
+      tile++;
+    }
+    mirrorAddRect(enc, strip, width, first * tileSize, stripY, (tile - first) * tileSize, stripHeight);
+    rects++;
+  }
+  return rects;
+}
+
+bool mirrorEncoderEndFrame(MirrorEncoder& enc) {
+  if (!enc.frameStarted) {
+    return false;
+  }
+  mirrorPush(enc, 'E');
+  mirrorFlush(enc);
+  enc.frameStarted = false;
+  return true;
+}
+
+// COBS: every zero is replaced by the distance to the next one, so the
+// encoded packet contains no zeros and 0x00 can delimit packets.
+static size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out) {
+  size_t codePos = 0;
+  size_t outPos = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < length; i++) {
+    if (in[i] != 0) {
+      out[outPos++] = in[i];
+      code++;
+    }
+    if (in[i] == 0 || code == 0xFF) {
+      out[codePos] = code;
+      codePos = outPos++;
+      code = 1;
+    }
+  }
+  out[codePos] = code;
+  return outPos;
+}
+
+static void serialDumpSend(SerialDumpEncoder& enc, size_t payloadLength) {
+  size_t length = 1 + payloadLength;
+  uint32_t crc = crc32Update(0, enc.packet, length);
+  for (int i = 0; i < 4; i++) {
+    enc.packet[length++] = (crc >> (i * 8)) & 0xFF;
+  }
+  enc.out[0] = 0;
+  size_t outLength = 1 + cobsEncode(enc.packet, length, enc.out + 1);
+  enc.out[outLength++] = 0;
+  enc.write(enc.out, outLength, enc.context);
+}
+
+static void writeLe16(uint8_t* buf, uint16_t val) {
+  buf[0] = val & 0xFF;
+  buf[1] = val >> 8;
+}
+
+void serialDumpBegin(SerialDumpEncoder& enc, int width, int height, uint32_t seq, ImageWriteFn write, void* context) {
+  enc.write = write;
+  enc.context = context;
+  enc.width = width;
+  enc.rows = 0;
+
+  enc.packet[0] = 'H';
+  writeLe16(enc.packet + 1, width);
+  writeLe16(enc.packet + 3, height);
+  for (int i = 0; i < 4; i++) {
+    enc.packet[5 + i] = (seq >> (i * 8)) & 0xFF;
+  }
+  serialDumpSend(enc, 8);
+}
+
+void serialDumpAddRows(SerialDumpEncoder& enc, const uint16_t* pixels, int firstRow, int rows) {
+  for (int row = 0; row < rows; row++) {
+    const uint16_t* line = pixels + row * enc.width;
+    enc.packet[0] = 'R';
+    writeLe16(enc.packet + 1, firstRow + row);
+    size_t length = 2;
+    int x = 0;
+    while (x < enc.width) {
+      uint16_t color = line[x];
+      int run = 1;
+      while (x + run < enc.width && line[x + run] == color && run < 256) {
+        run++;
+      }
+      enc.packet[1 + length++] = (uint8_t)(run - 1);
+      enc.packet[1 + length++] = color & 0xFF;
+      enc.packet[1 + length++] = color >> 8;
+      x += run;
+    }
+    serialDumpSend(enc, length);
+    enc.rows++;
+  }
+}
+
+void serialDumpEnd(SerialDumpEncoder& enc) {
+  enc.packet[0] = 'D';
+  writeLe16(enc.packet + 1, enc.rows);
+  serialDumpSend(enc, 2);
+}
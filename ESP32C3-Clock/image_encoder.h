@@ -0,0 +1,122 @@
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "text_writer.h"
+
+// Streaming image encoders for screenshots. Rows of RGB565 pixels are fed in
+// strips and the encoded bytes are handed to the write callback in pieces of
+// at most IMAGE_ENCODER_CHUNK_SIZE bytes, so memory use does not depend on the
+// image size.
+
+#define IMAGE_ENCODER_CHUNK_SIZE 1024
+#define IMAGE_ENCODER_MAX_WIDTH 240
+
+// Expands RGB565 to 8-bit RGB (or BGR for BMP) two pixels per 32-bit word.
+// pixels must be 4-byte aligned.
+void rgb565ToRgb888(const uint16_t* pixels, uint8_t* out, int count);
+void rgb565ToBgr888(const uint16_t* pixels, uint8_t* out, int count);
+
+// PNG with a single fixed Huffman deflate block. Runs of equal pixels and
+// rows equal to the one above become back references, which is what makes
+// flat clock faces small.
+struct PngEncoder {
+  ImageWriteFn write;
+  void* context;
+  int width;
+  int height;
+  int rowsDone;
+  uint32_t adlerA;
+  uint32_t adlerB;
+  uint32_t bitBuffer;
+  int bitCount;
+  bool hasPrevRow;
+  uint8_t row[1 + IMAGE_ENCODER_MAX_WIDTH * 3];
+  uint8_t prevRow[1 + IMAGE_ENCODER_MAX_WIDTH * 3];
+  uint8_t chunk[IMAGE_ENCODER_CHUNK_SIZE];
+  size_t chunkLength;
+};
+
+void pngEncoderBegin(PngEncoder& enc, int width, int height, ImageWriteFn write, void* context);
+void pngEncoderAddRows(PngEncoder& enc, const uint16_t* pixels, int rows);
+void pngEncoderEnd(PngEncoder& enc);
+
+// QOI, see https://qoiformat.org. Cheaper to encode than PNG and usually
+// about the same size on clock faces.
+struct QoiEncoder {
+  ImageWriteFn write;
+  void* context;
+  int width;
+  uint8_t index[64][4];
+  uint8_t prev[3];
+  int run;
+  uint8_t rgb[IMAGE_ENCODER_MAX_WIDTH * 3];
+  uint8_t out[IMAGE_ENCODER_CHUNK_SIZE];
+  size_t outLength;
+};
+
+void qoiEncoderBegin(QoiEncoder& enc, int width, int height, ImageWriteFn write, void* context);
+void qoiEncoderAddRows(QoiEncoder& enc, const uint16_t* pixels, int rows);
+void qoiEncoderEnd(QoiEncoder& enc);
+
+// Live mirroring stream of changed screen regions. One frame is
+//
+//   'F' seq:u32  then  'R' x:u8 y:u8 w:u8 h:u8 runs  (repeated)  then  'E'
+//
+// where runs are (count - 1):u8 color:u16 pairs covering the w x h RGB565
+// pixels row by row. Multi-byte values are little-endian. Frames without
+// changed tiles are not written at all.
+struct MirrorEncoder {
+  ImageWriteFn write;
+  void* context;
+  uint32_t seq;
+  bool frameStarted;
+  uint8_t out[IMAGE_ENCODER_CHUNK_SIZE];
+  size_t outLength;
+};
+
+void mirrorEncoderBegin(MirrorEncoder& enc, ImageWriteFn write, void* context);
+void mirrorEncoderBeginFrame(MirrorEncoder& enc, uint32_t seq);
+// Adds the tiles of one strip whose generation is at least since, merging
+// neighbouring tiles into one rectangle. Returns the number of rectangles.
+int mirrorEncoderAddStrip(
+  MirrorEncoder& enc,
+  const uint16_t* strip,
+  int width,
+  int stripY,
+  int stripHeight,
+  const uint32_t* tileGenerations,
+  int tileSize,
+  uint32_t since
+);
+// Returns true when the frame had any rectangles.
+bool mirrorEncoderEndFrame(MirrorEncoder& enc);
+
+// Screenshot packets for the serial port. Every packet is
+//
+//   type:u8 payload crc32:u32
+//
+// COBS encoded and framed by a 0x00 byte on both sides, so log lines printed
+// between packets are skipped by the reader and a damaged packet fails its
+// CRC. Each packet is handed to the write callback in one piece.
+//
+//   'H' width:u16 height:u16 seq:u32   start of a dump
+//   'R' y:u16 runs                       one row, runs as in the mirror stream
+//   'D' rows:u16                         end of a dump, rows sent
+#define SERIAL_DUMP_MAX_PACKET (1 + 2 + IMAGE_ENCODER_MAX_WIDTH * 3 + 4)
+
+struct SerialDumpEncoder {
+  ImageWriteFn write;
+  void* context;
+  int width;
+  int rows;
+  uint8_t packet[SERIAL_DUMP_MAX_PACKET];
+  uint8_t out[2 + SERIAL_DUMP_MAX_PACKET + SERIAL_DUMP_MAX_PACKET / 254 + 1];
+};
+
+void serialDumpBegin(SerialDumpEncoder& enc, int width, int height, uint32_t seq, ImageWriteFn write, void* context);
+void serialDumpAddRows(SerialDumpEncoder& enc, const uint16_t* pixels, int firstRow, int rows);
+void serialDumpEnd(SerialDumpEncoder& enc);
+
+#endif
@@ -0,0 +1,184 @@
+#include "Arduino.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "input_latency.h"
+#include "log_ring.h"
+#include "task_trace.h"
+
+// Pending inputs older than this were never applied, such as a rotation
+// ignored in the reset prompt, and are dropped instead of being measured
+// against some later frame.
+static const uint32_t PENDING_TIMEOUT_US = 30UL * 1000000UL;
+
+static const char* TYPE_NAMES[INPUT_TYPE_COUNT] = {
+  "rotation",
+  "click",
+  "double_click",
+  "long_press",
+};
+static const uint32_t BUCKETS_MS[INPUT_LATENCY_BUCKET_COUNT] = INPUT_LATENCY_BUCKETS_MS;
+
+enum PendingState : uint8_t {
+  PENDING_NONE,
+  PENDING_INPUT,
+  PENDING_FRAME
+};
+
+struct InputHistogram {
+  uint32_t buckets[INPUT_LATENCY_BUCKET_COUNT + 1];
+  uint32_t count;
+  uint64_t sumUs;
+  uint32_t maxUs;
+};
+
+static PendingState pendingState[INPUT_TYPE_COUNT];
+static uint32_t pendingEdgeUs[INPUT_TYPE_COUNT];
+static InputHistogram histograms[INPUT_TYPE_COUNT];
+
+// Inputs come from the loop, applied ones also from the NTP task.
+static portMUX_TYPE latencyLock = portMUX_INITIALIZER_UNLOCKED;
+
+uint32_t inputLatencyNowUs() {
+  return (uint32_t)esp_timer_get_time();
+}
+
+void inputLatencyBegin(InputType type, uint32_t edgeUs) {
+  portENTER_CRITICAL(&latencyLock);
+  pendingState[type] = PENDING_INPUT;
+  pendingEdgeUs[type] = edgeUs;
+  portEXIT_CRITICAL(&latencyLock);
+}
+
+void inputLatencyApplied(InputType type) {
+  uint32_t nowUs = inputLatencyNowUs();
+  portENTER_CRITICAL(&latencyLock);
+  if (pendingState[type] == PENDING_INPUT) {
+    pendingState[type] = nowUs - pendingEdgeUs[type] < PENDING_TIMEOUT_US ? PENDING_FRAME : PENDING_NONE;
+  }
+  portEXIT_CRITICAL(&latencyLock);
+}
+
+bool inputLatencyAwaitingFrame() {
+  bool awaiting = false;
+  portENTER_CRITICAL(&latencyLock);
+  for (int i = 0; i < INPUT_TYPE_COUNT; i++) {
+    awaiting = awaiting || pendingState[i] == PENDING_FRAME;
+  }
+  portEXIT_CRITICAL(&latencyLock);
+  return awaiting;
+}
+
+static void addSample(InputHistogram& histogram, uint32_t latencyUs) {
+  int bucket = 0;
+  while (bucket < INPUT_LATENCY_BUCKET_COUNT && latencyUs > BUCKETS_MS[bucket] * 1000) {
+    bucket++;
+  }
+  histogram.buckets[bucket]++;
+  histogram.count++;
+  histogram.sumUs += latencyUs;
+  if (latencyUs > histogram.maxUs) {
+    histogram.maxUs = latencyUs;
+  }
+}
+
+bool inputLatencyFrameShown() {
+  uint32_t nowUs = inputLatencyNowUs();
+  uint32_t latencyUs[INPUT_TYPE_COUNT];
+  bool shown[INPUT_TYPE_COUNT] = {};
+  bool any = false;
+
+  portENTER_CRITICAL(&latencyLock);
+  for (int i = 0; i < INPUT_TYPE_COUNT; i++) {
+    if (pendingState[i] == PENDING_FRAME) {
+      pendingState[i] = PENDING_NONE;
+      latencyUs[i] = nowUs - pendingEdgeUs[i];
+      addSample(histograms[i], latencyUs[i]);
+      shown[i] = true;
+      any = true;
+    }
+  }
+  portEXIT_CRITICAL(&latencyLock);
+
+  for (int i = 0; i < INPUT_TYPE_COUNT; i++) {
+    if (shown[i]) {
+      TASK_TRACE_INSTANT("input_shown", (int32_t)latencyUs[i]);
+      logDebug("Input %s shown after %lu us", TYPE_NAMES[i], (unsigned long)latencyUs[i]);
+    }
+  }
+  return any;
+}
+
+static InputHistogram copyHistogram(int type) {
+  portENTER_CRITICAL(&latencyLock);
+  InputHistogram histogram = histograms[type];
+  portEXIT_CRITICAL(&latencyLock);
+  return histogram;
+}
+
+void inputLatencyWriteText(ImageWriteFn write, void* context) {
+  char line[REPORT_LINE_LENGTH];
+  int length = snprintf(
+    line, sizeof(line),
+    "# HELP clock_input_latency_seconds Time from the GPIO edge of an input to the end of the frame showing it\n"
+  );
+  writeTextLine(write, context, line, length);
+  length = snprintf(line, sizeof(line), "# TYPE clock_input_latency_seconds histogram\n");
+  writeTextLine(write, context, line, length);
+
+  for (int t = 0; t < INPUT_TYPE_COUNT; t++) {
+    InputHistogram histogram = copyHistogram(t);
+    uint32_t cumulative = 0;
+    for (int b = 0; b < INPUT_LATENCY_BUCKET_COUNT; b++) {
+      cumulative += histogram.buckets[b];
+      length = snprintf(
+        line, sizeof(line), "clock_input_latency_seconds_bucket{type=\"%s\",le=\"%lu.%03lu\"} %lu\n",
+        TYPE_NAMES[t], (unsigned long)(BUCKETS_MS[b] / 1000), (unsigned long)(BUCKETS_MS[b] % 1000), (unsigned long)cumulative
+      );
+      writeTextLine(write, context, line, length);
+    }
+    length = snprintf(
+      line, sizeof(line), "clock_input_latency_seconds_bucket{type=\"%s\",le=\"+Inf\"} %lu\n",
+      TYPE_NAMES[t], (unsigned long)histogram.count
+    );
+    writeTextLine(write, context, line, length);
+    length = snprintf(
+      line, sizeof(line), "clock_input_latency_seconds_sum{type=\"%s\"} %lu.%06lu\n",
+      TYPE_NAMES[t], (unsigned long)(histogram.sumUs / 1000000), (unsigned long)(histogram.sumUs % 1000000)
+    );
+    writeTextLine(write, context, line, length);
+    length = snprintf(
+      line, sizeof(line), "clock_input_latency_seconds_count{type=\"%s\"} %lu\n",
+      TYPE_NAMES[t], (unsigned long)histogram.count
+    );
+    writeTextLine(write, context, line, length);
+  }
+}
+
+void inputLatencyWriteReport(ImageWriteFn write, void* context) {
+  char line[REPORT_LINE_LENGTH];
+  int length = appendText(line, 0, "%-13s %6s %8s %8s", "input", "count", "mean_ms", "max_ms");
+  for (int b = 0; b < INPUT_LATENCY_BUCKET_COUNT; b++) {
+    // "<=" and up to ten digits.
+    char bucket[16];
+    snprintf(bucket, sizeof(bucket), "<=%lu", (unsigned long)BUCKETS_MS[b]);
+    length = appendText(line, length, " %6s", bucket);
+  }
+  length = appendText(line, length, " %6s\n", "more");
+  writeTextLine(write, context, line, length);
+
+  for (int t = 0; t < INPUT_TYPE_COUNT; t++) {
+    InputHistogram histogram = copyHistogram(t);
+    length = appendText(
+      line, 0, "%-13s %6lu %8lu %8lu",
+      TYPE_NAMES[t],
+      (unsigned long)histogram.count,
+      (unsigned long)(histogram.count > 0 ? histogram.sumUs / histogram.count / 1000 : 0),
+      (unsigned long)(histogram.maxUs / 1000)
+    );
+    for (int b = 0; b <= INPUT_LATENCY_BUCKET_COUNT; b++) {
+      length = appendText(line, length, " %6lu", (unsigned long)histogram.buckets[b]);
+    }
+    length = appendText(line, length, "\n");
+    writeTextLine(write, context, line, length);
+  }
+}
@@ -0,0 +1,51 @@
+#ifndef INPUT_LATENCY_H
+#define INPUT_LATENCY_H
+
+#include <stdint.h>
+#include "text_writer.h"
+
+// Input-to-photon latency. button.cpp stamps every GPIO edge of the buttons
+// and the encoder in an interrupt; when the polling code turns edges into
+// an input, the time of the last edge is kept as pending. The code that
+// acts on the input (face manager, NTP sync, reset prompt) marks it
+// applied, the render loop starts a frame for it right away, and when that
+// frame is drawn the time from the edge is added to the histogram of the
+// input type.
+//
+// Times are the low 32 bits of esp_timer_get_time(), which wrap after 71
+// minutes; an input is never pending that long.
+
+enum InputType {
+  INPUT_ROTATION,
+  INPUT_CLICK,
+  INPUT_DOUBLE_CLICK,
+  INPUT_LONG_PRESS,
+  INPUT_TYPE_COUNT
+};
+
+// Upper bounds of the histogram buckets in milliseconds; slower inputs go
+// into the +Inf bucket. A double click sync waits for the NTP task's next
+// check, up to 10 seconds.
+#define INPUT_LATENCY_BUCKET_COUNT 10
+#define INPUT_LATENCY_BUCKETS_MS { 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000 }
+
+uint32_t inputLatencyNowUs();
+// An input was recognised; edgeUs is the edge that completed it. Replaces
+// an earlier pending input of the same type.
+void inputLatencyBegin(InputType type, uint32_t edgeUs);
+// The input took effect and the next frame shows it. Does nothing when no
+// input of the type is pending, so it can be called from code that also
+// runs without one, such as a scheduled NTP sync.
+void inputLatencyApplied(InputType type);
+// True while an applied input waits for its frame.
+bool inputLatencyAwaitingFrame();
+// Called when a frame is drawn. Records the inputs it shows and returns
+// true if there were any.
+bool inputLatencyFrameShown();
+// Writes the histograms in the Prometheus text format, as
+// clock_input_latency_seconds{type="..."}.
+void inputLatencyWriteText(ImageWriteFn write, void* context);
+// One line per input type: count, mean, max and bucket counts.
+void inputLatencyWriteReport(ImageWriteFn write, void* context);
+
+#endif
@@ -0,0 +1,138 @@
+#include <atomic>
+#include "Arduino.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "log_ring.h"
+#include "metrics.h"
+#include "timing_constants.h"
+
+struct LogEntry {
+  uint32_t timeMs;
+  const char* format;
+  uintptr_t args[LOG_RING_MAX_ARGS];
+  uint8_t level;
+};
+
+static const char* LEVEL_NAMES[LOG_LEVEL_COUNT] = {
+  "error",
+  "warn",
+  "info",
+  "debug",
+};
+static const char LEVEL_LETTERS[LOG_LEVEL_COUNT] = { 'E', 'W', 'I', 'D' };
+
+static LogEntry ring[LOG_RING_ENTRIES];
+static uint32_t ringNext = 0;
+static uint32_t ringCount = 0;
+static uint32_t droppedSinceDrain = 0;
+static std::atomic<int> currentLevel(LOG_LEVEL_INFO);
+static TaskHandle_t logTaskHandle = NULL;
+
+// Taken from every task; held only to copy one entry.
+static portMUX_TYPE ringLock = portMUX_INITIALIZER_UNLOCKED;
+
+void logRingAppend(LogLevel level, const char* format, int argc, const uintptr_t* args) {
+  if (level > currentLevel.load(std::memory_order_relaxed)) {
+    return;
+  }
+  uint32_t timeMs = millis();
+
+  bool dropped = false;
+  portENTER_CRITICAL(&ringLock);
+  if (ringCount == LOG_RING_ENTRIES) {
+    droppedSinceDrain++;
+    dropped = true;
+  }
+  else {
+    LogEntry& entry = ring[(ringNext + ringCount) % LOG_RING_ENTRIES];
+    entry.timeMs = timeMs;
+    entry.format = format;
+    entry.level = (uint8_t)level;
+    for (int i = 0; i < LOG_RING_MAX_ARGS; i++) {
+      entry.args[i] = i < argc ? args[i] : 0;
+    }
+    ringCount++;
+  }
+  portEXIT_CRITICAL(&ringLock);
+
+  if (dropped) {
+    metricsAdd(METRIC_LOG_LINES_DROPPED, 1);
+  }
+}
+
+void logRingDrain() {
+  char line[160];
+  for (;;) {
+    LogEntry entry;
+    uint32_t dropped = 0;
+    portENTER_CRITICAL(&ringLock);
+    bool empty = ringCount == 0;
+    if (!empty) {
+      entry = ring[ringNext];
+      ringNext = (ringNext + 1) % LOG_RING_ENTRIES;
+      ringCount--;
+    }
+    else {
+      // The dropped lines came after the ones that were in the ring.
+      dropped = droppedSinceDrain;
+      droppedSinceDrain = 0;
+    }
+    portEXIT_CRITICAL(&ringLock);
+
+    if (empty) {
+      if (dropped > 0) {
+        Serial.print("Log ring full, lines dropped: ");
+        Serial.println(dropped);
+      }
+      return;
+    }
+
+    // Unused argument slots are zero, so passing all of them is safe for
+    // formats that take fewer.
+    int length = snprintf(line, sizeof(line), "[%lu %c] ", (unsigned long)entry.timeMs, LEVEL_LETTERS[entry.level]);
+    snprintf(line + length, sizeof(line) - length, entry.format, entry.args[0], entry.args[1], entry.args[2], entry.args[3]);
+    Serial.println(line);
+  }
+}
+
+static void logTask(void* parameter) {
+  for (;;) {
+    logRingDrain();
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+  }
+}
+
+void logRingTaskStart() {
+  xTaskCreatePinnedToCore(
+    logTask,
+    "LogDrain",
+    3072,
+    NULL,
+    0,  // below every other task, only runs when they are idle
+    &logTaskHandle,
+    0  // core 0
+  );
+  Serial.println("Log drain task started on core 0.");
+}
+
+void logRingSetLevel(LogLevel level) {
+  currentLevel = level;
+}
+
+LogLevel logRingGetLevel() {
+  return (LogLevel)currentLevel.load();
+}
+
+const char* logLevelName(LogLevel level) {
+  return LEVEL_NAMES[level];
+}
+
+bool logLevelFromName(const char* name, LogLevel* level) {
+  for (int i = 0; i < LOG_LEVEL_COUNT; i++) {
+    if (strcmp(name, LEVEL_NAMES[i]) == 0) {
+      *level = (LogLevel)i;
+      return true;
+    }
+  }
+  return false;
+}
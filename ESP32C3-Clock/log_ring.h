@@ -0,0 +1,72 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Deferred logging for the input and render paths. A log call stores the
+// format pointer and up to LOG_RING_MAX_ARGS arguments in a RAM ring and
+// returns; the LogDrain task formats and prints the lines later, so the
+// caller never waits for the UART. When the ring is full the line is
+// dropped and counted in clock_log_lines_dropped_total.
+//
+// Formats must be string literals. Arguments are stored as words, so only
+// integers up to 32 bits (%d, %u, %x, %ld, %lu) and strings that outlive
+// the line, such as face ids, (%s) can be printed.
+
+#define LOG_RING_ENTRIES 64
+#define LOG_RING_MAX_ARGS 4
+
+enum LogLevel {
+  LOG_LEVEL_ERROR,
+  LOG_LEVEL_WARN,
+  LOG_LEVEL_INFO,
+  LOG_LEVEL_DEBUG,
+  LOG_LEVEL_COUNT
+};
+
+void logRingTaskStart();
+// Lines above the level are dropped when logged. LOG_LEVEL_INFO by default.
+void logRingSetLevel(LogLevel level);
+LogLevel logRingGetLevel();
+const char* logLevelName(LogLevel level);
+// Returns false when name is not a level name.
+bool logLevelFromName(const char* name, LogLevel* level);
+// Prints the lines waiting in the ring. Called by the LogDrain task.
+void logRingDrain();
+void logRingAppend(LogLevel level, const char* format, int argc, const uintptr_t* args);
+
+inline uintptr_t logArg(int value) { return (uintptr_t)value; }
+inline uintptr_t logArg(unsigned int value) { return (uintptr_t)value; }
+inline uintptr_t logArg(long value) { return (uintptr_t)value; }
+inline uintptr_t logArg(unsigned long value) { return (uintptr_t)value; }
+inline uintptr_t logArg(const char* value) { return (uintptr_t)value; }
+
+template <typename... Args>
+inline void logLine(LogLevel level, const char* format, Args... args) {
+  static_assert(sizeof...(Args) <= LOG_RING_MAX_ARGS, "too many log arguments");
+  uintptr_t values[LOG_RING_MAX_ARGS + 1] = { logArg(args)... };
+  logRingAppend(level, format, sizeof...(Args), values);
+}
+
+template <typename... Args>
+inline void logError(const char* format, Args... args) {
+  logLine(LOG_LEVEL_ERROR, format, args...);
+}
+
+template <typename... Args>
+inline void logWarn(const char* format, Args... args) {
+  logLine(LOG_LEVEL_WARN, format, args...);
+}
+
+template <typename... Args>
+inline void logInfo(const char* format, Args... args) {
+  logLine(LOG_LEVEL_INFO, format, args...);
+}
+
+template <typename... Args>
+inline void logDebug(const char* format, Args... args) {
+  logLine(LOG_LEVEL_DEBUG, format, args...);
+}
+
+#endif
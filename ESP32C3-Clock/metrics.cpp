@@ -0,0 +1,241 @@
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "metrics.h"
+#include "log_ring.h"
+
+// Order must match the MetricId enum in metrics.h.
+static const MetricInfo metricInfos[METRIC_COUNT] = {
+  { "clock_radio_on_last_seconds",                METRIC_GAUGE,        METRIC_UNIT_MS,   "Radio-on time of the last power save sync cycle" },
+  { "clock_radio_on_seconds_total",               METRIC_COUNTER,      METRIC_UNIT_MS,   "Accumulated radio-on time of power save sync cycles" },
+  { "clock_wifi_reconnect_last_seconds",          METRIC_GAUGE,        METRIC_UNIT_MS,   "Duration of the last WiFi reconnect" },
+  { "clock_wifi_fast_reconnects_total",           METRIC_COUNTER,      METRIC_UNIT_NONE, "Reconnects that reused the cached BSSID and channel" },
+  { "clock_wifi_full_reconnects_total",           METRIC_COUNTER,      METRIC_UNIT_NONE, "Reconnects that needed a full scan" },
+  { "clock_wifi_reconnect_failures_total",        METRIC_COUNTER,      METRIC_UNIT_NONE, "Reconnects that fell back to the full connect of the config portal" },
+  { "clock_wifi_reconnect_seconds_total",         METRIC_COUNTER,      METRIC_UNIT_MS,   "Accumulated duration of WiFi reconnects" },
+  { "clock_dns_cache_hits_total",                 METRIC_COUNTER,      METRIC_UNIT_NONE, "NTP server lookups answered from the DNS cache" },
+  { "clock_dns_cache_misses_total",               METRIC_COUNTER,      METRIC_UNIT_NONE, "NTP server lookups that went to DNS" },
+  { "clock_dns_stale_fallbacks_total",            METRIC_COUNTER,      METRIC_UNIT_NONE, "Lookups answered with an expired entry because DNS failed" },
+  { "clock_ntp_rtt_last_seconds",                 METRIC_GAUGE,        METRIC_UNIT_MS,   "Time from request to answer of the last successful NTP sync" },
+  { "clock_ntp_offset_last_seconds",              METRIC_SIGNED_GAUGE, METRIC_UNIT_MS,   "Step the last NTP sync applied to a clock that was already set" },
+  { "clock_frames_total",                         METRIC_COUNTER,      METRIC_UNIT_NONE, "Frames drawn by a clock face" },
+  { "clock_frame_draw_last_seconds",              METRIC_GAUGE,        METRIC_UNIT_US,   "Draw time of the last frame" },
+  { "clock_frame_draw_max_seconds",               METRIC_GAUGE,        METRIC_UNIT_US,   "Longest draw time of a frame" },
+  { "clock_frame_draw_seconds_total",             METRIC_COUNTER,      METRIC_UNIT_US,   "Accumulated draw time of all frames" },
+  { "clock_frame_align_last_seconds",             METRIC_GAUGE,        METRIC_UNIT_US,   "Delay between the last second boundary and the start of its frame" },
+  { "clock_frame_align_max_seconds",              METRIC_GAUGE,        METRIC_UNIT_US,   "Largest delay between a second boundary and the start of its frame" },
+  { "clock_frame_done_last_seconds",              METRIC_GAUGE,        METRIC_UNIT_US,   "Delay between the last second boundary and the end of its frame" },
+  { "clock_heap_free_bytes",                      METRIC_GAUGE,        METRIC_UNIT_NONE, "Free 8-bit capable heap" },
+  { "clock_heap_min_free_bytes",                  METRIC_GAUGE,        METRIC_UNIT_NONE, "Lowest free heap since boot" },
+  { "clock_heap_largest_block_bytes",             METRIC_GAUGE,        METRIC_UNIT_NONE, "Largest free contiguous heap block" },
+  { "clock_heap_fragmentation_percent",           METRIC_GAUGE,        METRIC_UNIT_NONE, "Share of the free heap outside the largest block" },
+  { "clock_heap_alloc_failures_total",            METRIC_COUNTER,      METRIC_UNIT_NONE, "Heap allocations that failed" },
+  { "clock_heap_alloc_failed_last_bytes",         METRIC_GAUGE,        METRIC_UNIT_NONE, "Size of the last failed heap allocation" },
+  { "clock_shadow_framebuffer_bytes",             METRIC_GAUGE,        METRIC_UNIT_NONE, "Heap held by the shadow framebuffer" },
+  { "clock_stack_free_min_loop_bytes",            METRIC_GAUGE,        METRIC_UNIT_NONE, "Smallest free stack of the Arduino loop task" },
+  { "clock_stack_free_min_startup_screen_bytes",  METRIC_GAUGE,        METRIC_UNIT_NONE, "Smallest free stack of the StartupScreen task" },
+  { "clock_stack_free_min_ntp_bytes",             METRIC_GAUGE,        METRIC_UNIT_NONE, "Smallest free stack of the NtpTask task" },
+  { "clock_stack_free_min_wifi_monitor_bytes",    METRIC_GAUGE,        METRIC_UNIT_NONE, "Smallest free stack of the WifiMonitor task" },
+  { "clock_stack_free_min_config_portal_bytes",   METRIC_GAUGE,        METRIC_UNIT_NONE, "Smallest free stack of the ConfigPortal task" },
+  { "clock_stack_free_min_web_server_bytes",      METRIC_GAUGE,        METRIC_UNIT_NONE, "Smallest free stack of the WebServer task" },
+  { "clock_stack_free_min_serial_console_bytes",  METRIC_GAUGE,        METRIC_UNIT_NONE, "Smallest free stack of the SerialConsole task" },
+  { "clock_stack_free_min_system_monitor_bytes",  METRIC_GAUGE,        METRIC_UNIT_NONE, "Smallest free stack of the SystemMonitor task" },
+  { "clock_stack_free_min_log_drain_bytes",       METRIC_GAUGE,        METRIC_UNIT_NONE, "Smallest free stack of the LogDrain task" },
+  { "clock_stack_free_min_render_watchdog_bytes", METRIC_GAUGE,        METRIC_UNIT_NONE, "Smallest free stack of the RenderWatchdog task" },
+  { "clock_telemetry_batches_total",              METRIC_COUNTER,      METRIC_UNIT_NONE, "Telemetry batches pushed to the collector" },
+  { "clock_telemetry_events_dropped_total",       METRIC_COUNTER,      METRIC_UNIT_NONE, "Telemetry events dropped because the backlog was full" },
+  { "clock_log_lines_dropped_total",              METRIC_COUNTER,      METRIC_UNIT_NONE, "Deferred log lines dropped because the ring was full" },
+  { "clock_render_stalls_total",                  METRIC_COUNTER,      METRIC_UNIT_NONE, "Times no frame was finished within the render stall timeout" },
+  { "clock_render_stall_last_seconds",            METRIC_GAUGE,        METRIC_UNIT_MS,   "Time without a finished frame in the last render stall" },
+  { "clock_render_stall_before_reset_seconds",    METRIC_GAUGE,        METRIC_UNIT_MS,   "Time without a finished frame in a render stall before the last soft reset, 0 if there was none" },
+};
+
+// Order must match the MetricFamilyId enum in metrics.h.
+static const MetricFamilyInfo familyInfos[METRIC_FAMILY_COUNT] = {
+  { "clock_ntp_syncs_ok_total",     "server", "Successful NTP syncs" },
+  { "clock_ntp_syncs_failed_total", "server", "NTP servers that did not answer or could not be resolved" },
+  { "clock_face_redraws_total",     "face",   "Frames drawn per clock face" },
+};
+
+static std::atomic<uint32_t> metricValues[METRIC_COUNT];
+
+struct LabelSlot {
+  char value[METRIC_LABEL_LENGTH];
+  std::atomic<uint32_t> count;
+};
+
+// Slots are filled once and never change their label, so lookups only lock
+// to add a new one.
+struct FamilyState {
+  LabelSlot slots[METRIC_FAMILY_SLOTS];
+  std::atomic<int> used;
+};
+
+static FamilyState families[METRIC_FAMILY_COUNT];
+static std::mutex familyMutex;
+
+void metricsAdd(MetricId id, uint32_t delta) {
+  metricValues[id] += delta;
+}
+
+void metricsSet(MetricId id, uint32_t value) {
+  metricValues[id] = value;
+}
+
+uint32_t metricsGet(MetricId id) {
+  return metricValues[id];
+}
+
+const MetricInfo& metricsInfo(MetricId id) {
+  return metricInfos[id];
+}
+
+static LabelSlot* findSlot(FamilyState& family, const char* labelValue, int used) {
+  for (int i = 0; i < used; i++) {
+    if (strncmp(family.slots[i].value, labelValue, METRIC_LABEL_LENGTH - 1) == 0) {
+      return &family.slots[i];
+    }
+  }
+  return NULL;
+}
+
+void metricsAddLabeled(MetricFamilyId id, const char* labelValue, uint32_t delta) {
+  FamilyState& family = families[id];
+  LabelSlot* slot = findSlot(family, labelValue, family.used);
+  if (slot == NULL) {
+    std::lock_guard<std::mutex> lock(familyMutex);
+    int used = family.used;
+    slot = findSlot(family, labelValue, used);
+    if (slot == NULL) {
+      if (used == METRIC_FAMILY_SLOTS) {
+        return;
+      }
+      slot = &family.slots[used];
+      strncpy(slot->value, labelValue, METRIC_LABEL_LENGTH - 1);
+      slot->value[METRIC_LABEL_LENGTH - 1] = '\0';
+      family.used = used + 1;
+    }
+  }
+  slot->count += delta;
+}
+
+const MetricFamilyInfo& metricsFamilyInfo(MetricFamilyId id) {
+  return familyInfos[id];
+}
+
+int metricsFamilySize(MetricFamilyId id) {
+  return families[id].used;
+}
+
+const char* metricsFamilyLabel(MetricFamilyId id, int index) {
+  return families[id].slots[index].value;
+}
+
+uint32_t metricsFamilyGet(MetricFamilyId id, int index) {
+  return families[id].slots[index].count;
+}
+
+static const char* typeName(MetricType type) {
+  return type == METRIC_COUNTER ? "counter" : "gauge";
+}
+
+int metricsFormatValue(MetricId id, uint32_t value, char* out, size_t size) {
+  const MetricInfo& info = metricInfos[id];
+  bool negative = info.type == METRIC_SIGNED_GAUGE && (int32_t)value < 0;
+  unsigned long magnitude = negative ? (unsigned long)(-(int64_t)(int32_t)value) : (unsigned long)value;
+  const char* sign = negative ? "-" : "";
+  switch (info.unit) {
+    case METRIC_UNIT_MS:
+      return snprintf(out, size, "%s%lu.%03lu", sign, magnitude / 1000, magnitude % 1000);
+    case METRIC_UNIT_US:
+      return snprintf(out, size, "%s%lu.%06lu", sign, magnitude / 1000000, magnitude % 1000000);
+    case METRIC_UNIT_NONE:
+    default:
+      return snprintf(out, size, "%s%lu", sign, magnitude);
+  }
+}
+
+static const int TEXT_LINE_LENGTH = 192;
+
+static void writeText(ImageWriteFn write, void* context, const char* text) {
+  write((const uint8_t*)text, strlen(text), context);
+}
+
+// Every write may be a chunk of its own on the wire, so the header goes
+// out in one piece when it fits the line buffer, and piece by piece, never
+// cut off, when the help text is longer.
+static void writeHeader(ImageWriteFn write, void* context, const char* name, const char* help, const char* type) {
+  char line[TEXT_LINE_LENGTH];
+  int length = snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+  if (length > 0 && length < TEXT_LINE_LENGTH) {
+    write((const uint8_t*)line, length, context);
+    return;
+  }
+  writeText(write, context, "# HELP ");
+  writeText(write, context, name);
+  writeText(write, context, " ");
+  writeText(write, context, help);
+  writeText(write, context, "\n# TYPE ");
+  writeText(write, context, name);
+  writeText(write, context, " ");
+  writeText(write, context, type);
+  writeText(write, context, "\n");
+}
+
+// snprintf() returns the untruncated length. A cut off sample would break
+// the exposition, so it is dropped and logged instead.
+static void writeSample(ImageWriteFn write, void* context, const char* name, const char* line, int length) {
+  if (length <= 0 || length >= TEXT_LINE_LENGTH) {
+    logError("Metric sample of %s does not fit a line, dropped", name);
+    return;
+  }
+  write((const uint8_t*)line, length, context);
+}
+
+// Label values are host and face names; quotes and backslashes are dropped
+// rather than escaped.
+static void copyLabel(char* out, const char* value) {
+  int n = 0;
+  for (const char* c = value; *c != '\0' && n < METRIC_LABEL_LENGTH - 1; c++) {
+    if (*c != '"' && *c != '\\' && *c != '\n') {
+      out[n++] = *c;
+    }
+  }
+  out[n] = '\0';
+}
+
+void metricsWriteText(ImageWriteFn write, void* context) {
+  char line[TEXT_LINE_LENGTH];
+  int length;
+
+  for (int i = 0; i < METRIC_COUNT; i++) {
+    const MetricInfo& info = metricInfos[i];
+    char value[24];
+    metricsFormatValue((MetricId)i, metricValues[i], value, sizeof(value));
+    writeHeader(write, context, info.name, info.help, typeName(info.type));
+    length = snprintf(line, sizeof(line), "%s %s\n", info.name, value);
+    writeSample(write, context, info.name, line, length);
+  }
+
+  for (int f = 0; f < METRIC_FAMILY_COUNT; f++) {
+    const MetricFamilyInfo& info = familyInfos[f];
+    FamilyState& family = families[f];
+    writeHeader(write, context, info.name, info.help, "counter");
+    int used = family.used;
+    for (int i = 0; i < used; i++) {
+      char label[METRIC_LABEL_LENGTH];
+      copyLabel(label, family.slots[i].value);
+      length = snprintf(
+        line, sizeof(line), "%s{%s=\"%s\"} %lu\n",
+        info.name, info.label, label, (unsigned long)family.slots[i].count
+      );
+      writeSample(write, context, info.name, line, length);
+    }
+  }
+
+  writeHeader(write, context, "clock_uptime_seconds", "Time since boot", "gauge");
+  length = snprintf(line, sizeof(line), "clock_uptime_seconds %lu\n", (unsigned long)(esp_timer_get_time() / 1000000LL));
+  writeSample(write, context, "clock_uptime_seconds", line, length);
+}
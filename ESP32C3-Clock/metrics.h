@@ -0,0 +1,138 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <cstdint>
+#include <stddef.h>
+#include "text_writer.h"
+
+enum MetricType {
+  METRIC_COUNTER,
+  METRIC_GAUGE,
+  // A gauge whose value is stored as int32_t.
+  METRIC_SIGNED_GAUGE
+};
+
+// The unit a metric is stored in. Times are exposed in seconds whatever
+// they are stored in, and counters end in _total, as Prometheus names them.
+enum MetricUnit {
+  METRIC_UNIT_NONE,
+  METRIC_UNIT_MS,
+  METRIC_UNIT_US
+};
+
+enum MetricId {
+  // WiFi radio.
+  METRIC_RADIO_ON_LAST_MS,
+  METRIC_RADIO_ON_TOTAL_MS,
+  METRIC_WIFI_RECONNECT_LAST_MS,
+  METRIC_WIFI_FAST_RECONNECTS,
+  METRIC_WIFI_FULL_RECONNECTS,
+  METRIC_WIFI_RECONNECT_FAILURES,
+  METRIC_WIFI_RECONNECT_TOTAL_MS,
+
+  // DNS cache.
+  METRIC_DNS_CACHE_HITS,
+  METRIC_DNS_CACHE_MISSES,
+  METRIC_DNS_STALE_FALLBACKS,
+
+  // NTP, per server counts are in METRIC_FAMILY_NTP_SYNCS_*.
+  METRIC_NTP_RTT_LAST_MS,
+  METRIC_NTP_OFFSET_LAST_MS,
+
+  // Frames drawn by redrawDisplay(), per face counts are in
+  // METRIC_FAMILY_FACE_REDRAWS.
+  METRIC_FRAMES,
+  METRIC_FRAME_DRAW_LAST_US,
+  METRIC_FRAME_DRAW_MAX_US,
+  METRIC_FRAME_DRAW_TOTAL_US,
+
+  // Second boundary alignment of the render loop.
+  METRIC_FRAME_ALIGN_LAST_US,
+  METRIC_FRAME_ALIGN_MAX_US,
+  METRIC_FRAME_DONE_LAST_US,
+
+  // Heap, sampled by the system monitor.
+  METRIC_HEAP_FREE_BYTES,
+  METRIC_HEAP_MIN_FREE_BYTES,
+  METRIC_HEAP_LARGEST_BLOCK_BYTES,
+  METRIC_HEAP_FRAGMENTATION_PERCENT,
+  METRIC_HEAP_ALLOC_FAILURES,
+  METRIC_HEAP_ALLOC_FAILED_LAST_BYTES,
+  // Set once at boot, 0 when the shadow framebuffer is not allocated.
+  METRIC_SHADOW_FRAMEBUFFER_BYTES,
+
+  // Smallest free stack each task has had, in bytes. 0 until sampled.
+  METRIC_STACK_FREE_LOOP,
+  METRIC_STACK_FREE_STARTUP_SCREEN,
+  METRIC_STACK_FREE_NTP,
+  METRIC_STACK_FREE_WIFI_MONITOR,
+  METRIC_STACK_FREE_CONFIG_PORTAL,
+  METRIC_STACK_FREE_WEB_SERVER,
+  METRIC_STACK_FREE_SERIAL_CONSOLE,
+  METRIC_STACK_FREE_SYSTEM_MONITOR,
+  METRIC_STACK_FREE_LOG_DRAIN,
+  METRIC_STACK_FREE_RENDER_WATCHDOG,
+
+  // Telemetry push.
+  METRIC_TELEMETRY_BATCHES,
+  METRIC_TELEMETRY_EVENTS_DROPPED,
+
+  // Deferred logging.
+  METRIC_LOG_LINES_DROPPED,
+
+  // Render stall watchdog.
+  METRIC_RENDER_STALLS,
+  METRIC_RENDER_STALL_LAST_MS,
+  METRIC_RENDER_STALL_BEFORE_RESET_MS,
+
+  METRIC_COUNT
+};
+
+// Counters split by one label, such as the NTP server. Each family keeps
+// up to METRIC_FAMILY_SLOTS label values; further values are dropped.
+enum MetricFamilyId {
+  METRIC_FAMILY_NTP_SYNCS_OK,
+  METRIC_FAMILY_NTP_SYNCS_FAILED,
+  METRIC_FAMILY_FACE_REDRAWS,
+
+  METRIC_FAMILY_COUNT
+};
+
+#define METRIC_FAMILY_SLOTS 8
+#define METRIC_LABEL_LENGTH 40
+
+struct MetricInfo {
+  const char* name;
+  MetricType type;
+  MetricUnit unit;
+  const char* help;
+};
+
+struct MetricFamilyInfo {
+  const char* name;
+  const char* label;
+  const char* help;
+};
+
+void metricsAdd(MetricId id, uint32_t delta);
+void metricsSet(MetricId id, uint32_t value);
+uint32_t metricsGet(MetricId id);
+const MetricInfo& metricsInfo(MetricId id);
+// Formats a value or a counter delta of the metric in its exposed unit.
+// Returns the length as snprintf() does.
+int metricsFormatValue(MetricId id, uint32_t value, char* out, size_t size);
+
+// The label value is copied, so it need not outlive the call.
+void metricsAddLabeled(MetricFamilyId id, const char* labelValue, uint32_t delta);
+const MetricFamilyInfo& metricsFamilyInfo(MetricFamilyId id);
+// Number of label values seen so far. Slots keep their index.
+int metricsFamilySize(MetricFamilyId id);
+const char* metricsFamilyLabel(MetricFamilyId id, int index);
+uint32_t metricsFamilyGet(MetricFamilyId id, int index);
+
+// Writes every metric in the Prometheus text exposition format, one line at
+// a time, followed by clock_uptime_seconds. A sample line that does not fit
+// the line buffer is dropped and logged rather than cut off.
+void metricsWriteText(ImageWriteFn write, void* context);
+
+#endif
@@ -1,13 +1,22 @@
 #include <WiFi.h>
 #include <time.h>
+#include <sys/time.h>
 #include "Arduino.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_sntp.h"
+#include "esp_timer.h"
 
 #include "ntp.h"
 #include "config.h"
 #include "app_state.h"
 #include "timing_constants.h"
+#include "metrics.h"
+#include "dns_cache.h"
+#include "telemetry.h"
+#include "task_trace.h"
+#include "input_latency.h"
+#include "energy.h"
 
 static TaskHandle_t ntpTaskHandle = NULL;
 
@@ -19,6 +28,7 @@ static void ntpStatusCallback(const char* msg) {
 
 static void ntpTask(void* parameter) {
   static unsigned long wifiOffAt = 0;
+  static unsigned long radioOnAt = 0;
   if (getAppState() == CONNECTED_SYNCED) {
     wifiOffAt = millis();
   }
@@ -28,9 +38,12 @@ static void ntpTask(void* parameter) {
     bool syncNeeded = isNtpSyncRequested() || isNtpSyncDue();
 
     if (state == SYNCED_WIFI_OFF && syncNeeded) {
+      radioOnAt = millis();
       if (reconnectWifi()) {
+        // A fast reconnect to the cached access point is usable right away;
+        // a full connect gets time to settle before the first NTP packet.
         Serial.println("Waiting before NTP sync...");
-        vTaskDelay(pdMS_TO_TICKS(NTP_SYNC_DELAY_MS));
+        vTaskDelay(pdMS_TO_TICKS(wasFastReconnect() ? NTP_SYNC_DELAY_FAST_MS : NTP_SYNC_DELAY_MS));
       }
       state = getAppState();
     }
@@ -39,16 +52,30 @@ static void ntpTask(void* parameter) {
       if (syncNeeded) {
         clearNtpSyncRequest();
         syncTimeWithNTP(ntpStatusCallback);
+        // The radio is up for the sync anyway.
+        telemetryPush();
         wifiOffAt = millis();
       }
 
       if (getPowersafeMode()) {
         if (wifiOffAt > 0 && (millis() - wifiOffAt) >= WIFI_OFF_AFTER_SYNC_MS) {
           Serial.println("Turning WiFi off for power saving...");
+          TASK_TRACE_INSTANT("wifi_off", 0);
+          // Set the state first so the WiFi monitor ignores the disconnect event.
+          setAppState(SYNCED_WIFI_OFF);
           WiFi.disconnect(true);
           WiFi.mode(WIFI_OFF);
+          energyRadioOff();
           wifiOffAt = 0;
-          setAppState(SYNCED_WIFI_OFF);
+
+          if (radioOnAt > 0) {
+            unsigned long radioOnMs = millis() - radioOnAt;
+            metricsSet(METRIC_RADIO_ON_LAST_MS, radioOnMs);
+            metricsAdd(METRIC_RADIO_ON_TOTAL_MS, radioOnMs);
+            radioOnAt = 0;
+            Serial.print("Radio was on for ms: ");
+            Serial.println(radioOnMs);
+          }
         }
         else {
           Serial.println("Power saving mode active. Delay...");
@@ -74,13 +101,17 @@ void ntpTaskStart() {
 }
 
 void syncTimeWithNTP(void (*onStatus)(const char*)) {
+  TASK_TRACE_SCOPE("ntp_sync");
   setAppState(CONNECTED_SYNCING);
+  // A sync asked for with a double click shows up as the sync icon.
+  inputLatencyApplied(INPUT_DOUBLE_CLICK);
 
   if (WiFi.status() == WL_CONNECTED) {
     Serial.println("\nSynchronizing time with NTP server...");
 
+    String configuredServer = getNTPServer();
     const char* ntpServerList[] = {
-      getNTPServer().c_str(),
+      configuredServer.c_str(),
       "pool.ntp.org",
       "time.google.com",
       "time.cloudflare.com",
@@ -88,6 +119,8 @@ void syncTimeWithNTP(void (*onStatus)(const char*)) {
       "hu.pool.ntp.org"
     };
 
+    // SNTP keeps the pointer it is given, so the address must outlive the call.
+    static char serverAddress[16];
     bool timeSet = false;
 
     for (int serverIdx = 0; serverIdx < 6 && !timeSet; serverIdx++) {
@@ -98,22 +131,60 @@ void syncTimeWithNTP(void (*onStatus)(const char*)) {
         continue;
       }
 
-      Serial.print("Trying NTP server: ");
-      Serial.println(server);
-
-      configTzTime(getTimezone().c_str(), server);
+      IPAddress address;
+      if (!dnsCacheLookup(server, address)) {
+        Serial.print("Cannot resolve NTP server: ");
+        Serial.println(server);
+        metricsAddLabeled(METRIC_FAMILY_NTP_SYNCS_FAILED, server, 1);
+        continue;
+      }
+      strncpy(serverAddress, address.toString().c_str(), sizeof(serverAddress) - 1);
+      serverAddress[sizeof(serverAddress) - 1] = '\0';
 
-      struct tm timeinfo;
-      int attempts = 0;
-      while (!getLocalTime(&timeinfo) && attempts < 10) {
-        Serial.print(".");
-        delay(500);
-        yield();
-        attempts++;
+      Serial.print("Trying NTP server: ");
+      Serial.print(server);
+      Serial.print(" (");
+      Serial.print(serverAddress);
+      Serial.println(")");
+
+      // The step the sync applies is how far the wall clock moved beyond
+      // the monotonic time that passed.
+      struct timeval wallBefore;
+      gettimeofday(&wallBefore, NULL);
+      int64_t monotonicBeforeUs = esp_timer_get_time();
+
+      // SNTP's own hourly resync leaves COMPLETED behind while WiFi stays
+      // up, which would pass for the reply to this request with an RTT of
+      // zero. Reset it so only this request's reply counts.
+      sntp_set_sync_status(SNTP_SYNC_STATUS_RESET);
+      unsigned long requestedAt = millis();
+      configTzTime(getTimezone().c_str(), serverAddress);
+
+      // Wait for the SNTP reply itself; getLocalTime() already succeeds on
+      // every sync after the first one.
+      bool answered = false;
+      while (!answered && (millis() - requestedAt) < NTP_SERVER_TIMEOUT_MS) {
+        answered = sntp_get_sync_status() == SNTP_SYNC_STATUS_COMPLETED;
+        if (!answered) {
+          delay(NTP_SYNC_POLL_MS);
+        }
       }
+      unsigned long rttMs = millis() - requestedAt;
+      dnsCacheReportResult(server, address, answered, rttMs);
 
-      if (getLocalTime(&timeinfo)) {
-        Serial.println("\nTime synchronized successfully!");
+      struct tm timeinfo;
+      if (answered && getLocalTime(&timeinfo)) {
+        Serial.print("\nTime synchronized successfully in ms: ");
+        Serial.println(rttMs);
+        metricsAddLabeled(METRIC_FAMILY_NTP_SYNCS_OK, server, 1);
+        metricsSet(METRIC_NTP_RTT_LAST_MS, rttMs);
+        if (wallBefore.tv_sec > TIME_VALID_AFTER_EPOCH) {
+          struct timeval wallAfter;
+          gettimeofday(&wallAfter, NULL);
+          int64_t wallUs = (int64_t)(wallAfter.tv_sec - wallBefore.tv_sec) * 1000000LL + (wallAfter.tv_usec - wallBefore.tv_usec);
+          int64_t offsetMs = (wallUs - (esp_timer_get_time() - monotonicBeforeUs)) / 1000;
+          metricsSet(METRIC_NTP_OFFSET_LAST_MS, (uint32_t)(int32_t)offsetMs);
+        }
         Serial.printf(
           "Time: %02d:%02d:%02d\n",
           timeinfo.tm_hour,
@@ -128,11 +199,13 @@ void syncTimeWithNTP(void (*onStatus)(const char*)) {
       }
       else {
         Serial.println(" Failed!");
+        metricsAddLabeled(METRIC_FAMILY_NTP_SYNCS_FAILED, server, 1);
       }
     }
 
     if (!timeSet) {
       setAppState(CONNECTED_NOT_SYNCED);
+      telemetryEvent("ntp_sync_failed", 1);
       onStatus("Sync failed");
       Serial.println("Failed with all NTP servers!");
     }
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include "Arduino.h"
+#include "render_profile.h"
+#include "display.h"
+
+static const char* STAGE_NAMES[RENDER_STAGE_COUNT] = {
+  "frame",
+  "background",
+  "hands",
+  "arcs",
+  "text",
+  "icons",
+  "overlay",
+};
+
+const char* renderProfileStageName(RenderStage stage) {
+  return STAGE_NAMES[stage];
+}
+
+#if RENDER_PROFILE
+
+struct StageWindow {
+  uint32_t us[RENDER_PROFILE_WINDOW];
+  uint32_t runs;
+  uint64_t calls;
+  uint64_t pixels;
+  uint64_t spiBytes;
+};
+
+struct FaceProfile {
+  const char* id;
+  StageWindow stages[RENDER_STAGE_COUNT];
+};
+
+struct StageTotals {
+  bool ran;
+  uint32_t cycles;
+  uint32_t calls;
+  uint32_t pixels;
+  uint32_t spiBytes;
+};
+
+// Written by the render loop under the display mutex, so like the display
+// trace the profile needs no lock of its own.
+static FaceProfile faces[RENDER_PROFILE_MAX_FACES];
+static int faceCount = 0;
+static FaceProfile* currentFace = NULL;
+static StageTotals frameTotals[RENDER_STAGE_COUNT];
+static int stageDepth = 0;
+static int callDepth = 0;
+
+// Running counts of everything sent to TFT_display. Stages keep the values
+// they started at, so the counts may wrap.
+static uint32_t callCount = 0;
+static uint32_t pixelCount = 0;
+static uint32_t byteCount = 0;
+static uint32_t lastFrameBytes = 0;
+
+static FaceProfile* findFace(const char* faceId) {
+  for (int i = 0; i < faceCount; i++) {
+    if (strcmp(faces[i].id, faceId) == 0) {
+      return &faces[i];
+    }
+  }
+  if (faceCount == RENDER_PROFILE_MAX_FACES) {
+    return NULL;
+  }
+  FaceProfile* face = &faces[faceCount++];
+  memset(face, 0, sizeof(*face));
+  face->id = faceId;
+  return face;
+}
+
+static void addToFrame(RenderStage stage, uint32_t cycles, uint32_t calls, uint32_t pixels, uint32_t spiBytes) {
+  StageTotals& totals = frameTotals[stage];
+  totals.ran = true;
+  totals.cycles += cycles;
+  totals.calls += calls;
+  totals.pixels += pixels;
+  totals.spiBytes += spiBytes;
+}
+
+void renderProfileCountPixels(uint32_t pixels, uint32_t spiBytes) {
+  pixelCount += pixels;
+  byteCount += spiBytes;
+}
+
+uint32_t renderProfileLastFrameSpiBytes() {
+  return lastFrameBytes;
+}
+
+void renderProfileReset() {
+  takeDisplayMutex();
+  faceCount = 0;
+  giveDisplayMutex();
+}
+
+void renderProfileWrite(ImageWriteFn write, void* context) {
+  char line[96];
+  int length = snprintf(
+    line, sizeof(line), "%-14s %-10s %6s %7s %7s %7s %6s %7s %9s\n",
+    "face", "stage", "runs", "p50_us", "p95_us", "max_us", "calls", "pixels", "spi_bytes"
+  );
+  write((const uint8_t*)line, length, context);
+
+  takeDisplayMutex();
+  int count = faceCount;
+  giveDisplayMutex();
+
+  for (int f = 0; f < count; f++) {
+    for (int s = 0; s < RENDER_STAGE_COUNT; s++) {
+      StageWindow window;
+      takeDisplayMutex();
+      const char* faceId = faces[f].id;
+      window = faces[f].stages[s];
+      giveDisplayMutex();
+      if (window.runs == 0) {
+        continue;
+      }
+
+      // Only the window is sorted; calls, pixels and bytes are averages over
+      // all runs.
+      uint32_t n = window.runs < RENDER_PROFILE_WINDOW ? window.runs : RENDER_PROFILE_WINDOW;
+      std::sort(window.us, window.us + n);
+      length = snprintf(
+        line, sizeof(line), "%-14s %-10s %6lu %7lu %7lu %7lu %6lu %7lu %9lu\n",
+        faceId,
+        STAGE_NAMES[s],
+        (unsigned long)window.runs,
+        (unsigned long)window.us[(n - 1) * 50 / 100],
+        (unsigned long)window.us[(n - 1) * 95 / 100],
+        (unsigned long)window.us[n - 1],
+        (unsigned long)(window.calls / window.runs),
+        (unsigned long)(window.pixels / window.runs),
+        (unsigned long)(window.spiBytes / window.runs)
+      );
+      write((const uint8_t*)line, length, context);
+    }
+  }
+}
+
+RenderProfileFrame::RenderProfileFrame(const char* faceId) {
+  currentFace = findFace(faceId);
+  memset(frameTotals, 0, sizeof(frameTotals));
+  frameTotals[RENDER_STAGE_FRAME].cycles = ESP.getCycleCount();
+  frameTotals[RENDER_STAGE_FRAME].calls = callCount;
+  frameTotals[RENDER_STAGE_FRAME].pixels = pixelCount;
+  frameTotals[RENDER_STAGE_FRAME].spiBytes = byteCount;
+}
+
+RenderProfileFrame::~RenderProfileFrame() {
+  StageTotals& frame = frameTotals[RENDER_STAGE_FRAME];
+  frame.ran = true;
+  frame.cycles = ESP.getCycleCount() - frame.cycles;
+  frame.calls = callCount - frame.calls;
+  frame.pixels = pixelCount - frame.pixels;
+  frame.spiBytes = byteCount - frame.spiBytes;
+  lastFrameBytes = frame.spiBytes;
+
+  FaceProfile* face = currentFace;
+  currentFace = NULL;
+  if (face == NULL) {
+    return;
+  }
+  uint32_t cyclesPerUs = getCpuFrequencyMhz();
+  for (int s = 0; s < RENDER_STAGE_COUNT; s++) {
+    const StageTotals& totals = frameTotals[s];
+    if (!totals.ran) {
+      continue;
+    }
+    StageWindow& window = face->stages[s];
+    window.us[window.runs % RENDER_PROFILE_WINDOW] = totals.cycles / cyclesPerUs;
+    window.runs++;
+    window.calls += totals.calls;
+    window.pixels += totals.pixels;
+    window.spiBytes += totals.spiBytes;
+  }
+}
+
+RenderProfileStage::RenderProfileStage(RenderStage stage) {
+  _stage = stage;
+  _outermost = stageDepth++ == 0 && currentFace != NULL;
+  if (!_outermost) {
+    return;
+  }
+  _startCalls = callCount;
+  _startPixels = pixelCount;
+  _startBytes = byteCount;
+  _startCycles = ESP.getCycleCount();
+}
+
+RenderProfileStage::~RenderProfileStage() {
+  uint32_t cycles = ESP.getCycleCount() - _startCycles;
+  stageDepth--;
+  if (!_outermost) {
+    return;
+  }
+  addToFrame(_stage, cycles, callCount - _startCalls, pixelCount - _startPixels, byteCount - _startBytes);
+}
+
+RenderProfileCall::RenderProfileCall() {
+  if (callDepth++ == 0) {
+    callCount++;
+  }
+}
+
+RenderProfileCall::~RenderProfileCall() {
+  callDepth--;
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef RENDER_PROFILE_H
+#define RENDER_PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "text_writer.h"
+
+// Render profiler. Built with -DRENDER_PROFILE=1, every frame drawn by
+// redrawDisplay() is timed with the CPU cycle counter, split into the draw
+// stages below, and the calls, pixels and SPI bytes each stage sends to
+// TFT_display are counted. The times of the last RENDER_PROFILE_WINDOW
+// frames of every face and stage are kept for p50/p95/max, printed by the
+// serial console `profile` command and served at /profile.
+//
+// Without the flag the macros expand to nothing and no state is allocated.
+
+#ifndef RENDER_PROFILE_WINDOW
+  #define RENDER_PROFILE_WINDOW 32
+#endif
+#define RENDER_PROFILE_MAX_FACES 6
+
+// SPI cost model, the same as the host emulator's: every pixel is its own
+// transaction setting the address window (11 bytes) followed by 2 bytes of
+// color; fillScreen() sets the window once.
+#define RENDER_PROFILE_WINDOW_BYTES 11
+
+enum RenderStage {
+  RENDER_STAGE_FRAME,       // the whole face draw, including the stages below
+  RENDER_STAGE_BACKGROUND,  // full repaints of the static parts
+  RENDER_STAGE_HANDS,
+  RENDER_STAGE_ARCS,
+  RENDER_STAGE_TEXT,
+  RENDER_STAGE_ICONS,
+  RENDER_STAGE_OVERLAY,     // face switch grace period overlay
+  RENDER_STAGE_COUNT
+};
+
+const char* renderProfileStageName(RenderStage stage);
+// Drops all samples.
+void renderProfileReset();
+// Writes the report as text, one line per face and stage that ran. Takes
+// the display mutex for each line; call it without holding it.
+void renderProfileWrite(ImageWriteFn write, void* context);
+// Counted by the TFT_display wrappers in display.h.
+void renderProfileCountPixels(uint32_t pixels, uint32_t spiBytes);
+// SPI bytes the last finished frame sent, counted with the cost model below.
+uint32_t renderProfileLastFrameSpiBytes();
+
+// Collects one face draw and adds it to the histograms when it ends. Stages
+// only run inside a frame.
+class RenderProfileFrame {
+public:
+  explicit RenderProfileFrame(const char* faceId);
+  ~RenderProfileFrame();
+};
+
+// Times the stage it is created in. A stage inside another one is part of
+// the outer stage and not counted on its own.
+class RenderProfileStage {
+public:
+  explicit RenderProfileStage(RenderStage stage);
+  ~RenderProfileStage();
+
+private:
+  RenderStage _stage;
+  bool _outermost;
+  uint32_t _startCycles;
+  uint32_t _startCalls;
+  uint32_t _startPixels;
+  uint32_t _startBytes;
+};
+
+// Counts one drawing call unless it runs inside another counted call.
+class RenderProfileCall {
+public:
+  RenderProfileCall();
+  ~RenderProfileCall();
+};
+
+#if RENDER_PROFILE
+  #define RENDER_PROFILE_FRAME(faceId) RenderProfileFrame profileFrame(faceId)
+  // A declaration, not a statement: the stage lasts to the end of the
+  // enclosing scope.
+  #define RENDER_PROFILE_STAGE(stage) RenderProfileStage profileStage(stage)
+  #define RENDER_PROFILE_CALL() RenderProfileCall profileCall
+  #define RENDER_PROFILE_PIXELS(pixels, spiBytes) renderProfileCountPixels(pixels, spiBytes)
+#else
+  #define RENDER_PROFILE_FRAME(faceId)
+  #define RENDER_PROFILE_STAGE(stage)
+  #define RENDER_PROFILE_CALL()
+  #define RENDER_PROFILE_PIXELS(pixels, spiBytes)
+#endif
+
+#endif
@@ -0,0 +1,346 @@
+#include <stddef.h>
+#include "Arduino.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "render_watchdog.h"
+#include "render_profile.h"
+#include "metrics.h"
+#include "clock_source.h"
+#include "timing_constants.h"
+
+static const uint32_t SNAPSHOT_MAGIC = 0x52535432;  // "RST2"
+static const int TASK_NAME_LENGTH = 16;
+
+static const char* CRUMB_NAMES[CRUMB_STAGE] = {
+  "redraw",
+  "reset_question",
+  "setup_instructions",
+  "frame_done",
+};
+
+struct Breadcrumb {
+  uint32_t timeMs;
+  uint32_t crumb;
+};
+
+struct StallSnapshot {
+  uint32_t magic;
+  uint32_t detectedMs;      // uptime when the stall was noticed
+  uint32_t stalledMs;       // since the last finished frame, longest seen
+  uint32_t heldMs;          // how long the holder had the mutex
+  uint32_t holderWaitedMs;  // how long the holder waited before it got it
+  uint32_t waitingMs[RENDER_WATCHDOG_WAITERS];  // how long each waiter has been waiting
+  char holder[TASK_NAME_LENGTH];
+  char waiters[RENDER_WATCHDOG_WAITERS][TASK_NAME_LENGTH];  // longest waiting first
+  char face[TASK_NAME_LENGTH];
+  Breadcrumb crumbs[RENDER_WATCHDOG_CRUMBS];  // oldest first
+  uint32_t checksum;
+};
+
+// Left alone by the startup code, so it outlives a soft reset. After a
+// power cycle it holds noise, which the checksum rejects.
+RTC_NOINIT_ATTR static StallSnapshot savedStall;
+
+static StallSnapshot lastStall;
+static bool haveLastStall = false;
+static bool lastStallBeforeReset = false;
+static int lastResetReason = 0;
+
+// Written by the task drawing, which holds the display mutex.
+static Breadcrumb crumbs[RENDER_WATCHDOG_CRUMBS];
+static uint32_t crumbNext = 0;
+static const char* currentFace = NULL;
+
+static volatile uint32_t lastFrameMs = 0;
+// clockSourceMillis() at the last frame.
+static volatile uint32_t lastFrameClockMs = 0;
+static volatile bool armed = false;
+static bool stalled = false;
+// Since when a frame has been due; only used by the watchdog task.
+static uint32_t frameDueSinceMs = 0;
+
+static TaskHandle_t mutexHolder = NULL;
+static uint32_t mutexHeldSinceMs = 0;
+static uint32_t mutexHolderWaitedMs = 0;
+
+// Every task blocked in takeDisplayMutex(), in the order they started
+// waiting. A task leaves when it gets the mutex; the others stay.
+struct MutexWaiter {
+  TaskHandle_t task;
+  uint32_t sinceMs;
+};
+static MutexWaiter mutexWaiters[RENDER_WATCHDOG_WAITERS];
+static int mutexWaiterCount = 0;
+
+// Taken from every task using the display.
+static portMUX_TYPE watchdogLock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t watchdogTaskHandle = NULL;
+
+static uint32_t snapshotChecksum(const StallSnapshot& snapshot) {
+  // FNV-1a over everything before the checksum.
+  const uint8_t* bytes = (const uint8_t*)&snapshot;
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < offsetof(StallSnapshot, checksum); i++) {
+    hash = (hash ^ bytes[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+static const char* crumbName(uint32_t crumb, char* buffer, size_t size) {
+  if (crumb < CRUMB_STAGE) {
+    return CRUMB_NAMES[crumb];
+  }
+  if (crumb < CRUMB_STAGE + RENDER_STAGE_COUNT) {
+    snprintf(buffer, size, "stage %s", renderProfileStageName((RenderStage)(crumb - CRUMB_STAGE)));
+    return buffer;
+  }
+  return "?";
+}
+
+static void copyTaskName(char* out, TaskHandle_t task) {
+  snprintf(out, TASK_NAME_LENGTH, "%s", task != NULL ? pcTaskGetName(task) : "");
+}
+
+static void writeSnapshot(ImageWriteFn write, void* context, const StallSnapshot& snapshot, bool beforeReset, int resetReason) {
+  char line[REPORT_LINE_LENGTH];
+  int length;
+  if (beforeReset) {
+    length = snprintf(
+      line, sizeof(line), "Render stall before the reset (reset reason %d), at %lu ms uptime\n",
+      resetReason, (unsigned long)snapshot.detectedMs
+    );
+  }
+  else {
+    length = snprintf(line, sizeof(line), "Render stall at %lu ms uptime\n", (unsigned long)snapshot.detectedMs);
+  }
+  writeTextLine(write, context, line, length);
+
+  length = snprintf(
+    line, sizeof(line), "  no frame for %lu ms, face %s\n",
+    (unsigned long)snapshot.stalledMs, snapshot.face[0] != '\0' ? snapshot.face : "-"
+  );
+  writeTextLine(write, context, line, length);
+
+  if (snapshot.holder[0] != '\0') {
+    length = snprintf(
+      line, sizeof(line), "  display mutex held by %s for %lu ms, after waiting %lu ms for it\n",
+      snapshot.holder, (unsigned long)snapshot.heldMs, (unsigned long)snapshot.holderWaitedMs
+    );
+  }
+  else {
+    length = snprintf(line, sizeof(line), "  display mutex free\n");
+  }
+  writeTextLine(write, context, line, length);
+
+  for (int i = 0; i < RENDER_WATCHDOG_WAITERS && snapshot.waiters[i][0] != '\0'; i++) {
+    length = snprintf(
+      line, sizeof(line), "  %s waiting for it for %lu ms\n",
+      snapshot.waiters[i], (unsigned long)snapshot.waitingMs[i]
+    );
+    writeTextLine(write, context, line, length);
+  }
+
+  length = snprintf(line, sizeof(line), "  breadcrumbs, ms before the stall was noticed:\n");
+  writeTextLine(write, context, line, length);
+  char name[32];
+  for (const Breadcrumb& crumb : snapshot.crumbs) {
+    if (crumb.timeMs == 0 && crumb.crumb == 0) {
+      continue;
+    }
+    length = snprintf(
+      line, sizeof(line), "  %8lu %s\n",
+      (unsigned long)(snapshot.detectedMs - crumb.timeMs), crumbName(crumb.crumb, name, sizeof(name))
+    );
+    writeTextLine(write, context, line, length);
+  }
+}
+
+static void writeSerial(const uint8_t* data, size_t length, void* context) {
+  Serial.write(data, length);
+}
+
+void renderWatchdogSetup() {
+  if (savedStall.magic == SNAPSHOT_MAGIC && savedStall.checksum == snapshotChecksum(savedStall)) {
+    lastStall = savedStall;
+    haveLastStall = true;
+    lastStallBeforeReset = true;
+    lastResetReason = (int)esp_reset_reason();
+    metricsSet(METRIC_RENDER_STALL_BEFORE_RESET_MS, savedStall.stalledMs);
+    writeSnapshot(writeSerial, NULL, lastStall, true, lastResetReason);
+  }
+  savedStall.magic = 0;
+}
+
+static void takeSnapshot(StallSnapshot& snapshot, uint32_t nowMs) {
+  memset(&snapshot, 0, sizeof(snapshot));
+  snapshot.magic = SNAPSHOT_MAGIC;
+  snapshot.detectedMs = nowMs;
+  snapshot.stalledMs = nowMs - lastFrameMs;
+  snprintf(snapshot.face, sizeof(snapshot.face), "%s", currentFace != NULL ? currentFace : "");
+
+  // The drawing task is stuck, so the breadcrumbs hold still.
+  for (int i = 0; i < RENDER_WATCHDOG_CRUMBS; i++) {
+    snapshot.crumbs[i] = crumbs[(crumbNext + i) % RENDER_WATCHDOG_CRUMBS];
+  }
+
+  portENTER_CRITICAL(&watchdogLock);
+  TaskHandle_t holder = mutexHolder;
+  MutexWaiter waiters[RENDER_WATCHDOG_WAITERS];
+  int waiterCount = mutexWaiterCount;
+  memcpy(waiters, mutexWaiters, sizeof(waiters));
+  snapshot.heldMs = holder != NULL ? nowMs - mutexHeldSinceMs : 0;
+  snapshot.holderWaitedMs = holder != NULL ? mutexHolderWaitedMs : 0;
+  portEXIT_CRITICAL(&watchdogLock);
+
+  copyTaskName(snapshot.holder, holder);
+  for (int i = 0; i < waiterCount; i++) {
+    copyTaskName(snapshot.waiters[i], waiters[i].task);
+    snapshot.waitingMs[i] = nowMs - waiters[i].sinceMs;
+  }
+  snapshot.checksum = snapshotChecksum(snapshot);
+}
+
+bool renderWatchdogCheck() {
+  if (!armed) {
+    return false;
+  }
+  uint32_t nowMs = millis();
+  // Frames follow the clock source. A fixed clock, as set by the console's
+  // "clock fixed", only needs a frame when it is advanced, so the timeout
+  // runs from when the clock source has moved a blink interval past the
+  // last frame.
+  if (clockSourceMillis() - lastFrameClockMs < BLINK_INTERVAL_MS) {
+    frameDueSinceMs = nowMs;
+  }
+  uint32_t sinceFrameMs = nowMs - lastFrameMs;
+  if (sinceFrameMs < RENDER_STALL_TIMEOUT_MS || nowMs - frameDueSinceMs < RENDER_STALL_TIMEOUT_MS) {
+    if (stalled) {
+      Serial.print("Render stall over, no frame for ");
+      Serial.print(lastStall.stalledMs);
+      Serial.println(" ms.");
+      stalled = false;
+    }
+    return false;
+  }
+
+  // Taken again on every check while the stall lasts, so the saved
+  // snapshot has its full length and the current mutex holder.
+  StallSnapshot snapshot;
+  takeSnapshot(snapshot, nowMs);
+  if (stalled) {
+    snapshot.detectedMs = lastStall.detectedMs;
+    snapshot.checksum = snapshotChecksum(snapshot);
+  }
+  portENTER_CRITICAL(&watchdogLock);
+  lastStall = snapshot;
+  haveLastStall = true;
+  lastStallBeforeReset = false;
+  portEXIT_CRITICAL(&watchdogLock);
+  memcpy(&savedStall, &snapshot, sizeof(snapshot));
+  metricsSet(METRIC_RENDER_STALL_LAST_MS, snapshot.stalledMs);
+
+  if (!stalled) {
+    stalled = true;
+    metricsAdd(METRIC_RENDER_STALLS, 1);
+    writeSnapshot(writeSerial, NULL, snapshot, false, 0);
+  }
+  return true;
+}
+
+static void renderWatchdogTask(void* parameter) {
+  for (;;) {
+    renderWatchdogCheck();
+    vTaskDelay(pdMS_TO_TICKS(RENDER_WATCHDOG_CHECK_MS));
+  }
+}
+
+void renderWatchdogTaskStart() {
+  xTaskCreatePinnedToCore(
+    renderWatchdogTask,
+    "RenderWatchdog",
+    3072,
+    NULL,
+    1,
+    &watchdogTaskHandle,
+    0  // core 0
+  );
+  Serial.println("Render watchdog task started on core 0.");
+}
+
+void renderWatchdogCrumb(uint8_t crumb) {
+  Breadcrumb& entry = crumbs[crumbNext];
+  entry.timeMs = millis();
+  entry.crumb = crumb;
+  crumbNext = (crumbNext + 1) % RENDER_WATCHDOG_CRUMBS;
+}
+
+void renderWatchdogFace(const char* faceId) {
+  currentFace = faceId;
+  renderWatchdogCrumb(CRUMB_STAGE + RENDER_STAGE_FRAME);
+}
+
+void renderWatchdogFrameDone() {
+  renderWatchdogCrumb(CRUMB_FRAME_DONE);
+  lastFrameMs = millis();
+  lastFrameClockMs = clockSourceMillis();
+  armed = true;
+}
+
+uint32_t renderWatchdogMutexWait() {
+  uint32_t nowMs = millis();
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  portENTER_CRITICAL(&watchdogLock);
+  bool known = false;
+  for (int i = 0; i < mutexWaiterCount; i++) {
+    known = known || mutexWaiters[i].task == task;
+  }
+  // More waiters than slots are not recorded; the ones kept waited longest.
+  if (!known && mutexWaiterCount < RENDER_WATCHDOG_WAITERS) {
+    mutexWaiters[mutexWaiterCount].task = task;
+    mutexWaiters[mutexWaiterCount].sinceMs = nowMs;
+    mutexWaiterCount++;
+  }
+  portEXIT_CRITICAL(&watchdogLock);
+  return nowMs;
+}
+
+void renderWatchdogMutexTaken(uint32_t waitStartMs) {
+  uint32_t nowMs = millis();
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  portENTER_CRITICAL(&watchdogLock);
+  mutexHolder = task;
+  mutexHeldSinceMs = nowMs;
+  mutexHolderWaitedMs = nowMs - waitStartMs;
+  for (int i = 0; i < mutexWaiterCount; i++) {
+    if (mutexWaiters[i].task == task) {
+      mutexHolderWaitedMs = nowMs - mutexWaiters[i].sinceMs;
+      memmove(&mutexWaiters[i], &mutexWaiters[i + 1], (mutexWaiterCount - i - 1) * sizeof(MutexWaiter));
+      mutexWaiterCount--;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&watchdogLock);
+}
+
+void renderWatchdogMutexGiven() {
+  portENTER_CRITICAL(&watchdogLock);
+  mutexHolder = NULL;
+  portEXIT_CRITICAL(&watchdogLock);
+}
+
+void renderWatchdogWriteReport(ImageWriteFn write, void* context) {
+  portENTER_CRITICAL(&watchdogLock);
+  StallSnapshot snapshot = lastStall;
+  bool have = haveLastStall;
+  bool beforeReset = lastStallBeforeReset;
+  portEXIT_CRITICAL(&watchdogLock);
+
+  if (!have) {
+    static const char NONE[] = "No render stall recorded.\n";
+    write((const uint8_t*)NONE, sizeof(NONE) - 1, context);
+    return;
+  }
+  writeSnapshot(write, context, snapshot, beforeReset, lastResetReason);
+}
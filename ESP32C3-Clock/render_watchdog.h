@@ -0,0 +1,63 @@
+#ifndef RENDER_WATCHDOG_H
+#define RENDER_WATCHDOG_H
+
+#include <stdint.h>
+#include "text_writer.h"
+
+// Render stall watchdog. redrawDisplay() and the draw stages of the faces
+// leave breadcrumbs, and takeDisplayMutex() / giveDisplayMutex() record
+// which task holds the display mutex and which one waits for it. The
+// RenderWatchdog task checks every RENDER_WATCHDOG_CHECK_MS that a frame
+// was finished within RENDER_STALL_TIMEOUT_MS; when none was, it takes a
+// snapshot of the breadcrumbs and the mutex and logs it. While the clock
+// source is fixed and not advanced no frame is due, and none is expected.
+//
+// The snapshot is kept in RTC memory that a soft reset (restart, panic,
+// watchdog reset) does not clear, and the next boot reports it. A power
+// cycle loses it.
+
+#define RENDER_WATCHDOG_CRUMBS 8
+// Tasks waiting for the display mutex at once that are kept track of.
+#define RENDER_WATCHDOG_WAITERS 4
+
+// Breadcrumbs. The face draw and its stages follow CRUMB_STAGE in
+// RenderStage order.
+enum RenderCrumb {
+  CRUMB_REDRAW,              // redrawDisplay() entered
+  CRUMB_RESET_QUESTION,
+  CRUMB_SETUP_INSTRUCTIONS,
+  CRUMB_FRAME_DONE,
+  CRUMB_STAGE
+};
+
+// Reports the snapshot a stall before the reset left behind, then clears
+// it. Call once at boot, before the display is used.
+void renderWatchdogSetup();
+void renderWatchdogTaskStart();
+// One watchdog check, run by the task. Returns true while the renderer is
+// stalled.
+bool renderWatchdogCheck();
+
+void renderWatchdogCrumb(uint8_t crumb);
+// Leaves the breadcrumb of a draw stage, a RenderStage from
+// render_profile.h. Built in whether or not the profiler is.
+#define RENDER_WATCHDOG_STAGE(stage) \
+  do { \
+    renderWatchdogCrumb(CRUMB_STAGE + (stage)); \
+  } while (0)
+// The face about to be drawn; also leaves the RENDER_STAGE_FRAME crumb.
+void renderWatchdogFace(const char* faceId);
+// Arms the watchdog at the first call.
+void renderWatchdogFrameDone();
+
+// Called by takeDisplayMutex() and giveDisplayMutex(). MutexWait returns
+// the time the wait started, for MutexTaken.
+uint32_t renderWatchdogMutexWait();
+void renderWatchdogMutexTaken(uint32_t waitStartMs);
+void renderWatchdogMutexGiven();
+
+// Writes the snapshot of this boot's last stall, or of the stall before
+// the reset, as text.
+void renderWatchdogWriteReport(ImageWriteFn write, void* context);
+
+#endif
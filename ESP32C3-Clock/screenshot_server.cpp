@@ -1,21 +1,100 @@
-#if SCREENSHOT_MODE
-
 #include <WiFi.h>
-#include <time.h>
 #include <WebServer.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "screenshot_server.h"
 #include "display.h"
 #include "display_constants.h"
-#include "app_state.h"
+#include "timing_constants.h"
+#include "config.h"
+#include "image_encoder.h"
+#include "metrics.h"
+#include "task_trace.h"
+#include "input_latency.h"
+#include "energy.h"
+#include "boot_profile.h"
 
 static WebServer server(80);
+static TaskHandle_t serverTaskHandle = NULL;
 
-static const int STRIP_COUNT = SCREEN_HEIGHT / CAPTURE_STRIP_HEIGHT;
 static const uint32_t IMAGE_SIZE = (uint32_t)SCREEN_WIDTH * SCREEN_HEIGHT * 3;
 static const uint32_t FILE_SIZE = 54 + IMAGE_SIZE;
 
-static uint16_t stripBuffer[SCREEN_WIDTH * CAPTURE_STRIP_HEIGHT];
+alignas(4) static uint16_t stripBuffer[SCREEN_WIDTH * SHADOW_STRIP_HEIGHT];
 static uint8_t rowBuf[SCREEN_WIDTH * 3];
+static uint32_t tileGenerations[SHADOW_TILES_PER_ROW];
+static PngEncoder pngEncoder;
+static QoiEncoder qoiEncoder;
+static MirrorEncoder mirrorEncoder;
+
+// Viewer for /live. Polls with the last seen sequence number plus one, so
+// only changes are sent, and starts over from a full screen when a
+// response does not parse.
+static const char MIRROR_PAGE[] = R"HTML(<!DOCTYPE html>
+<html><head><title>Clock mirror</title>
+<style>body{background:#222;color:#ccc;font:14px sans-serif;text-align:center}canvas{image-rendering:pixelated;width:480px;height:480px;border-radius:50%}</style>
+</head><body><canvas id="c" width="240" height="240"></canvas><p id="s">connecting</p>
+<script>
+const ctx = document.getElementById('c').getContext('2d');
+const img = ctx.createImageData(240, 240);
+const status = document.getElementById('s');
+let since = 0, frames = 0, bytes = 0;
+function parse(buf) {
+  if (buf.length == 0) return;
+  if (buf.length < 6 || buf[0] != 70) throw new Error('bad frame');
+  const seq = buf[1] | buf[2] << 8 | buf[3] << 16 | buf[4] << 24;
+  let q = 5;
+  const rects = [];
+  for (;;) {
+    if (q >= buf.length) throw new Error('bad frame');
+    if (buf[q] == 69) break;
+    if (buf[q] != 82 || q + 5 > buf.length) throw new Error('bad frame');
+    const x = buf[q + 1], y = buf[q + 2], w = buf[q + 3], h = buf[q + 4];
+    let r = q + 5, n = 0;
+    while (n < w * h && r + 3 <= buf.length) { n += buf[r] + 1; r += 3; }
+    if (n != w * h) throw new Error('bad frame');
+    rects.push([x, y, w, q + 5, r]);
+    q = r;
+  }
+  for (const [x, y, w, start, end] of rects) {
+    let i = 0;
+    for (let r = start; r < end; r += 3) {
+      const c = buf[r + 1] | buf[r + 2] << 8;
+      const R = (c >> 11) * 255 / 31, G = (c >> 5 & 63) * 255 / 63, B = (c & 31) * 255 / 31;
+      for (let k = 0; k <= buf[r]; k++, i++) {
+        const o = ((y + Math.floor(i / w)) * 240 + x + i % w) * 4;
+        img.data[o] = R; img.data[o + 1] = G; img.data[o + 2] = B; img.data[o + 3] = 255;
+      }
+    }
+  }
+  ctx.putImageData(img, 0, 0);
+  since = (seq >>> 0) + 1;
+  frames++;
+}
+async function run() {
+  for (;;) {
+    let wait = 100;
+    try {
+      const res = await fetch('/live?since=' + since);
+      if (!res.ok) throw new Error(res.status);
+      const buf = new Uint8Array(await res.arrayBuffer());
+      bytes += buf.length;
+      try {
+        parse(buf);
+      } catch (e) {
+        since = 0;
+      }
+      status.textContent = frames + ' frames, ' + bytes + ' bytes';
+    } catch (e) {
+      status.textContent = 'reconnecting';
+      wait = 1000;
+    }
+    await new Promise(r => setTimeout(r, wait));
+  }
+}
+run();
+</script></body></html>
+)HTML";
 
 static void writeLe16(uint8_t* buf, uint16_t val) {
   buf[0] = val & 0xFF;
@@ -29,7 +108,11 @@ static void writeLe32(uint8_t* buf, uint32_t val) {
   buf[3] = (val >> 24) & 0xFF;
 }
 
-static void handleScreenshot() {
+static void sendChunk(const uint8_t* data, size_t length, void* context) {
+  server.sendContent((const char*)data, length);
+}
+
+static void sendBmp() {
   uint8_t header[54];
   memset(header, 0, sizeof(header));
 
@@ -48,35 +131,213 @@ static void handleScreenshot() {
   server.send(200, "image/bmp", "");
   server.sendContent((const char*)header, 54);
 
-  for (int strip = 0; strip < STRIP_COUNT; strip++) {
-    takeDisplayMutex();
-    screenshotCaptureStrip(strip * CAPTURE_STRIP_HEIGHT, stripBuffer);
-    giveDisplayMutex();
-
-    for (int row = 0; row < CAPTURE_STRIP_HEIGHT; row++) {
-      for (int col = 0; col < SCREEN_WIDTH; col++) {
-        uint16_t pixel = stripBuffer[row * SCREEN_WIDTH + col];
-        rowBuf[col * 3 + 0] = (pixel << 3) & 0xF8;
-        rowBuf[col * 3 + 1] = (pixel >> 3) & 0xFC;
-        rowBuf[col * 3 + 2] = (pixel >> 8) & 0xF8;
-      }
+  // Each strip is copied under the display mutex, so the render loop is only
+  // held up for a memcpy while the transfer itself runs unlocked.
+  for (int strip = 0; strip < SHADOW_STRIP_COUNT; strip++) {
+    displayCopyShadowStrip(strip, stripBuffer);
+    for (int row = 0; row < SHADOW_STRIP_HEIGHT; row++) {
+      rgb565ToBgr888(stripBuffer + row * SCREEN_WIDTH, rowBuf, SCREEN_WIDTH);
       server.sendContent((const char*)rowBuf, sizeof(rowBuf));
     }
   }
+}
+
+// The encoded size is not known up front, so PNG and QOI go out with
+// chunked transfer encoding.
+static void sendPng() {
+  server.sendHeader("Content-Disposition", "inline; filename=screenshot.png");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "image/png", "");
 
-  Serial.println("Screenshot served.");
+  pngEncoderBegin(pngEncoder, SCREEN_WIDTH, SCREEN_HEIGHT, sendChunk, NULL);
+  for (int strip = 0; strip < SHADOW_STRIP_COUNT; strip++) {
+    displayCopyShadowStrip(strip, stripBuffer);
+    pngEncoderAddRows(pngEncoder, stripBuffer, SHADOW_STRIP_HEIGHT);
+  }
+  pngEncoderEnd(pngEncoder);
+  server.sendContent("");
 }
 
-void screenshotServerSetup() {
-  server.on("/screenshot", HTTP_GET, handleScreenshot);
-  server.begin();
-  Serial.print("Screenshot server ready: http://");
-  Serial.print(WiFi.localIP());
-  Serial.println("/screenshot");
+static void sendQoi() {
+  server.sendHeader("Content-Disposition", "attachment; filename=screenshot.qoi");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "image/qoi", "");
+
+  qoiEncoderBegin(qoiEncoder, SCREEN_WIDTH, SCREEN_HEIGHT, sendChunk, NULL);
+  for (int strip = 0; strip < SHADOW_STRIP_COUNT; strip++) {
+    displayCopyShadowStrip(strip, stripBuffer);
+    qoiEncoderAddRows(qoiEncoder, stripBuffer, SHADOW_STRIP_HEIGHT);
+  }
+  qoiEncoderEnd(qoiEncoder);
+  server.sendContent("");
+}
+
+static void handleScreenshot() {
+  if (!TFT_display.hasShadow()) {
+    server.send(503, "text/plain", "Shadow framebuffer not available");
+    return;
+  }
+
+  String format = server.hasArg("format") ? server.arg("format") : String("png");
+  unsigned long startMs = millis();
+  if (format == "png") {
+    sendPng();
+  }
+  else if (format == "qoi") {
+    sendQoi();
+  }
+  else if (format == "bmp") {
+    sendBmp();
+  }
+  else {
+    server.send(400, "text/plain", "Unknown format, use png, qoi or bmp");
+    return;
+  }
+
+  Serial.print("Screenshot (");
+  Serial.print(format);
+  Serial.print(") served in ");
+  Serial.print(millis() - startMs);
+  Serial.println("ms.");
 }
 
-void screenshotServerLoop() {
-  server.handleClient();
+// Answers with one frame of the tiles that changed since the given
+// sequence number, or an empty body when none did; the viewer polls. A
+// client starting with since=0 gets the whole screen. Every request takes a
+// new shadow generation, so a tile drawn while the strips are being copied
+// is sent again on the next request. Only strips with changed tiles are
+// copied, so an unchanged screen costs one display mutex take.
+static void handleLive() {
+  if (!TFT_display.hasShadow()) {
+    server.send(503, "text/plain", "Shadow framebuffer not available");
+    return;
+  }
+
+  uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), NULL, 10) : 0;
+  bool changedStrips[SHADOW_STRIP_COUNT];
+  uint32_t seq = displayNextShadowGeneration(since, changedStrips);
+
+  server.sendHeader("Cache-Control", "no-store");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/octet-stream", "");
+
+  mirrorEncoderBegin(mirrorEncoder, sendChunk, NULL);
+  mirrorEncoderBeginFrame(mirrorEncoder, seq);
+  for (int strip = 0; strip < SHADOW_STRIP_COUNT; strip++) {
+    if (!changedStrips[strip]) {
+      continue;
+    }
+    displayCopyShadowStrip(strip, stripBuffer, tileGenerations);
+    mirrorEncoderAddStrip(
+      mirrorEncoder,
+      stripBuffer,
+      SCREEN_WIDTH,
+      strip * SHADOW_STRIP_HEIGHT,
+      SHADOW_STRIP_HEIGHT,
+      tileGenerations,
+      SHADOW_TILE_SIZE,
+      since
+    );
+  }
+  mirrorEncoderEndFrame(mirrorEncoder);
+  server.sendContent("");
 }
 
+#if DISPLAY_TRACE
+  static void handleTrace() {
+    server.sendHeader("Content-Disposition", "attachment; filename=display.trace");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/octet-stream", "");
+    displayTraceWrite(sendChunk, NULL);
+    server.sendContent("");
+  }
+#endif
+
+#if RENDER_PROFILE
+  static void handleProfile() {
+    if (server.hasArg("reset")) {
+      renderProfileReset();
+    }
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/plain", "");
+    renderProfileWrite(sendChunk, NULL);
+    server.sendContent("");
+  }
+#endif
+
+#if TASK_TRACE
+  static void handleTasks() {
+    server.sendHeader("Content-Disposition", "attachment; filename=tasks.json");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    taskTraceWrite(sendChunk, NULL);
+    server.sendContent("");
+  }
 #endif
+
+// Streams the metrics line by line, so the response needs no buffer of its
+// own.
+static void handleMetrics() {
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/plain; version=0.0.4", "");
+  metricsWriteText(sendChunk, NULL);
+  inputLatencyWriteText(sendChunk, NULL);
+  energyWriteText(sendChunk, NULL);
+  bootProfileWriteText(sendChunk, NULL);
+  server.sendContent("");
+}
+
+static void handleMirror() {
+  server.send(200, "text/html", MIRROR_PAGE);
+}
+
+static void serverTask(void* parameter) {
+  bool running = false;
+
+  for (;;) {
+    bool wanted = WiFi.status() == WL_CONNECTED && !isConfigPortalActive();
+    if (wanted && !running) {
+      server.begin();
+      running = true;
+      Serial.print("Screenshot server ready: http://");
+      Serial.print(WiFi.localIP());
+      Serial.println("/screenshot");
+    }
+    else if (!wanted && running) {
+      server.stop();
+      running = false;
+      Serial.println("Screenshot server stopped.");
+    }
+
+    if (running) {
+      server.handleClient();
+    }
+    vTaskDelay(pdMS_TO_TICKS(running ? WEB_SERVER_POLL_MS : WEB_SERVER_IDLE_POLL_MS));
+  }
+}
+
+void screenshotServerTaskStart() {
+  server.on("/screenshot", HTTP_GET, handleScreenshot);
+  server.on("/live", HTTP_GET, handleLive);
+  server.on("/mirror", HTTP_GET, handleMirror);
+  server.on("/metrics", HTTP_GET, handleMetrics);
+  #if DISPLAY_TRACE
+    server.on("/trace", HTTP_GET, handleTrace);
+  #endif
+  #if RENDER_PROFILE
+    server.on("/profile", HTTP_GET, handleProfile);
+  #endif
+  #if TASK_TRACE
+    server.on("/tasks", HTTP_GET, handleTasks);
+  #endif
+  xTaskCreatePinnedToCore(
+    serverTask,
+    "WebServer",
+    4096,
+    NULL,
+    1,
+    &serverTaskHandle,
+    0  // core 0
+  );
+  Serial.println("Screenshot server task started on core 0.");
+}
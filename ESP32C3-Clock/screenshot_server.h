@@ -1,11 +1,8 @@
 #ifndef SCREENSHOT_SERVER_H
 #define SCREENSHOT_SERVER_H
 
-#if SCREENSHOT_MODE
-
-void screenshotServerSetup();
-void screenshotServerLoop();
-
-#endif
+// Serves the shadow framebuffer as http://<device-ip>/screenshot whenever
+// WiFi is connected and the configuration portal is not using port 80.
+void screenshotServerTaskStart();
 
 #endif
@@ -0,0 +1,304 @@
+#include "Arduino.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "serial_console.h"
+#include "display.h"
+#include "display_constants.h"
+#include "image_encoder.h"
+#include "clock_source.h"
+#include "system_monitor.h"
+#include "task_trace.h"
+#include "log_ring.h"
+#include "input_latency.h"
+#include "render_watchdog.h"
+#include "energy.h"
+#include "boot_profile.h"
+#include "timing_constants.h"
+
+static TaskHandle_t consoleTaskHandle = NULL;
+
+static const int LINE_LENGTH = 64;
+static const int MAX_ARGS = 4;
+
+alignas(4) static uint16_t stripBuffer[SCREEN_WIDTH * SHADOW_STRIP_HEIGHT];
+static SerialDumpEncoder dumpEncoder;
+static uint32_t dumpSeq = 0;
+
+struct ConsoleCommand {
+  const char* name;
+  const char* usage;
+  void (*handler)(int argc, char** argv);
+};
+
+static void writeSerial(const uint8_t* data, size_t length, void* context) {
+  Serial.write(data, length);
+}
+
+// The host switches its port to the new rate after reading the OK line, so
+// the dump waits a moment before sending at that rate.
+static void switchBaud(unsigned long baud) {
+  Serial.flush();
+  Serial.updateBaudRate(baud);
+  vTaskDelay(pdMS_TO_TICKS(SERIAL_BAUD_SWITCH_DELAY_MS));
+}
+
+static void dumpStrips(int firstStrip, int stripCount, unsigned long baud) {
+  if (!TFT_display.hasShadow()) {
+    Serial.println("ERR no shadow framebuffer");
+    return;
+  }
+
+  Serial.print("OK ");
+  Serial.println(baud);
+  switchBaud(baud);
+
+  unsigned long startMs = millis();
+  serialDumpBegin(dumpEncoder, SCREEN_WIDTH, SCREEN_HEIGHT, ++dumpSeq, writeSerial, NULL);
+  for (int strip = firstStrip; strip < firstStrip + stripCount; strip++) {
+    displayCopyShadowStrip(strip, stripBuffer);
+    serialDumpAddRows(dumpEncoder, stripBuffer, strip * SHADOW_STRIP_HEIGHT, SHADOW_STRIP_HEIGHT);
+  }
+  serialDumpEnd(dumpEncoder);
+  unsigned long elapsedMs = millis() - startMs;
+
+  switchBaud(SERIAL_BAUD);
+  Serial.print("Screenshot dump sent in ");
+  Serial.print(elapsedMs);
+  Serial.println("ms.");
+}
+
+// The rates host/serial_screenshot can switch to. Any other value would
+// leave the port at a rate the host can not follow until the dump ends.
+static const unsigned long DUMP_BAUD_RATES[] = { 115200, 230400, 460800, 921600, 1000000, 2000000 };
+
+// Returns 0 and prints an error when the rate is not supported.
+static unsigned long baudArg(int argc, char** argv, int index) {
+  if (argc <= index) {
+    return SERIAL_DUMP_BAUD;
+  }
+  char* end;
+  unsigned long baud = strtoul(argv[index], &end, 10);
+  if (*end == '\0') {
+    for (unsigned int i = 0; i < sizeof(DUMP_BAUD_RATES) / sizeof(DUMP_BAUD_RATES[0]); i++) {
+      if (baud == DUMP_BAUD_RATES[i]) {
+        return baud;
+      }
+    }
+  }
+  Serial.println("ERR bad baud");
+  return 0;
+}
+
+static void commandScreenshot(int argc, char** argv) {
+  unsigned long baud = baudArg(argc, argv, 1);
+  if (baud == 0) {
+    return;
+  }
+  dumpStrips(0, SHADOW_STRIP_COUNT, baud);
+}
+
+static void commandStrip(int argc, char** argv) {
+  int strip = argc > 1 ? atoi(argv[1]) : -1;
+  if (strip < 0 || strip >= SHADOW_STRIP_COUNT) {
+    Serial.println("ERR strip out of range");
+    return;
+  }
+  unsigned long baud = baudArg(argc, argv, 2);
+  if (baud == 0) {
+    return;
+  }
+  dumpStrips(strip, 1, baud);
+}
+
+static void printClock() {
+  static const char* MODE_NAMES[] = { "real", "fixed", "accelerated" };
+  Serial.print("Clock ");
+  Serial.print(MODE_NAMES[clockSourceMode()]);
+  if (clockSourceMode() == CLOCK_ACCELERATED) {
+    Serial.print(" x");
+    Serial.print(clockSourceFactor());
+  }
+  int64_t wallUs = clockSourceWallUs();
+  if (wallUs >= 0) {
+    time_t seconds = (time_t)(wallUs / 1000000LL);
+    struct tm timeinfo;
+    localtime_r(&seconds, &timeinfo);
+    char buf[32];
+    strftime(buf, sizeof(buf), " %Y-%m-%d %H:%M:%S", &timeinfo);
+    Serial.print(buf);
+  }
+  Serial.print(" millis ");
+  Serial.println(clockSourceMillis());
+}
+
+// Simulated wall times start at the given epoch, or at the current time.
+static bool startWallUs(int argc, char** argv, int index, int64_t& wallUs) {
+  wallUs = argc > index ? strtoll(argv[index], NULL, 10) * 1000000LL : clockSourceWallUs();
+  if (wallUs < 0) {
+    Serial.println("ERR time not known, give an epoch");
+    return false;
+  }
+  return true;
+}
+
+static void commandClock(int argc, char** argv) {
+  const char* mode = argc > 1 ? argv[1] : "";
+  int64_t wallUs;
+  if (argc == 1) {
+    // Just print the state below.
+  }
+  else if (strcmp(mode, "real") == 0) {
+    clockSourceSetReal();
+  }
+  else if (strcmp(mode, "fixed") == 0) {
+    if (!startWallUs(argc, argv, 2, wallUs)) {
+      return;
+    }
+    clockSourceSetFixed(wallUs);
+  }
+  else if (strcmp(mode, "fast") == 0 && argc > 2) {
+    if (!startWallUs(argc, argv, 3, wallUs)) {
+      return;
+    }
+    clockSourceSetAccelerated(strtoul(argv[2], NULL, 10), wallUs);
+  }
+  else if (strcmp(mode, "advance") == 0 && argc > 2) {
+    clockSourceAdvanceMs(strtoul(argv[2], NULL, 10));
+  }
+  else {
+    Serial.println("ERR unknown clock mode");
+    return;
+  }
+  printClock();
+}
+
+#if RENDER_PROFILE
+  static void commandProfile(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+      renderProfileReset();
+      Serial.println("Render profile reset.");
+      return;
+    }
+    renderProfileWrite(writeSerial, NULL);
+  }
+#endif
+
+#if TASK_TRACE
+  static void commandTasks(int argc, char** argv) {
+    taskTraceWrite(writeSerial, NULL);
+  }
+#endif
+
+static void commandLog(int argc, char** argv) {
+  if (argc > 1) {
+    LogLevel level;
+    if (!logLevelFromName(argv[1], &level)) {
+      Serial.println("ERR unknown log level");
+      return;
+    }
+    logRingSetLevel(level);
+  }
+  Serial.print("Log level: ");
+  Serial.println(logLevelName(logRingGetLevel()));
+}
+
+static void commandLatency(int argc, char** argv) {
+  inputLatencyWriteReport(writeSerial, NULL);
+}
+
+static void commandStall(int argc, char** argv) {
+  renderWatchdogWriteReport(writeSerial, NULL);
+}
+
+static void commandEnergy(int argc, char** argv) {
+  energyWriteReport(writeSerial, NULL);
+}
+
+static void commandBoot(int argc, char** argv) {
+  bootProfileWriteReport(writeSerial, NULL);
+}
+
+static void commandHeap(int argc, char** argv) {
+  systemMonitorPrint();
+}
+
+static void commandHelp(int argc, char** argv);
+
+static const ConsoleCommand COMMANDS[] = {
+  { "help",       "help",                    commandHelp },
+  { "clock",      "clock [real | fixed [epoch] | fast <factor> [epoch] | advance <ms>]", commandClock },
+  { "screenshot", "screenshot [baud]",       commandScreenshot },
+  { "strip",      "strip <index> [baud]",    commandStrip },
+  { "heap",       "heap",                    commandHeap },
+  { "log",        "log [error | warn | info | debug]", commandLog },
+  { "latency",    "latency",                 commandLatency },
+  { "stall",      "stall",                   commandStall },
+  { "energy",     "energy",                  commandEnergy },
+  { "boot",       "boot",                    commandBoot },
+  #if RENDER_PROFILE
+    { "profile",    "profile [reset]",         commandProfile },
+  #endif
+  #if TASK_TRACE
+    { "tasks",      "tasks",                   commandTasks },
+  #endif
+};
+
+static void commandHelp(int argc, char** argv) {
+  for (const ConsoleCommand& command : COMMANDS) {
+    Serial.println(command.usage);
+  }
+}
+
+static void runLine(char* line) {
+  char* argv[MAX_ARGS];
+  int argc = 0;
+  char* save = NULL;
+  for (char* token = strtok_r(line, " \t\r", &save); token != NULL && argc < MAX_ARGS; token = strtok_r(NULL, " \t\r", &save)) {
+    argv[argc++] = token;
+  }
+  if (argc == 0) {
+    return;
+  }
+
+  for (const ConsoleCommand& command : COMMANDS) {
+    if (strcmp(argv[0], command.name) == 0) {
+      command.handler(argc, argv);
+      return;
+    }
+  }
+  Serial.print("ERR unknown command: ");
+  Serial.println(argv[0]);
+}
+
+static void consoleTask(void* parameter) {
+  char line[LINE_LENGTH];
+  int length = 0;
+
+  for (;;) {
+    while (Serial.available() > 0) {
+      int c = Serial.read();
+      if (c == '\n') {
+        line[length] = '\0';
+        runLine(line);
+        length = 0;
+      }
+      else if (length < LINE_LENGTH - 1) {
+        line[length++] = (char)c;
+      }
+    }
+    vTaskDelay(pdMS_TO_TICKS(SERIAL_CONSOLE_POLL_MS));
+  }
+}
+
+void serialConsoleTaskStart() {
+  xTaskCreatePinnedToCore(
+    consoleTask,
+    "SerialConsole",
+    4096,
+    NULL,
+    1,
+    &consoleTaskHandle,
+    0  // core 0
+  );
+  Serial.println("Serial console task started on core 0.");
+}
@@ -0,0 +1,14 @@
+#ifndef SERIAL_CONSOLE_H
+#define SERIAL_CONSOLE_H
+
+// Baud rate of the Serial log and the rate screenshots are sent at unless
+// the command asks for another one.
+#define SERIAL_BAUD 115200
+#define SERIAL_DUMP_BAUD 921600
+
+// Reads text commands from Serial, one per line. "help" lists them. The
+// screenshot commands answer with the binary packets of SerialDumpEncoder
+// in image_encoder.h, so they work without WiFi.
+void serialConsoleTaskStart();
+
+#endif
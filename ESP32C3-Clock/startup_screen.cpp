@@ -8,6 +8,8 @@
 #include "app_state.h"
 #include "timing_constants.h"
 #include "icons.h"
+#include "system_monitor.h"
+#include "task_trace.h"
 
 static TaskHandle_t startupScreenTaskHandle = NULL;
 
@@ -83,9 +85,11 @@ static void startupScreenTask(void* parameter) {
     }
 
     takeDisplayMutex();
+    TASK_TRACE_BEGIN("startup_frame");
     drawSpinner(spinnerStep);
     drawIcon(showWifi && (!blinkWifi || blinkState), STARTUP_ICON_WIFI_X, STARTUP_ICON_WIFI_Y, IconWifiBitmap);
     drawIcon(showNtp && (!blinkNtp || blinkState), STARTUP_ICON_NTP_X, STARTUP_ICON_NTP_Y, IconSyncBitmap);
+    TASK_TRACE_END("startup_frame");
     giveDisplayMutex();
 
     spinnerStep = (spinnerStep + 1) % SPINNER_STEPS;
@@ -102,6 +106,7 @@ static void startupScreenTask(void* parameter) {
     Serial.println("app state changed to: ");
     Serial.println(getAppState());
   }
+  systemMonitorRecordStack();
   vTaskDelete(NULL);
 }
 
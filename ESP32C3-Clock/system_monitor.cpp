@@ -0,0 +1,147 @@
+#include "Arduino.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "system_monitor.h"
+#include "metrics.h"
+#include "timing_constants.h"
+#include "telemetry.h"
+#include "energy.h"
+
+static TaskHandle_t monitorTaskHandle = NULL;
+
+// A new heap low is logged once it is this much below the last one logged.
+static const uint32_t HEAP_LOW_LOG_STEP = 1024;
+
+struct MonitoredTask {
+  const char* name;
+  MetricId metric;
+};
+
+static const MonitoredTask TASKS[] = {
+  { "loopTask",      METRIC_STACK_FREE_LOOP },
+  { "StartupScreen", METRIC_STACK_FREE_STARTUP_SCREEN },
+  { "NtpTask",       METRIC_STACK_FREE_NTP },
+  { "WifiMonitor",   METRIC_STACK_FREE_WIFI_MONITOR },
+  { "ConfigPortal",  METRIC_STACK_FREE_CONFIG_PORTAL },
+  { "WebServer",     METRIC_STACK_FREE_WEB_SERVER },
+  { "SerialConsole", METRIC_STACK_FREE_SERIAL_CONSOLE },
+  { "SystemMonitor", METRIC_STACK_FREE_SYSTEM_MONITOR },
+  { "LogDrain",      METRIC_STACK_FREE_LOG_DRAIN },
+  { "RenderWatchdog", METRIC_STACK_FREE_RENDER_WATCHDOG },
+};
+
+// The failed allocation callback runs on the allocating task, possibly with
+// the heap locked, so it only records and the monitor task does the logging.
+static volatile const char* failedFunction = NULL;
+static volatile uint32_t failedCaps = 0;
+static uint32_t loggedFailures = 0;
+static uint32_t loggedMinFree = UINT32_MAX;
+
+static void onAllocFailed(size_t size, uint32_t caps, const char* functionName) {
+  failedFunction = functionName;
+  failedCaps = caps;
+  metricsSet(METRIC_HEAP_ALLOC_FAILED_LAST_BYTES, size);
+  metricsAdd(METRIC_HEAP_ALLOC_FAILURES, 1);
+}
+
+// On ESP-IDF the high-water mark is in bytes.
+static void recordTaskStack(TaskHandle_t handle, const char* name) {
+  for (const MonitoredTask& task : TASKS) {
+    if (strcmp(task.name, name) == 0) {
+      metricsSet(task.metric, uxTaskGetStackHighWaterMark(handle));
+      return;
+    }
+  }
+}
+
+void systemMonitorRecordStack() {
+  recordTaskStack(NULL, pcTaskGetName(NULL));
+}
+
+// Tasks that are not running keep the figure they had last.
+static void sample() {
+  uint32_t freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  uint32_t largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  metricsSet(METRIC_HEAP_FREE_BYTES, freeBytes);
+  metricsSet(METRIC_HEAP_MIN_FREE_BYTES, heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+  metricsSet(METRIC_HEAP_LARGEST_BLOCK_BYTES, largestBlock);
+  metricsSet(METRIC_HEAP_FRAGMENTATION_PERCENT, freeBytes > 0 ? 100 - (uint32_t)((uint64_t)largestBlock * 100 / freeBytes) : 0);
+
+  for (const MonitoredTask& task : TASKS) {
+    TaskHandle_t handle = xTaskGetHandle(task.name);
+    if (handle != NULL) {
+      metricsSet(task.metric, uxTaskGetStackHighWaterMark(handle));
+    }
+  }
+}
+
+static void logChanges() {
+  uint32_t failures = metricsGet(METRIC_HEAP_ALLOC_FAILURES);
+  if (failures != loggedFailures) {
+    Serial.print("Heap allocation failed ");
+    Serial.print(failures - loggedFailures);
+    Serial.print("x, last: ");
+    Serial.print(metricsGet(METRIC_HEAP_ALLOC_FAILED_LAST_BYTES));
+    Serial.print(" bytes, caps 0x");
+    Serial.print(failedCaps, HEX);
+    Serial.print(" in ");
+    Serial.println(failedFunction != NULL ? (const char*)failedFunction : "?");
+    telemetryEvent("heap_alloc_failed", metricsGet(METRIC_HEAP_ALLOC_FAILED_LAST_BYTES));
+    loggedFailures = failures;
+  }
+
+  uint32_t minFree = metricsGet(METRIC_HEAP_MIN_FREE_BYTES);
+  if (minFree + HEAP_LOW_LOG_STEP <= loggedMinFree) {
+    Serial.print("New heap low: ");
+    Serial.print(minFree);
+    Serial.print(" bytes free, largest block ");
+    Serial.print(metricsGet(METRIC_HEAP_LARGEST_BLOCK_BYTES));
+    Serial.println(" bytes.");
+    loggedMinFree = minFree;
+  }
+}
+
+void systemMonitorPrint() {
+  sample();
+  Serial.print("Heap free ");
+  Serial.print(metricsGet(METRIC_HEAP_FREE_BYTES));
+  Serial.print(", min ");
+  Serial.print(metricsGet(METRIC_HEAP_MIN_FREE_BYTES));
+  Serial.print(", largest block ");
+  Serial.print(metricsGet(METRIC_HEAP_LARGEST_BLOCK_BYTES));
+  Serial.print(", fragmentation ");
+  Serial.print(metricsGet(METRIC_HEAP_FRAGMENTATION_PERCENT));
+  Serial.print("%, failed allocations ");
+  Serial.println(metricsGet(METRIC_HEAP_ALLOC_FAILURES));
+
+  for (const MonitoredTask& task : TASKS) {
+    Serial.print("Stack free min ");
+    Serial.print(task.name);
+    Serial.print(": ");
+    Serial.println(metricsGet(task.metric));
+  }
+}
+
+static void systemMonitorTask(void* parameter) {
+  for (;;) {
+    sample();
+    energySample();
+    logChanges();
+    vTaskDelay(pdMS_TO_TICKS(SYSTEM_MONITOR_INTERVAL_MS));
+  }
+}
+
+void systemMonitorTaskStart() {
+  heap_caps_register_failed_alloc_callback(onAllocFailed);
+  xTaskCreatePinnedToCore(
+    systemMonitorTask,
+    "SystemMonitor",
+    3072,
+    NULL,
+    1,
+    &monitorTaskHandle,
+    0  // core 0
+  );
+  Serial.println("System monitor task started on core 0.");
+}
@@ -0,0 +1,14 @@
+#ifndef SYSTEM_MONITOR_H
+#define SYSTEM_MONITOR_H
+
+// Samples the heap and the stack high-water marks of the firmware's tasks
+// every SYSTEM_MONITOR_INTERVAL_MS into the metrics in metrics.h. Failed
+// heap allocations and new heap lows are logged to Serial.
+void systemMonitorTaskStart();
+// Records the stack high-water mark of the calling task. Tasks that delete
+// themselves call this first, so their figure outlives them.
+void systemMonitorRecordStack();
+// Samples now and prints the figures.
+void systemMonitorPrint();
+
+#endif
@@ -0,0 +1,194 @@
+#include "Arduino.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "task_trace.h"
+
+#if TASK_TRACE
+
+static const int TASK_NAME_LENGTH = 16;
+static const int ELEMENT_LENGTH = 160;
+
+struct TaskTraceEvent {
+  int64_t timeUs;
+  const char* name;
+  int32_t value;
+  char phase;  // 'B', 'E' or 'i' as in the Trace Event format
+  uint8_t task;
+};
+
+struct TaskTraceTask {
+  char name[TASK_NAME_LENGTH];
+  uint8_t core;
+};
+
+static TaskTraceEvent* ring = NULL;
+static uint32_t ringNext = 0;
+static uint32_t ringCount = 0;
+static bool paused = false;
+static TaskTraceTask tasks[TASK_TRACE_MAX_TASKS];
+static int taskCount = 0;
+
+// Unlike the display trace, events come from every task on both cores. The
+// lock is only held to find the task and copy the event.
+static portMUX_TYPE traceLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Called with the lock held. Returns -1 when the table is full.
+static int findTask(const char* name) {
+  for (int i = 0; i < taskCount; i++) {
+    if (strncmp(tasks[i].name, name, TASK_NAME_LENGTH) == 0) {
+      return i;
+    }
+  }
+  if (taskCount == TASK_TRACE_MAX_TASKS) {
+    return -1;
+  }
+  TaskTraceTask& task = tasks[taskCount];
+  strncpy(task.name, name, TASK_NAME_LENGTH - 1);
+  task.name[TASK_NAME_LENGTH - 1] = '\0';
+  task.core = (uint8_t)xPortGetCoreID();
+  return taskCount++;
+}
+
+static void append(char phase, const char* name, int32_t value) {
+  if (ring == NULL) {
+    return;
+  }
+  int64_t timeUs = esp_timer_get_time();
+  const char* taskName = pcTaskGetName(NULL);
+
+  portENTER_CRITICAL(&traceLock);
+  int task = paused ? -1 : findTask(taskName);
+  if (task >= 0) {
+    TaskTraceEvent& event = ring[ringNext];
+    event.timeUs = timeUs;
+    event.name = name;
+    event.value = value;
+    event.phase = phase;
+    event.task = (uint8_t)task;
+    ringNext = (ringNext + 1) % TASK_TRACE_EVENTS;
+    if (ringCount < TASK_TRACE_EVENTS) {
+      ringCount++;
+    }
+  }
+  portEXIT_CRITICAL(&traceLock);
+}
+
+bool taskTraceSetup() {
+  ring = (TaskTraceEvent*)calloc(TASK_TRACE_EVENTS, sizeof(TaskTraceEvent));
+  return ring != NULL;
+}
+
+void taskTraceBegin(const char* name) {
+  append('B', name, 0);
+}
+
+void taskTraceEnd(const char* name) {
+  append('E', name, 0);
+}
+
+void taskTraceInstant(const char* name, int32_t value) {
+  append('i', name, value);
+}
+
+// Writes the array elements one per line with the commas between them.
+struct JsonWriter {
+  ImageWriteFn write;
+  void* context;
+  bool first;
+};
+
+static void writeElement(JsonWriter& writer, const char* element, int length) {
+  if (length <= 0) {
+    return;
+  }
+  if (length >= ELEMENT_LENGTH) {
+    length = ELEMENT_LENGTH - 1;
+  }
+  writer.write((const uint8_t*)(writer.first ? "\n" : ",\n"), writer.first ? 1 : 2, writer.context);
+  writer.write((const uint8_t*)element, length, writer.context);
+  writer.first = false;
+}
+
+void taskTraceWrite(ImageWriteFn write, void* context) {
+  portENTER_CRITICAL(&traceLock);
+  paused = true;
+  uint32_t count = ringCount;
+  uint32_t first = (ringNext + TASK_TRACE_EVENTS - ringCount) % TASK_TRACE_EVENTS;
+  int knownTasks = taskCount;
+  portEXIT_CRITICAL(&traceLock);
+
+  static const char HEAD[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  write((const uint8_t*)HEAD, sizeof(HEAD) - 1, context);
+  JsonWriter writer = { write, context, true };
+  char element[ELEMENT_LENGTH];
+
+  // One process per core and one thread per task.
+  uint32_t cores = 0;
+  for (int i = 0; i < knownTasks; i++) {
+    if ((cores & (1u << tasks[i].core)) == 0) {
+      cores |= 1u << tasks[i].core;
+      int length = snprintf(
+        element, sizeof(element),
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"core %u\"}}",
+        tasks[i].core, tasks[i].core
+      );
+      writeElement(writer, element, length);
+    }
+    int length = snprintf(
+      element, sizeof(element),
+      "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+      tasks[i].core, i + 1, tasks[i].name
+    );
+    writeElement(writer, element, length);
+  }
+
+  int depth[TASK_TRACE_MAX_TASKS] = {};
+  for (uint32_t n = 0; n < count; n++) {
+    const TaskTraceEvent& event = ring[(first + n) % TASK_TRACE_EVENTS];
+    const TaskTraceTask& task = tasks[event.task];
+    int length;
+    if (event.phase == 'i') {
+      length = snprintf(
+        element, sizeof(element),
+        "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,\"pid\":%u,\"tid\":%d,\"args\":{\"value\":%ld}}",
+        event.name, (long long)event.timeUs, task.core, event.task + 1, (long)event.value
+      );
+    }
+    else {
+      if (event.phase == 'B') {
+        depth[event.task]++;
+      }
+      else if (depth[event.task] == 0) {
+        continue;
+      }
+      else {
+        depth[event.task]--;
+      }
+      length = snprintf(
+        element, sizeof(element),
+        "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":%u,\"tid\":%d}",
+        event.name, event.phase, (long long)event.timeUs, task.core, event.task + 1
+      );
+    }
+    writeElement(writer, element, length);
+  }
+
+  static const char TAIL[] = "\n]}\n";
+  write((const uint8_t*)TAIL, sizeof(TAIL) - 1, context);
+
+  portENTER_CRITICAL(&traceLock);
+  paused = false;
+  portEXIT_CRITICAL(&traceLock);
+}
+
+TaskTraceScope::TaskTraceScope(const char* name) {
+  _name = name;
+  taskTraceBegin(name);
+}
+
+TaskTraceScope::~TaskTraceScope() {
+  taskTraceEnd(_name);
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef TASK_TRACE_H
+#define TASK_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "text_writer.h"
+
+// Task activity trace. Built with -DTASK_TRACE=1, redraws, display mutex
+// waits and holds, NTP syncs, WiFi connects and transitions and input events
+// go into a RAM ring as begin/end or instant events, tagged with the task
+// and core they ran on. /tasks and the serial console `tasks` command write
+// the ring in the Chrome Trace Event format, which chrome://tracing and
+// https://ui.perfetto.dev open as one timeline per core.
+//
+// Without the flag the macros expand to nothing and no state is allocated.
+
+#ifndef TASK_TRACE_EVENTS
+  #define TASK_TRACE_EVENTS 1024
+#endif
+// Tasks are told apart by name, so a task that is deleted and created again
+// keeps its row.
+#define TASK_TRACE_MAX_TASKS 16
+
+bool taskTraceSetup();
+// name must outlive the trace, use a string literal.
+void taskTraceBegin(const char* name);
+void taskTraceEnd(const char* name);
+void taskTraceInstant(const char* name, int32_t value);
+// Writes the ring as Trace Event JSON, oldest event first. Recording pauses
+// while it runs. Ends whose begin was overwritten are left out; begins
+// without an end are still running, or were when the ring was written.
+void taskTraceWrite(ImageWriteFn write, void* context);
+
+// Begins an event and ends it when it goes out of scope.
+class TaskTraceScope {
+public:
+  explicit TaskTraceScope(const char* name);
+  ~TaskTraceScope();
+
+private:
+  const char* _name;
+};
+
+#if TASK_TRACE
+  #define TASK_TRACE_SCOPE(name) TaskTraceScope taskTraceScope(name)
+  #define TASK_TRACE_BEGIN(name) taskTraceBegin(name)
+  #define TASK_TRACE_END(name) taskTraceEnd(name)
+  #define TASK_TRACE_INSTANT(name, value) taskTraceInstant(name, value)
+#else
+  #define TASK_TRACE_SCOPE(name)
+  #define TASK_TRACE_BEGIN(name)
+  #define TASK_TRACE_END(name)
+  #define TASK_TRACE_INSTANT(name, value)
+#endif
+
+#endif
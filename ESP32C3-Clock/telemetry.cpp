@@ -0,0 +1,289 @@
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <mutex>
+#include <time.h>
+#include "Arduino.h"
+#include "telemetry.h"
+#include "task_trace.h"
+#include "config.h"
+#include "dns_cache.h"
+#include "metrics.h"
+#include "log_ring.h"
+#include "timing_constants.h"
+
+struct TelemetryEvent {
+  const char* name;
+  int32_t value;
+  uint32_t epoch;
+};
+
+static const int TELEMETRY_LINE_LENGTH = 128;
+// The shortest line, a counter with a one character name, is longer than 16
+// bytes.
+static const int DATAGRAM_MAX_LINES = TELEMETRY_DATAGRAM_BYTES / 16;
+
+// Events come from several tasks; the ring is only touched under the lock.
+// backlogFirstSequence counts the events that ever left the front of the
+// ring, so a push can tell which of the events it sent are still queued.
+static TelemetryEvent backlog[TELEMETRY_BACKLOG_EVENTS];
+static int backlogFirst = 0;
+static int backlogCount = 0;
+static uint32_t backlogFirstSequence = 0;
+static std::mutex backlogMutex;
+
+// Counter values at the last push that reached the collector, to send only
+// what changed since.
+static uint32_t sentValues[METRIC_COUNT];
+static uint32_t sentFamilyValues[METRIC_FAMILY_COUNT][METRIC_FAMILY_SLOTS];
+
+static WiFiUDP udp;
+
+// A counter value that becomes the sent value once its datagram is out.
+struct PendingValue {
+  uint32_t* sent;
+  uint32_t value;
+};
+
+struct Batch {
+  IPAddress address;
+  uint16_t port;
+  char tag[16];
+  char datagram[TELEMETRY_DATAGRAM_BYTES];
+  int length;
+  int datagrams;
+  // Set when a datagram could not be sent. Nothing after it is sent, so
+  // everything from that datagram on is kept for the next push.
+  bool failed;
+  // Counters and events in the datagram being filled.
+  PendingValue pending[DATAGRAM_MAX_LINES];
+  int pendingCount;
+  int pendingEvents;
+  // Events in datagrams that were sent.
+  int sentEvents;
+};
+
+void telemetryEvent(const char* name, int32_t value) {
+  time_t now = time(NULL);
+  std::lock_guard<std::mutex> lock(backlogMutex);
+  if (backlogCount == TELEMETRY_BACKLOG_EVENTS) {
+    backlogFirst = (backlogFirst + 1) % TELEMETRY_BACKLOG_EVENTS;
+    backlogCount--;
+    backlogFirstSequence++;
+    metricsAdd(METRIC_TELEMETRY_EVENTS_DROPPED, 1);
+  }
+  TelemetryEvent& event = backlog[(backlogFirst + backlogCount) % TELEMETRY_BACKLOG_EVENTS];
+  event.name = name;
+  event.value = value;
+  event.epoch = now > TIME_VALID_AFTER_EPOCH ? (uint32_t)now : 0;
+  backlogCount++;
+}
+
+// The counters and events of the datagram count as sent only when the
+// datagram left; otherwise they go out again with the next push.
+static void flush(Batch& batch) {
+  if (batch.length == 0 || batch.failed) {
+    return;
+  }
+  bool sent = udp.beginPacket(batch.address, batch.port)
+    && udp.write((const uint8_t*)batch.datagram, batch.length) == (size_t)batch.length
+    && udp.endPacket();
+  if (sent) {
+    for (int i = 0; i < batch.pendingCount; i++) {
+      *batch.pending[i].sent = batch.pending[i].value;
+    }
+    batch.sentEvents += batch.pendingEvents;
+    batch.datagrams++;
+  }
+  else {
+    batch.failed = true;
+  }
+  batch.length = 0;
+  batch.pendingCount = 0;
+  batch.pendingEvents = 0;
+}
+
+// Lines are newline separated and never split across datagrams. Returns
+// false when the line is dropped or the push stopped at a failed datagram,
+// so its value is not marked as sent.
+static bool addLine(Batch& batch, const char* line, int length) {
+  if (batch.failed) {
+    return false;
+  }
+  if (length <= 0 || length >= TELEMETRY_LINE_LENGTH) {
+    logWarn("Telemetry line does not fit, dropped");
+    return false;
+  }
+  if (batch.length + length + 1 > TELEMETRY_DATAGRAM_BYTES || batch.pendingCount == DATAGRAM_MAX_LINES) {
+    flush(batch);
+    if (batch.failed) {
+      return false;
+    }
+  }
+  if (batch.length > 0) {
+    batch.datagram[batch.length++] = '\n';
+  }
+  memcpy(batch.datagram + batch.length, line, length);
+  batch.length += length;
+  return true;
+}
+
+static void addCounterLine(Batch& batch, const char* line, int length, uint32_t* sent, uint32_t value) {
+  if (addLine(batch, line, length)) {
+    batch.pending[batch.pendingCount].sent = sent;
+    batch.pending[batch.pendingCount].value = value;
+    batch.pendingCount++;
+  }
+}
+
+static const char* shortName(const char* name) {
+  return strncmp(name, "clock_", 6) == 0 ? name + 6 : name;
+}
+
+static void addMetrics(Batch& batch) {
+  char line[TELEMETRY_LINE_LENGTH];
+  for (int i = 0; i < METRIC_COUNT; i++) {
+    const MetricInfo& info = metricsInfo((MetricId)i);
+    uint32_t value = metricsGet((MetricId)i);
+    // Values go out in the same unit as on /metrics, seconds for times.
+    char formatted[24];
+    int length;
+    if (info.type == METRIC_COUNTER) {
+      uint32_t delta = value - sentValues[i];
+      if (delta == 0) {
+        continue;
+      }
+      metricsFormatValue((MetricId)i, delta, formatted, sizeof(formatted));
+      length = snprintf(line, sizeof(line), "clock.%s:%s|c|#clock:%s", shortName(info.name), formatted, batch.tag);
+      addCounterLine(batch, line, length, &sentValues[i], value);
+    }
+    else {
+      metricsFormatValue((MetricId)i, value, formatted, sizeof(formatted));
+      length = snprintf(line, sizeof(line), "clock.%s:%s|g|#clock:%s", shortName(info.name), formatted, batch.tag);
+      addLine(batch, line, length);
+    }
+  }
+
+  for (int f = 0; f < METRIC_FAMILY_COUNT; f++) {
+    MetricFamilyId id = (MetricFamilyId)f;
+    const MetricFamilyInfo& info = metricsFamilyInfo(id);
+    int size = metricsFamilySize(id);
+    for (int i = 0; i < size; i++) {
+      uint32_t value = metricsFamilyGet(id, i);
+      uint32_t delta = value - sentFamilyValues[f][i];
+      if (delta == 0) {
+        continue;
+      }
+      int length = snprintf(
+        line, sizeof(line), "clock.%s:%lu|c|#clock:%s,%s:%s",
+        shortName(info.name), (unsigned long)delta, batch.tag, info.label, metricsFamilyLabel(id, i)
+      );
+      addCounterLine(batch, line, length, &sentFamilyValues[f][i], value);
+    }
+  }
+}
+
+// Events are copied out of the ring, so the lock is not held while sending,
+// and added last: the datagrams go out in order, and the events that were
+// sent are always the oldest ones.
+static void addEvents(Batch& batch, uint32_t* firstSequence) {
+  TelemetryEvent events[TELEMETRY_BACKLOG_EVENTS];
+  int count;
+  {
+    std::lock_guard<std::mutex> lock(backlogMutex);
+    count = backlogCount;
+    for (int i = 0; i < count; i++) {
+      events[i] = backlog[(backlogFirst + i) % TELEMETRY_BACKLOG_EVENTS];
+    }
+    *firstSequence = backlogFirstSequence;
+  }
+
+  char line[TELEMETRY_LINE_LENGTH];
+  for (int i = 0; i < count; i++) {
+    const TelemetryEvent& event = events[i];
+    int length;
+    if (event.epoch != 0) {
+      length = snprintf(
+        line, sizeof(line), "clock.event.%s:%ld|c|#clock:%s|T%lu",
+        event.name, (long)event.value, batch.tag, (unsigned long)event.epoch
+      );
+    }
+    else {
+      length = snprintf(line, sizeof(line), "clock.event.%s:%ld|c|#clock:%s", event.name, (long)event.value, batch.tag);
+    }
+    // An event that does not fit a line is logged and removed with the
+    // events around it; it would never fit in a later push either.
+    addLine(batch, line, length);
+    if (batch.failed) {
+      break;
+    }
+    batch.pendingEvents++;
+  }
+}
+
+// Removes the events that reached the collector. Events dropped from a full
+// ring in the meantime already left the front and are not removed twice.
+static void removeSentEvents(uint32_t firstSequence, int sentEvents) {
+  std::lock_guard<std::mutex> lock(backlogMutex);
+  int remove = (int)(firstSequence + (uint32_t)sentEvents - backlogFirstSequence);
+  if (remove <= 0) {
+    return;
+  }
+  if (remove > backlogCount) {
+    remove = backlogCount;
+  }
+  backlogFirst = (backlogFirst + remove) % TELEMETRY_BACKLOG_EVENTS;
+  backlogCount -= remove;
+  backlogFirstSequence += remove;
+}
+
+static bool resolveCollector(Batch& batch) {
+  String collector = getTelemetryCollector();
+  if (collector.length() == 0) {
+    return false;
+  }
+  int colon = collector.lastIndexOf(':');
+  String host = colon >= 0 ? collector.substring(0, colon) : collector;
+  batch.port = colon >= 0 ? (uint16_t)collector.substring(colon + 1).toInt() : TELEMETRY_DEFAULT_PORT;
+  if (batch.port == 0 || !dnsCacheLookup(host.c_str(), batch.address)) {
+    Serial.print("Cannot resolve telemetry collector: ");
+    Serial.println(collector);
+    return false;
+  }
+  return true;
+}
+
+void telemetryPush() {
+  if (WiFi.status() != WL_CONNECTED) {
+    return;
+  }
+  TASK_TRACE_SCOPE("telemetry_push");
+  static Batch batch;
+  if (!resolveCollector(batch)) {
+    return;
+  }
+
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  snprintf(batch.tag, sizeof(batch.tag), "%02x%02x%02x", mac[3], mac[4], mac[5]);
+  batch.length = 0;
+  batch.datagrams = 0;
+  batch.failed = false;
+  batch.pendingCount = 0;
+  batch.pendingEvents = 0;
+  batch.sentEvents = 0;
+
+  // Counted before the metrics are added, so the batch includes itself.
+  metricsAdd(METRIC_TELEMETRY_BATCHES, 1);
+  addMetrics(batch);
+  uint32_t firstSequence;
+  addEvents(batch, &firstSequence);
+  flush(batch);
+  removeSentEvents(firstSequence, batch.sentEvents);
+
+  Serial.print("Telemetry pushed in ");
+  Serial.print(batch.datagrams);
+  Serial.println(" datagrams.");
+  if (batch.failed) {
+    logWarn("Telemetry datagram not sent, the rest of the push is kept for the next one");
+  }
+}
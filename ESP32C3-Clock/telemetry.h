@@ -0,0 +1,33 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+// Pushes metrics and queued events to a statsd collector over UDP, set in
+// the config portal as host[:port]. Clocks in power save mode are only
+// reachable around their NTP syncs, so instead of being scraped they push
+// one burst of datagrams while the radio is up anyway. Every line carries
+// the clock's tag:
+//
+//   clock.<metric>:<value>|g|#clock:<id>                  gauge
+//   clock.<metric>:<delta>|c|#clock:<id>                  counter change
+//   clock.<metric>:<delta>|c|#clock:<id>,<label>:<value>  labeled counter
+//   clock.event.<name>:<value>|c|#clock:<id>|T<epoch>     queued event
+//
+// where <id> is the last three bytes of the WiFi MAC address and <metric> is
+// the metrics.h name without its clock_ prefix. Counters that did not change
+// since the last push are left out. Counter changes and events count as sent
+// only once the datagram carrying them was handed to the network; otherwise
+// they are sent again with the next push.
+
+#define TELEMETRY_DEFAULT_PORT 8125
+#define TELEMETRY_BACKLOG_EVENTS 32
+#define TELEMETRY_DATAGRAM_BYTES 512
+
+// Queues an event for the next push. name must outlive the push, use a
+// string literal. When the backlog is full the oldest event is dropped.
+void telemetryEvent(const char* name, int32_t value);
+// Sends the batch if a collector is configured and WiFi is connected.
+void telemetryPush();
+
+#endif
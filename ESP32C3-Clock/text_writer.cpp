@@ -0,0 +1,26 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include "text_writer.h"
+
+void writeTextLine(ImageWriteFn write, void* context, const char* line, int length) {
+  if (length > REPORT_LINE_LENGTH - 1) {
+    length = REPORT_LINE_LENGTH - 1;
+  }
+  if (length > 0) {
+    write((const uint8_t*)line, length, context);
+  }
+}
+
+int appendText(char* line, int length, const char* format, ...) {
+  if (length < 0 || length >= REPORT_LINE_LENGTH - 1) {
+    return length;
+  }
+  va_list args;
+  va_start(args, format);
+  int added = vsnprintf(line + length, REPORT_LINE_LENGTH - length, format, args);
+  va_end(args);
+  if (added < 0) {
+    return length;
+  }
+  return length + added < REPORT_LINE_LENGTH - 1 ? length + added : REPORT_LINE_LENGTH - 1;
+}
@@ -0,0 +1,25 @@
+#ifndef TEXT_WRITER_H
+#define TEXT_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Output callback shared by the image encoders and the text reports. Every
+// call hands over one piece, which a web server may send as a chunk of its
+// own.
+typedef void (*ImageWriteFn)(const uint8_t* data, size_t length, void* context);
+
+// Line buffer of the text reports served by the web server and printed by
+// the serial console.
+#define REPORT_LINE_LENGTH 160
+
+// Writes a line of a REPORT_LINE_LENGTH buffer. length is what snprintf() or
+// appendText() returned; a longer line is cut off at the end of the buffer.
+void writeTextLine(ImageWriteFn write, void* context, const char* line, int length);
+
+// Appends to a line of a REPORT_LINE_LENGTH buffer and returns the new
+// length. Output that does not fit is cut off, and the length never passes
+// the end of the line.
+int appendText(char* line, int length, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+#endif
@@ -3,6 +3,10 @@
 
 // Display update timing.
 #define BLINK_INTERVAL_MS 400UL
+// Blink frames are not started this close before a second boundary.
+#define FRAME_BOUNDARY_GUARD_MS 50UL
+// Wall clock values before this are treated as "not synced yet".
+#define TIME_VALID_AFTER_EPOCH 1700000000L
 
 // Button timing.
 #define BUTTON_DEBOUNCE_MS 40UL
@@ -14,13 +18,49 @@
 // Power save timing.
 #define WIFI_OFF_AFTER_SYNC_MS 60000UL
 #define NTP_SYNC_DELAY_MS 30000UL
+#define NTP_SYNC_DELAY_FAST_MS 200UL
+
+// Fast reconnect to the cached access point.
+#define WIFI_FAST_RECONNECT_TIMEOUT_MS 3000UL
+#define WIFI_FAST_RECONNECT_POLL_MS 20UL
 
 // NTP sync timing.
 #define NTP_SYNC_INTERVAL_MS 3UL * 60UL * 60UL * 1000UL
 #define NTP_TASK_CHECK_INTERVAL_MS 10000UL
+#define NTP_SERVER_TIMEOUT_MS 5000UL
+#define NTP_SYNC_POLL_MS 10UL
+
+// DNS cache for NTP server names. lwIP does not hand out the record TTL, so
+// every answer is kept for this long.
+#define DNS_CACHE_TTL_S (6L * 60L * 60L)
+#define DNS_CACHE_VALID_AFTER_EPOCH 1700000000L
+
+// Configuration portal timing.
+#define WIFI_PORTAL_TIMEOUT_S 180
+#define WIFI_PORTAL_PROCESS_INTERVAL_MS 20UL
+
+// Screenshot web server polling while WiFi is up, and while waiting for it.
+#define WEB_SERVER_POLL_MS 10UL
+#define WEB_SERVER_IDLE_POLL_MS 1000UL
+
+// Serial console timing.
+#define SERIAL_CONSOLE_POLL_MS 50UL
+// Pause after changing the baud rate for a screenshot dump, so the host can
+// follow before packets arrive at the new rate.
+#define SERIAL_BAUD_SWITCH_DELAY_MS 100UL
+
+// System monitor sampling of heap and task stacks.
+#define SYSTEM_MONITOR_INTERVAL_MS 10000UL
+
+// How often the LogDrain task prints the deferred log lines.
+#define LOG_DRAIN_INTERVAL_MS 50UL
+
+// Render stall watchdog: a stall is a gap this long without a finished
+// frame. Frames come every 400ms or faster.
+#define RENDER_STALL_TIMEOUT_MS 5000UL
+#define RENDER_WATCHDOG_CHECK_MS 1000UL
 
 // WiFi monitor timing.
-#define WIFI_MONITOR_CHECK_INTERVAL_MS 30000UL
 #define RECONNECT_INTERVAL_MS 10UL * 60UL * 1000UL
 
 #if !DISABLE_ENCODER
@@ -2,42 +2,126 @@
 #include "Arduino.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/timers.h"
 
 #include "wifi_monitor.h"
 #include "config.h"
 #include "app_state.h"
 #include "timing_constants.h"
+#include "task_trace.h"
+
+enum WifiMonitorEvent : uint8_t {
+  WIFI_MONITOR_LINK_UP,
+  WIFI_MONITOR_LINK_DOWN,
+  WIFI_MONITOR_RETRY
+};
+
+static const int WIFI_MONITOR_QUEUE_LENGTH = 8;
 
 static TaskHandle_t wifiMonitorTaskHandle = NULL;
+static QueueHandle_t wifiEventQueue = NULL;
+static TimerHandle_t reconnectTimer = NULL;
 
-static void wifiMonitorTask(void* parameter) {
-  for (;;) {
-    vTaskDelay(pdMS_TO_TICKS(WIFI_MONITOR_CHECK_INTERVAL_MS));
+// Runs in the WiFi driver's event task; only forwards to the monitor queue.
+static void onWifiEvent(WiFiEvent_t event) {
+  WifiMonitorEvent monitorEvent;
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      monitorEvent = WIFI_MONITOR_LINK_UP;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+      monitorEvent = WIFI_MONITOR_LINK_DOWN;
+      break;
+    default:
+      return;
+  }
+  xQueueSend(wifiEventQueue, &monitorEvent, 0);
+}
 
-    AppState state = getAppState();
+static void onReconnectTimer(TimerHandle_t timer) {
+  WifiMonitorEvent monitorEvent = WIFI_MONITOR_RETRY;
+  xQueueSend(wifiEventQueue, &monitorEvent, 0);
+}
+
+static void scheduleRetry() {
+  if (!xTimerIsTimerActive(reconnectTimer)) {
+    xTimerStart(reconnectTimer, 0);
+  }
+}
+
+static void handleLinkDown(AppState state) {
+  if (WiFi.status() == WL_CONNECTED) {
+    return;
+  }
+
+  // The link was turned off on purpose or nobody configured it yet.
+  if (state == NOT_CONFIGURED || state == SYNCED_WIFI_OFF) {
+    return;
+  }
+
+  // Someone else is busy with the link; check again later in case it fails.
+  if (state == RESET_PENDING || state == CONNECTING) {
+    scheduleRetry();
+    return;
+  }
+
+  if (state != DISCONNECTED) {
+    Serial.println("WiFi connection lost.");
+    setAppState(DISCONNECTED);
+  }
+
+  if (isReconnectDue()) {
+    Serial.println("Attempting to reconnect...");
+    updateLastReconnectAttempt();
+    connectWifi();
+  }
+
+  if (WiFi.status() != WL_CONNECTED) {
+    scheduleRetry();
+  }
+}
+
+static void handleLinkUp(AppState state) {
+  xTimerStop(reconnectTimer, 0);
+  if (state == DISCONNECTED) {
+    Serial.println("WiFi reconnected.");
+    setAppState(CONNECTED_NOT_SYNCED);
+  }
+}
 
-    if (state == RESET_PENDING || state == CONNECTING || state == NOT_CONFIGURED || state == SYNCED_WIFI_OFF) {
+static void wifiMonitorTask(void* parameter) {
+  WifiMonitorEvent monitorEvent;
+  for (;;) {
+    // Blocks until the WiFi driver or the retry timer reports something.
+    if (xQueueReceive(wifiEventQueue, &monitorEvent, portMAX_DELAY) != pdTRUE) {
       continue;
     }
 
-    if (WiFi.status() != WL_CONNECTED) {
-      Serial.println("WiFi connection lost.");
-      setAppState(DISCONNECTED);
-
-      if (isReconnectDue()) {
-        Serial.println("Attempting to reconnect...");
-        updateLastReconnectAttempt();
-        connectWifi();
-      }
+    AppState state = getAppState();
+    if (monitorEvent == WIFI_MONITOR_LINK_UP) {
+      TASK_TRACE_INSTANT("wifi_link_up", state);
+      handleLinkUp(state);
     }
-    else if (state == DISCONNECTED) {
-      Serial.println("WiFi reconnected.");
-      setAppState(CONNECTED_NOT_SYNCED);
+    else {
+      TASK_TRACE_INSTANT(monitorEvent == WIFI_MONITOR_RETRY ? "wifi_retry" : "wifi_link_down", state);
+      handleLinkDown(state);
     }
   }
 }
 
 void wifiMonitorTaskStart() {
+  wifiEventQueue = xQueueCreate(WIFI_MONITOR_QUEUE_LENGTH, sizeof(WifiMonitorEvent));
+  reconnectTimer = xTimerCreate(
+    "WifiRetry",
+    pdMS_TO_TICKS(RECONNECT_INTERVAL_MS),
+    pdFALSE,  // one-shot
+    NULL,
+    onReconnectTimer
+  );
+  WiFi.onEvent(onWifiEvent);
+
   xTaskCreatePinnedToCore(
     wifiMonitorTask,
     "WifiMonitor",
@@ -48,4 +132,10 @@ void wifiMonitorTaskStart() {
     0  // core 0
   );
   Serial.println("WiFi monitor task started on core 0.");
+
+  // The link may already be down before the event handler was registered.
+  if (WiFi.status() != WL_CONNECTED) {
+    WifiMonitorEvent monitorEvent = WIFI_MONITOR_LINK_DOWN;
+    xQueueSend(wifiEventQueue, &monitorEvent, 0);
+  }
 }
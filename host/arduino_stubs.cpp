@@ -0,0 +1,173 @@
+#include <cstdarg>
+#include <cstdio>
+#include <ctime>
+#include "Arduino.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static unsigned long hostMillis = 0;
+static esp_reset_reason_t hostResetReason = ESP_RST_POWERON;
+// Firmware logging is noise for the host tools; set HOST_SERIAL=1 to see it.
+static int serialEnabled = -1;
+
+unsigned long millis() {
+  return hostMillis;
+}
+
+unsigned long micros() {
+  return hostMillis * 1000UL;
+}
+
+int64_t esp_timer_get_time() {
+  return (int64_t)hostMillis * 1000;
+}
+
+void delay(unsigned long ms) {
+  hostMillis += ms;
+}
+
+void yield() {
+}
+
+int digitalRead(uint8_t pin) {
+  (void)pin;
+  return HIGH;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+uint32_t getCpuFrequencyMhz() {
+  return 1000;
+}
+
+uint32_t EspClass::getCycleCount() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+void hostSetMillis(unsigned long ms) {
+  hostMillis = ms;
+}
+
+void hostAdvanceMillis(unsigned long ms) {
+  hostMillis += ms;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (serialEnabled < 0) {
+    const char* env = getenv("HOST_SERIAL");
+    serialEnabled = (env != nullptr && env[0] == '1') ? 1 : 0;
+  }
+  if (serialEnabled) {
+    fputc(c, stderr);
+  }
+  return 1;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  write(buf);
+  return n < 0 ? 0 : (size_t)n;
+}
+
+static int hostMutex;
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return &hostMutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+  (void)semaphore;
+  (void)ticks;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  (void)semaphore;
+  return pdTRUE;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  hostMillis += ticks;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  (void)task;
+}
+
+static const int HOST_TASKS = 16;
+static char hostTaskNames[HOST_TASKS][16] = { "loopTask" };
+static int hostTaskCount = 1;
+static int hostTask = 0;
+static BaseType_t hostTaskCore = 1;
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return hostTaskNames[hostTask];
+}
+
+char* pcTaskGetName(TaskHandle_t task) {
+  return task != NULL ? (char*)task : hostTaskNames[hostTask];
+}
+
+BaseType_t xPortGetCoreID() {
+  return hostTaskCore;
+}
+
+void hostSetTask(const char* name, BaseType_t core) {
+  hostTask = 0;
+  while (hostTask < hostTaskCount && strncmp(hostTaskNames[hostTask], name, sizeof(hostTaskNames[0]) - 1) != 0) {
+    hostTask++;
+  }
+  if (hostTask == hostTaskCount) {
+    if (hostTaskCount == HOST_TASKS) {
+      hostTask = HOST_TASKS - 1;
+    }
+    else {
+      hostTaskCount++;
+    }
+    snprintf(hostTaskNames[hostTask], sizeof(hostTaskNames[0]), "%s", name);
+  }
+  hostTaskCore = core;
+}
+
+BaseType_t xTaskCreatePinnedToCore(
+  TaskFunction_t function,
+  const char* name,
+  uint32_t stackDepth,
+  void* parameter,
+  UBaseType_t priority,
+  TaskHandle_t* handle,
+  BaseType_t core
+) {
+  (void)function;
+  (void)name;
+  (void)stackDepth;
+  (void)parameter;
+  (void)priority;
+  (void)core;
+  if (handle != nullptr) {
+    *handle = nullptr;
+  }
+  return pdPASS;
+}
+
+esp_reset_reason_t esp_reset_reason() {
+  return hostResetReason;
+}
+
+void hostSetResetReason(esp_reset_reason_t reason) {
+  hostResetReason = reason;
+}
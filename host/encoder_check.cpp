@@ -0,0 +1,363 @@
+// Runs the screenshot encoders from image_encoder.cpp on every face the way
+// the web server does, strip by strip from the shadow framebuffer, decodes
+// the result and checks it against the panel pixel for pixel.
+//
+// Prints the encoded size of each format, the ratio to the 24-bit BMP the
+// server used to send, and the encode time per image.
+//
+// The live mirroring stream is checked the same way: each face runs for a
+// few minutes of second ticks, every frame sends the tiles changed since the
+// previous one, and a client copy rebuilt from the stream has to match the
+// panel after every frame.
+//
+// Serial dumps go through SerialDumpDecoder with log lines mixed into the
+// stream and one packet damaged; the damaged strip is requested again and
+// the result has to match the panel as well.
+//
+// Usage: encoder_check
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include "app_state.h"
+#include "clock_face_factory.h"
+#include "display.h"
+#include "host_image.h"
+#include "image_encoder.h"
+#include "serial_dump_decoder.h"
+
+static const size_t BMP_SIZE = 54 + (size_t)SCREEN_WIDTH * SCREEN_HEIGHT * 3;
+static const size_t PANEL_PIXELS = SCREEN_WIDTH * SCREEN_HEIGHT;
+
+static void appendBytes(const uint8_t* data, size_t length, void* context) {
+  std::vector<uint8_t>* out = (std::vector<uint8_t>*)context;
+  out->insert(out->end(), data, data + length);
+}
+
+// Serial stream as seen by the host: a log line between some packets and
+// one packet with a flipped bit.
+struct NoisySerial {
+  std::vector<uint8_t> bytes;
+  int packets;
+  int damagePacket;
+};
+
+static void appendNoisy(const uint8_t* data, size_t length, void* context) {
+  NoisySerial* serial = (NoisySerial*)context;
+  if (serial->packets % 50 == 7) {
+    static const char LOG_LINE[] = "NTP status: Time synced\n";
+    serial->bytes.insert(serial->bytes.end(), LOG_LINE, LOG_LINE + sizeof(LOG_LINE) - 1);
+  }
+  size_t start = serial->bytes.size();
+  serial->bytes.insert(serial->bytes.end(), data, data + length);
+  if (serial->packets == serial->damagePacket) {
+    serial->bytes[start + length / 2] ^= 0x10;
+  }
+  serial->packets++;
+}
+
+static void serialDump(SerialDumpEncoder& enc, NoisySerial& serial, int firstStrip, int stripCount, uint32_t seq) {
+  alignas(4) static uint16_t strip[SCREEN_WIDTH * SHADOW_STRIP_HEIGHT];
+  serialDumpBegin(enc, SCREEN_WIDTH, SCREEN_HEIGHT, seq, appendNoisy, &serial);
+  for (int s = firstStrip; s < firstStrip + stripCount; s++) {
+    displayCopyShadowStrip(s, strip);
+    serialDumpAddRows(enc, strip, s * SHADOW_STRIP_HEIGHT, SHADOW_STRIP_HEIGHT);
+  }
+  serialDumpEnd(enc);
+}
+
+static uint32_t readBe32(const uint8_t* buf) {
+  return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+}
+
+// Reference QOI decoder, written from the specification.
+static bool decodeQoi(const std::vector<uint8_t>& data, std::vector<uint8_t>& rgb, int& width, int& height) {
+  if (data.size() < 22 || memcmp(data.data(), "qoif", 4) != 0) {
+    return false;
+  }
+  width = readBe32(&data[4]);
+  height = readBe32(&data[8]);
+  size_t pixels = (size_t)width * height;
+  rgb.assign(pixels * 3, 0);
+
+  uint8_t index[64][4] = {};
+  uint8_t px[4] = { 0, 0, 0, 255 };
+  size_t pos = 14;
+  size_t end = data.size() - 8;
+  int run = 0;
+  for (size_t i = 0; i < pixels; i++) {
+    if (run > 0) {
+      run--;
+    }
+    else if (pos < end) {
+      uint8_t b1 = data[pos++];
+      if (b1 == 0xFE) {
+        px[0] = data[pos++];
+        px[1] = data[pos++];
+        px[2] = data[pos++];
+      }
+      else if (b1 == 0xFF) {
+        px[0] = data[pos++];
+        px[1] = data[pos++];
+        px[2] = data[pos++];
+        px[3] = data[pos++];
+      }
+      else if ((b1 & 0xC0) == 0x00) {
+        memcpy(px, index[b1], 4);
+      }
+      else if ((b1 & 0xC0) == 0x40) {
+        px[0] += ((b1 >> 4) & 3) - 2;
+        px[1] += ((b1 >> 2) & 3) - 2;
+        px[2] += (b1 & 3) - 2;
+      }
+      else if ((b1 & 0xC0) == 0x80) {
+        uint8_t b2 = data[pos++];
+        int dg = (b1 & 0x3F) - 32;
+        px[0] += dg - 8 + ((b2 >> 4) & 0x0F);
+        px[1] += dg;
+        px[2] += dg - 8 + (b2 & 0x0F);
+      }
+      else {
+        run = b1 & 0x3F;
+      }
+      memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+    }
+    else {
+      return false;
+    }
+    memcpy(&rgb[i * 3], px, 3);
+  }
+  static const uint8_t END_MARKER[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+  return pos == end && memcmp(&data[end], END_MARKER, 8) == 0;
+}
+
+// Applies one mirroring frame to the client copy of the screen.
+static bool decodeMirrorFrame(const std::vector<uint8_t>& data, std::vector<uint16_t>& screen, uint32_t& seq) {
+  size_t pos = 0;
+  if (data.size() < 6 || data[pos++] != 'F') {
+    return false;
+  }
+  seq = data[1] | (data[2] << 8) | (data[3] << 16) | ((uint32_t)data[4] << 24);
+  pos = 5;
+  while (pos < data.size() && data[pos] == 'R') {
+    if (pos + 5 > data.size()) {
+      return false;
+    }
+    int x = data[pos + 1];
+    int y = data[pos + 2];
+    int w = data[pos + 3];
+    int h = data[pos + 4];
+    pos += 5;
+    int filled = 0;
+    while (filled < w * h) {
+      if (pos + 3 > data.size()) {
+        return false;
+      }
+      int count = data[pos] + 1;
+      uint16_t color = data[pos + 1] | (data[pos + 2] << 8);
+      pos += 3;
+      for (int i = 0; i < count && filled < w * h; i++, filled++) {
+        screen[(y + filled / w) * SCREEN_WIDTH + x + filled % w] = color;
+      }
+    }
+  }
+  return pos + 1 == data.size() && data[pos] == 'E';
+}
+
+static bool matchesPanel(const std::vector<uint8_t>& rgb, int width, int height) {
+  if (width != SCREEN_WIDTH || height != SCREEN_HEIGHT || rgb.size() != PANEL_PIXELS * 3) {
+    return false;
+  }
+  const uint16_t* frame = TFT_display.framebuffer();
+  for (size_t i = 0; i < PANEL_PIXELS; i++) {
+    uint8_t expected[3];
+    rgb565ToRgb888(frame[i], expected);
+    if (memcmp(expected, &rgb[i * 3], 3) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static double elapsedUs(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main() {
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  displaySetup();
+
+  static PngEncoder png;
+  static QoiEncoder qoi;
+  alignas(4) static uint16_t strip[SCREEN_WIDTH * SHADOW_STRIP_HEIGHT];
+
+  // 10:10 on 2026-03-19, the screenshot build default.
+  time_t when = 1773915000;
+  tm timeinfo;
+  localtime_r(&when, &timeinfo);
+
+  printf("%-14s %10s %10s %7s %9s %10s %7s %9s\n", "face", "bmp", "png", "ratio", "png_us", "qoi", "ratio", "qoi_us");
+  int failures = 0;
+  for (int i = 0; i <= getFaceCount(); i++) {
+    const char* name;
+    if (i < getFaceCount()) {
+      ClockFace* face = getFaceAt(i);
+      face->reset();
+      DrawContext ctx = { CONNECTED_SYNCED, true, timeinfo, false };
+      face->draw(ctx);
+      name = face->getId();
+    }
+    else {
+      displayWifiSetupInstructions();
+      name = "screen_setup";
+    }
+
+    std::vector<uint8_t> pngData;
+    auto begin = std::chrono::steady_clock::now();
+    pngEncoderBegin(png, SCREEN_WIDTH, SCREEN_HEIGHT, appendBytes, &pngData);
+    for (int s = 0; s < SHADOW_STRIP_COUNT; s++) {
+      displayCopyShadowStrip(s, strip);
+      pngEncoderAddRows(png, strip, SHADOW_STRIP_HEIGHT);
+    }
+    pngEncoderEnd(png);
+    double pngUs = elapsedUs(begin);
+
+    std::vector<uint8_t> qoiData;
+    begin = std::chrono::steady_clock::now();
+    qoiEncoderBegin(qoi, SCREEN_WIDTH, SCREEN_HEIGHT, appendBytes, &qoiData);
+    for (int s = 0; s < SHADOW_STRIP_COUNT; s++) {
+      displayCopyShadowStrip(s, strip);
+      qoiEncoderAddRows(qoi, strip, SHADOW_STRIP_HEIGHT);
+    }
+    qoiEncoderEnd(qoi);
+    double qoiUs = elapsedUs(begin);
+
+    std::vector<uint8_t> rgb;
+    int width = 0;
+    int height = 0;
+    bool pngOk = decodePng(pngData, rgb, width, height) && matchesPanel(rgb, width, height);
+    bool qoiOk = decodeQoi(qoiData, rgb, width, height) && matchesPanel(rgb, width, height);
+
+    printf(
+      "%-14s %10zu %10zu %6.1fx %9.0f %10zu %6.1fx %9.0f%s%s\n",
+      name,
+      BMP_SIZE,
+      pngData.size(),
+      (double)BMP_SIZE / pngData.size(),
+      pngUs,
+      qoiData.size(),
+      (double)BMP_SIZE / qoiData.size(),
+      qoiUs,
+      pngOk ? "" : "  PNG MISMATCH",
+      qoiOk ? "" : "  QOI MISMATCH"
+    );
+    failures += !pngOk + !qoiOk;
+  }
+
+  static MirrorEncoder mirror;
+  static uint32_t tileGenerations[SHADOW_TILES_PER_ROW];
+  static const int MIRROR_TICKS = 180;
+  printf("\n%-14s %10s %10s %10s %10s\n", "face", "first", "avg", "max", "mismatch");
+  for (int i = 0; i < getFaceCount(); i++) {
+    ClockFace* face = getFaceAt(i);
+    face->reset();
+    TFT_display.fillScreen(COLOR_BACKGROUND);
+    std::vector<uint16_t> client(PANEL_PIXELS, 0);
+    uint32_t since = 0;
+    size_t first = 0;
+    size_t total = 0;
+    size_t largest = 0;
+    int mismatches = 0;
+
+    for (int tick = 0; tick < MIRROR_TICKS; tick++) {
+      time_t now = when + tick;
+      DrawContext ctx = { CONNECTED_SYNCED, (tick & 1) != 0, {}, false };
+      localtime_r(&now, &ctx.timeinfo);
+      face->draw(ctx);
+
+      std::vector<uint8_t> frame;
+      // As /live does: only strips with changed tiles are copied, and the
+      // client moves on only when it got a frame.
+      bool changedStrips[SHADOW_STRIP_COUNT];
+      uint32_t generation = displayNextShadowGeneration(since, changedStrips);
+      mirrorEncoderBegin(mirror, appendBytes, &frame);
+      mirrorEncoderBeginFrame(mirror, generation);
+      for (int s = 0; s < SHADOW_STRIP_COUNT; s++) {
+        if (!changedStrips[s]) {
+          continue;
+        }
+        displayCopyShadowStrip(s, strip, tileGenerations);
+        mirrorEncoderAddStrip(mirror, strip, SCREEN_WIDTH, s * SHADOW_STRIP_HEIGHT, SHADOW_STRIP_HEIGHT, tileGenerations, SHADOW_TILE_SIZE, since);
+      }
+      mirrorEncoderEndFrame(mirror);
+      if (!frame.empty()) {
+        since = generation + 1;
+      }
+
+      uint32_t seq = 0;
+      if (!frame.empty() && (!decodeMirrorFrame(frame, client, seq) || seq != generation)) {
+        mismatches++;
+      }
+      if (memcmp(client.data(), TFT_display.framebuffer(), PANEL_PIXELS * sizeof(uint16_t)) != 0) {
+        mismatches++;
+      }
+
+      if (tick == 0) {
+        first = frame.size();
+      }
+      else {
+        total += frame.size();
+        largest = std::max(largest, frame.size());
+      }
+    }
+
+    printf("%-14s %10zu %10zu %10zu %10d\n", face->getId(), first, total / (MIRROR_TICKS - 1), largest, mismatches);
+    failures += mismatches;
+  }
+
+  static SerialDumpEncoder serialEncoder;
+  printf("\n%-14s %10s %10s %10s %10s\n", "face", "serial", "ms@921600", "damaged", "mismatch");
+  for (int i = 0; i < getFaceCount(); i++) {
+    ClockFace* face = getFaceAt(i);
+    face->reset();
+    DrawContext ctx = { CONNECTED_SYNCED, true, timeinfo, false };
+    face->draw(ctx);
+
+    NoisySerial serial = { {}, 0, 100 };
+    serialDump(serialEncoder, serial, 0, SHADOW_STRIP_COUNT, i);
+    size_t fullBytes = serial.bytes.size();
+    SerialDumpDecoder decoder;
+    decoder.feed(serial.bytes.data(), serial.bytes.size());
+    size_t damaged = decoder.badPackets();
+
+    // What serial_screenshot does with the rows it did not get.
+    std::vector<int> missing = decoder.missingRows();
+    int lastStrip = -1;
+    for (int row : missing) {
+      if (row / SHADOW_STRIP_HEIGHT != lastStrip) {
+        lastStrip = row / SHADOW_STRIP_HEIGHT;
+        NoisySerial retry = { {}, 0, -1 };
+        serialDump(serialEncoder, retry, lastStrip, 1, i);
+        decoder.feed(retry.bytes.data(), retry.bytes.size());
+      }
+    }
+
+    bool ok = decoder.done() && damaged == 1 && missing.size() == 1 && decoder.missingRows().empty() &&
+      decoder.text().find("NTP status") != std::string::npos &&
+      memcmp(decoder.pixels().data(), TFT_display.framebuffer(), PANEL_PIXELS * sizeof(uint16_t)) == 0;
+    printf("%-14s %10zu %10.0f %10zu %10s\n", face->getId(), fullBytes, fullBytes * 10 * 1000.0 / 921600, damaged, ok ? "0" : "FAIL");
+    failures += !ok;
+  }
+
+  if (failures > 0) {
+    fprintf(stderr, "%d encoded images do not decode to the panel contents\n", failures);
+    return 1;
+  }
+  printf("All encoded images decode to the panel contents\n");
+  return 0;
+}
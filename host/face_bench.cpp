@@ -0,0 +1,331 @@
+// Replays a simulated day on every clock face and reports what each redraw
+// costs on the emulated panel.
+//
+// Every face from the factory is reset and then driven tick by tick through:
+//
+//   day          1440 minute ticks over a whole ordinary day
+//   midnight     3600 second ticks from 23:30 to 00:30
+//   dst_start    3600 second ticks across the spring forward transition
+//   dst_end      3600 second ticks across the fall back transition
+//   month_end    3600 second ticks across the end of February
+//   states       60 second ticks in each AppState a face is drawn in
+//
+// The reset frame of a scenario is a full repaint and is reported on its own
+// as "full"; all later frames are the incremental ticks. For both the pixel
+// writes, SPI transactions and bytes, and the CPU time of the draw call are
+// collected, and p50/p99/max printed per face.
+//
+// The worst case pixel and SPI figures are deterministic and are compared to
+// a baseline file. A face whose full repaint or worst tick grew by more than
+// the threshold fails the run.
+//
+// Usage: face_bench [--baseline file] [--threshold percent] [--update]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "app_state.h"
+#include "clock_face_factory.h"
+#include "display.h"
+
+// Europe/Budapest, the timezone the clock ships with.
+static const char* BENCH_TZ = "CET-1CEST,M3.5.0,M10.5.0/3";
+
+static const double DEFAULT_THRESHOLD_PERCENT = 5.0;
+
+struct Scenario {
+  const char* name;
+  // Local start time: year, month (1-12), day, hour, minute, second.
+  int start[6];
+  int ticks;
+  int stepSeconds;
+};
+
+static const Scenario SCENARIOS[] = {
+  { "day",       { 2026, 6, 15, 0, 0, 0 },    1440, 60 },
+  { "midnight",  { 2026, 6, 15, 23, 30, 0 },  3600, 1 },
+  { "dst_start", { 2026, 3, 29, 1, 30, 0 },   3600, 1 },
+  { "dst_end",   { 2026, 10, 25, 1, 30, 0 },  3600, 1 },
+  { "month_end", { 2026, 2, 28, 23, 30, 0 },  3600, 1 },
+};
+
+// States that reach ClockFace::draw(). NOT_CONFIGURED and RESET_PENDING are
+// full screen messages drawn by display.cpp instead of the face.
+static const AppState FACE_STATES[] = {
+  CONNECTING,
+  CONNECTED_NOT_SYNCED,
+  CONNECTED_SYNCING,
+  CONNECTED_SYNCED,
+  SYNCED_WIFI_OFF,
+  DISCONNECTED,
+};
+static const int STATE_TICKS = 60;
+
+struct Samples {
+  std::vector<uint64_t> pixels;
+  std::vector<uint64_t> spiTransactions;
+  std::vector<uint64_t> spiBytes;
+  std::vector<uint64_t> cpuNs;
+};
+
+struct FaceResult {
+  Samples full;
+  Samples ticks;
+};
+
+struct Worst {
+  uint64_t fullPixels;
+  uint64_t fullSpiBytes;
+  uint64_t tickPixels;
+  uint64_t tickSpiBytes;
+};
+
+static uint64_t cpuNow() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static time_t localEpoch(const int start[6]) {
+  struct tm t = {};
+  t.tm_year = start[0] - 1900;
+  t.tm_mon = start[1] - 1;
+  t.tm_mday = start[2];
+  t.tm_hour = start[3];
+  t.tm_min = start[4];
+  t.tm_sec = start[5];
+  t.tm_isdst = -1;
+  return mktime(&t);
+}
+
+static void drawTick(ClockFace* face, const DrawContext& ctx, Samples& samples) {
+  TFT_display.resetStats();
+  uint64_t begin = cpuNow();
+  face->draw(ctx);
+  uint64_t elapsed = cpuNow() - begin;
+
+  const TftStats& stats = TFT_display.stats();
+  samples.pixels.push_back(stats.pixels);
+  samples.spiTransactions.push_back(stats.spiTransactions);
+  samples.spiBytes.push_back(stats.spiBytes);
+  samples.cpuNs.push_back(elapsed);
+}
+
+static void runScenario(
+  ClockFace* face,
+  time_t start,
+  int ticks,
+  int stepSeconds,
+  AppState state,
+  FaceResult& result
+) {
+  face->reset();
+  bool blinkState = false;
+
+  for (int i = 0; i < ticks; i++) {
+    time_t now = start + (time_t)i * stepSeconds;
+    DrawContext ctx;
+    ctx.state = state;
+    ctx.blinkState = blinkState;
+    localtime_r(&now, &ctx.timeinfo);
+    ctx.gracePeriodActive = false;
+
+    drawTick(face, ctx, i == 0 ? result.full : result.ticks);
+
+    blinkState = !blinkState;
+    hostAdvanceMillis(stepSeconds * 1000UL);
+  }
+}
+
+static uint64_t percentile(std::vector<uint64_t> values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  size_t index = (size_t)(p / 100.0 * (values.size() - 1) + 0.5);
+  return values[index];
+}
+
+static uint64_t maxOf(const std::vector<uint64_t>& values) {
+  return values.empty() ? 0 : *std::max_element(values.begin(), values.end());
+}
+
+static void printRow(const char* face, const char* kind, const Samples& s) {
+  printf(
+    "%-14s %-5s %6zu  %7llu %7llu %7llu  %6llu %6llu %6llu  %7llu %7llu %7llu  %7.1f %7.1f %7.1f\n",
+    face,
+    kind,
+    s.pixels.size(),
+    (unsigned long long)percentile(s.pixels, 50),
+    (unsigned long long)percentile(s.pixels, 99),
+    (unsigned long long)maxOf(s.pixels),
+    (unsigned long long)percentile(s.spiTransactions, 50),
+    (unsigned long long)percentile(s.spiTransactions, 99),
+    (unsigned long long)maxOf(s.spiTransactions),
+    (unsigned long long)percentile(s.spiBytes, 50),
+    (unsigned long long)percentile(s.spiBytes, 99),
+    (unsigned long long)maxOf(s.spiBytes),
+    percentile(s.cpuNs, 50) / 1000.0,
+    percentile(s.cpuNs, 99) / 1000.0,
+    maxOf(s.cpuNs) / 1000.0
+  );
+}
+
+static bool readBaseline(const char* path, std::map<std::string, Worst>& baseline) {
+  FILE* f = fopen(path, "r");
+  if (f == NULL) {
+    return false;
+  }
+
+  char line[256];
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    char id[64];
+    unsigned long long fullPixels, fullSpiBytes, tickPixels, tickSpiBytes;
+    if (sscanf(line, "%63s %llu %llu %llu %llu", id, &fullPixels, &fullSpiBytes, &tickPixels, &tickSpiBytes) == 5) {
+      baseline[id] = { fullPixels, fullSpiBytes, tickPixels, tickSpiBytes };
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+static bool writeBaseline(const char* path, const std::map<std::string, Worst>& worst) {
+  FILE* f = fopen(path, "w");
+  if (f == NULL) {
+    return false;
+  }
+
+  fprintf(f, "# Worst case repaint cost per face, written by face_bench --update.\n");
+  fprintf(f, "# face full_pixels full_spi_bytes tick_pixels tick_spi_bytes\n");
+  for (const auto& entry : worst) {
+    const Worst& w = entry.second;
+    fprintf(
+      f,
+      "%s %llu %llu %llu %llu\n",
+      entry.first.c_str(),
+      (unsigned long long)w.fullPixels,
+      (unsigned long long)w.fullSpiBytes,
+      (unsigned long long)w.tickPixels,
+      (unsigned long long)w.tickSpiBytes
+    );
+  }
+  fclose(f);
+  return true;
+}
+
+static bool checkGrowth(const char* face, const char* what, uint64_t base, uint64_t now, double thresholdPercent) {
+  if (now <= base * (1.0 + thresholdPercent / 100.0)) {
+    return true;
+  }
+  fprintf(
+    stderr,
+    "FAIL %s: %s grew from %llu to %llu (+%.1f%%, limit %.1f%%)\n",
+    face,
+    what,
+    (unsigned long long)base,
+    (unsigned long long)now,
+    base == 0 ? 100.0 : (now - base) * 100.0 / base,
+    thresholdPercent
+  );
+  return false;
+}
+
+int main(int argc, char** argv) {
+  const char* baselinePath = "face_bench_baseline.txt";
+  double thresholdPercent = DEFAULT_THRESHOLD_PERCENT;
+  bool update = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+      baselinePath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+      thresholdPercent = atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--update") == 0) {
+      update = true;
+    }
+    else {
+      fprintf(stderr, "Usage: %s [--baseline file] [--threshold percent] [--update]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  setenv("TZ", BENCH_TZ, 1);
+  tzset();
+  displaySetup();
+
+  printf(
+    "%-14s %-5s %6s  %23s  %20s  %23s  %23s\n",
+    "", "", "", "pixels p50/p99/max", "spi_txns p50/p99/max", "spi_bytes p50/p99/max", "cpu_us p50/p99/max"
+  );
+  printf("%-14s %-5s %6s\n", "face", "kind", "frames");
+
+  std::map<std::string, Worst> worst;
+  for (int i = 0; i < getFaceCount(); i++) {
+    ClockFace* face = getFaceAt(i);
+    setClockFace(face);
+    FaceResult result;
+
+    for (const Scenario& scenario : SCENARIOS) {
+      runScenario(face, localEpoch(scenario.start), scenario.ticks, scenario.stepSeconds, CONNECTED_SYNCED, result);
+    }
+    time_t statesStart = localEpoch(SCENARIOS[0].start) + 12 * 3600;
+    for (AppState state : FACE_STATES) {
+      runScenario(face, statesStart, STATE_TICKS, 1, state, result);
+    }
+
+    printRow(face->getId(), "full", result.full);
+    printRow(face->getId(), "tick", result.ticks);
+
+    worst[face->getId()] = {
+      maxOf(result.full.pixels),
+      maxOf(result.full.spiBytes),
+      maxOf(result.ticks.pixels),
+      maxOf(result.ticks.spiBytes),
+    };
+  }
+
+  if (update) {
+    if (!writeBaseline(baselinePath, worst)) {
+      fprintf(stderr, "Cannot write %s\n", baselinePath);
+      return 1;
+    }
+    printf("Baseline written to %s\n", baselinePath);
+    return 0;
+  }
+
+  std::map<std::string, Worst> baseline;
+  if (!readBaseline(baselinePath, baseline)) {
+    fprintf(stderr, "Cannot read baseline %s, run with --update to create it\n", baselinePath);
+    return 1;
+  }
+
+  bool ok = true;
+  for (const auto& entry : worst) {
+    const char* id = entry.first.c_str();
+    auto base = baseline.find(entry.first);
+    if (base == baseline.end()) {
+      printf("%s: no baseline, skipped\n", id);
+      continue;
+    }
+    const Worst& b = base->second;
+    const Worst& w = entry.second;
+    ok &= checkGrowth(id, "full repaint pixels", b.fullPixels, w.fullPixels, thresholdPercent);
+    ok &= checkGrowth(id, "full repaint SPI bytes", b.fullSpiBytes, w.fullSpiBytes, thresholdPercent);
+    ok &= checkGrowth(id, "worst tick pixels", b.tickPixels, w.tickPixels, thresholdPercent);
+    ok &= checkGrowth(id, "worst tick SPI bytes", b.tickSpiBytes, w.tickSpiBytes, thresholdPercent);
+  }
+
+  printf(ok ? "Worst case repaints within %.1f%% of baseline\n" : "Worst case repaint regression (limit %.1f%%)\n", thresholdPercent);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+// Multi-instance simulation of the render loop's second boundary alignment.
+//
+// Each simulated clock has its own NTP residual offset, boot time, loop
+// iteration jitter and CPU jitter, and runs the firmware's FrameScheduler.
+// The frame cost comes from the face itself: every second of the window is
+// drawn once with the render profiler compiled in, and the SPI bytes of that
+// frame are turned into a transfer time. For every second the spread between
+// the first and the last clock showing the new value is measured, for every
+// face. The legacy free-running 400 ms timer is run for comparison.
+//
+// Built against the firmware compiled with -DRENDER_PROFILE=1.
+//
+// Usage: fleet_sim [instances] [seconds] [max_offset_ms]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "app_state.h"
+#include "clock_face_factory.h"
+#include "display.h"
+#include "frame_scheduler.h"
+#include "render_profile.h"
+#include "timing_constants.h"
+
+static const double SPREAD_LIMIT_MS = 10.0;
+// Assumed panel SPI clock, 40 MHz: 0.2 us per byte of the profiler's cost
+// model.
+static const double SPI_US_PER_BYTE = 8.0 / 40.0;
+
+// True start of the simulated window: an arbitrary wall clock second.
+static const int64_t START_SECOND = 1773916800LL;
+
+struct Instance {
+  FrameScheduler scheduler;
+  uint32_t legacyLastRedrawMs;
+  int64_t offsetUs;
+  int64_t bootUs;
+  int64_t nowUs;
+  int64_t lastShownSecond;
+};
+
+struct Result {
+  double p50Ms;
+  double p99Ms;
+  double maxMs;
+  size_t seconds;
+};
+
+static double percentile(std::vector<double> values, double p) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  std::sort(values.begin(), values.end());
+  size_t index = (size_t)(p * (values.size() - 1) + 0.5);
+  return values[index];
+}
+
+// Draws every second of the window once and returns the SPI time of each
+// frame in microseconds. A clock that shows the same second draws the same
+// frame, so the cost is the same across the fleet.
+static std::vector<int64_t> frameCostsUs(ClockFace* face, int seconds) {
+  std::vector<int64_t> costs;
+  face->reset();
+  // The first frame is a full repaint and not part of the window.
+  for (int tick = -1; tick <= seconds; tick++) {
+    time_t now = (time_t)(START_SECOND + tick);
+    DrawContext ctx = { CONNECTED_SYNCED, (tick & 1) != 0, {}, false };
+    localtime_r(&now, &ctx.timeinfo);
+    {
+      RENDER_PROFILE_FRAME(face->getId());
+      face->draw(ctx);
+    }
+    if (tick >= 0) {
+      costs.push_back((int64_t)(renderProfileLastFrameSpiBytes() * SPI_US_PER_BYTE));
+    }
+  }
+  return costs;
+}
+
+static Result simulate(
+  bool aligned,
+  int instanceCount,
+  int seconds,
+  double maxOffsetMs,
+  const std::vector<int64_t>& frameCosts,
+  uint32_t seed
+) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> offsetDist(-maxOffsetMs * 1000.0, maxOffsetMs * 1000.0);
+  std::uniform_int_distribution<int64_t> bootDist(0, 5000000);
+  // Clocks are powered on at unrelated moments.
+  std::uniform_int_distribution<int64_t> phaseDist(0, 1000000);
+  // Button polling between frames.
+  std::uniform_int_distribution<int64_t> loopCostDist(50, 500);
+  // CPU time of a frame besides its SPI transfers, and other tasks
+  // preempting it.
+  std::uniform_int_distribution<int64_t> frameJitterDist(200, 800);
+
+  const int64_t startUs = START_SECOND * 1000000LL;
+  const int64_t endUs = startUs + (int64_t)seconds * 1000000LL;
+
+  std::vector<Instance> instances(instanceCount);
+  for (Instance& instance : instances) {
+    frameSchedulerInit(instance.scheduler);
+    instance.legacyLastRedrawMs = 0;
+    instance.offsetUs = (int64_t)offsetDist(rng);
+    instance.bootUs = startUs - bootDist(rng) - 10000000LL;
+    instance.nowUs = startUs + phaseDist(rng);
+    instance.lastShownSecond = -1;
+  }
+
+  // second -> true time each instance showed it
+  std::map<int64_t, std::vector<int64_t>> flips;
+
+  for (Instance& instance : instances) {
+    while (instance.nowUs < endUs) {
+      uint32_t nowMs = (uint32_t)((instance.nowUs - instance.bootUs) / 1000);
+      int64_t wallUs = instance.nowUs + instance.offsetUs;
+
+      bool redraw;
+      if (aligned) {
+        redraw = frameSchedulerPoll(instance.scheduler, nowMs, wallUs) != FRAME_NONE;
+      }
+      else {
+        redraw = (nowMs - instance.legacyLastRedrawMs) >= BLINK_INTERVAL_MS;
+        if (redraw) {
+          instance.legacyLastRedrawMs = nowMs;
+        }
+      }
+
+      if (!redraw) {
+        instance.nowUs += loopCostDist(rng);
+        continue;
+      }
+
+      // The frame samples the time at its start and the new value becomes
+      // visible when the frame is done.
+      int64_t shownSecond = wallUs / 1000000LL;
+      int64_t index = std::min(std::max(shownSecond - START_SECOND, (int64_t)0), (int64_t)frameCosts.size() - 1);
+      instance.nowUs += frameCosts[index] + frameJitterDist(rng);
+      if (shownSecond != instance.lastShownSecond) {
+        if (instance.lastShownSecond >= 0) {
+          flips[shownSecond].push_back(instance.nowUs);
+        }
+        instance.lastShownSecond = shownSecond;
+      }
+    }
+  }
+
+  std::vector<double> spreads;
+  for (const auto& flip : flips) {
+    if ((int)flip.second.size() != instanceCount) {
+      continue;
+    }
+    auto range = std::minmax_element(flip.second.begin(), flip.second.end());
+    spreads.push_back((*range.second - *range.first) / 1000.0);
+  }
+
+  Result result;
+  result.p50Ms = percentile(spreads, 0.50);
+  result.p99Ms = percentile(spreads, 0.99);
+  result.maxMs = spreads.empty() ? 0.0 : *std::max_element(spreads.begin(), spreads.end());
+  result.seconds = spreads.size();
+  return result;
+}
+
+static void printResult(const char* label, const Result& result) {
+  printf(
+    "%-16s seconds=%-6zu spread p50=%7.2f ms  p99=%7.2f ms  max=%7.2f ms\n",
+    label,
+    result.seconds,
+    result.p50Ms,
+    result.p99Ms,
+    result.maxMs
+  );
+}
+
+int main(int argc, char** argv) {
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  displaySetup();
+
+  int instanceCount = argc > 1 ? atoi(argv[1]) : 16;
+  int seconds = argc > 2 ? atoi(argv[2]) : 600;
+  double maxOffsetMs = argc > 3 ? atof(argv[3]) : 2.0;
+
+  printf(
+    "Fleet simulation: %d clocks, %d s, NTP offset within +/-%.1f ms\n",
+    instanceCount,
+    seconds,
+    maxOffsetMs
+  );
+
+  bool ok = true;
+  for (int i = 0; i < getFaceCount(); i++) {
+    ClockFace* face = getFaceAt(i);
+    std::vector<int64_t> frameCosts = frameCostsUs(face, seconds);
+    int64_t maxCostUs = *std::max_element(frameCosts.begin(), frameCosts.end());
+    printf("%s: frame SPI time up to %.2f ms\n", face->getId(), maxCostUs / 1000.0);
+
+    Result legacy = simulate(false, instanceCount, seconds, maxOffsetMs, frameCosts, 1);
+    Result aligned = simulate(true, instanceCount, seconds, maxOffsetMs, frameCosts, 1);
+    printResult("  legacy", legacy);
+    printResult("  aligned", aligned);
+    if (aligned.seconds == 0 || aligned.maxMs >= SPREAD_LIMIT_MS) {
+      printf("FAIL: %s aligned spread exceeds %.0f ms\n", face->getId(), SPREAD_LIMIT_MS);
+      ok = false;
+    }
+  }
+  if (!ok) {
+    return 1;
+  }
+  printf("OK: all clocks flip within %.0f ms\n", SPREAD_LIMIT_MS);
+  return 0;
+}
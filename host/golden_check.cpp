@@ -0,0 +1,294 @@
+// Renders every clock face at a fixed set of times and states on the
+// emulated panel and compares the frames with the golden images in
+// host/golden/.
+//
+// For every case the number of differing pixels is printed. A case fails
+// when it differs in more pixels than the tolerance of its face. Rendered
+// frames go to the output directory, together with a <case>_diff.png that
+// marks the differing pixels in red over the dimmed golden, and a
+// <face>_heat.png heat map of how often each pixel differed across all
+// cases of that face.
+//
+// Usage: golden_check [--golden dir] [--out dir] [--update]
+//
+// --update rewrites the golden images from the current rendering. Do this
+// only for intended visual changes and review the new images before
+// committing them.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "app_state.h"
+#include "clock_face_factory.h"
+#include "display.h"
+#include "host_image.h"
+
+struct GoldenTime {
+  const char* name;
+  int year;
+  int month;
+  int day;
+  int hour;
+  int minute;
+  int second;
+};
+
+// 10:10 on 2026-03-19 matches the defaults of the screenshot build.
+static const GoldenTime TIMES[] = {
+  { "1010",     2026, 3, 19, 10, 10, 0 },
+  { "newyear",  2026, 1, 1, 0, 0, 0 },
+  { "morning",  2026, 6, 15, 6, 30, 45 },
+  { "yearend",  2026, 12, 31, 23, 59, 30 },
+};
+
+struct GoldenState {
+  const char* name;
+  AppState state;
+};
+
+// Every time is rendered synced, the first time also in these states.
+static const GoldenState EXTRA_STATES[] = {
+  { "syncing",      CONNECTED_SYNCING },
+  { "wifi_off",     SYNCED_WIFI_OFF },
+  { "disconnected", DISCONNECTED },
+};
+
+struct Tolerance {
+  const char* faceId;
+  int maxDifferingPixels;
+};
+
+// Faces built from float trigonometry can move single pixels between
+// compilers and libm versions; flat screens have to match exactly.
+static const Tolerance TOLERANCES[] = {
+  { "classic",       24 },
+  { "orbit",         48 },
+  { "bauhaus_light", 24 },
+  { "bauhaus_dark",  24 },
+  { "bauhaus_auto",  24 },
+  { "screen",        0 },
+};
+
+static const size_t PANEL_PIXELS = SCREEN_WIDTH * SCREEN_HEIGHT;
+
+struct CaseResult {
+  std::string name;
+  std::string group;
+  size_t differing;
+  int tolerance;
+  bool missing;
+};
+
+static int toleranceFor(const char* group) {
+  for (const Tolerance& t : TOLERANCES) {
+    if (strcmp(t.faceId, group) == 0) {
+      return t.maxDifferingPixels;
+    }
+  }
+  return 0;
+}
+
+static tm makeTime(const GoldenTime& t) {
+  tm timeinfo = {};
+  timeinfo.tm_year = t.year - 1900;
+  timeinfo.tm_mon = t.month - 1;
+  timeinfo.tm_mday = t.day;
+  timeinfo.tm_hour = t.hour;
+  timeinfo.tm_min = t.minute;
+  timeinfo.tm_sec = t.second;
+  timeinfo.tm_isdst = -1;
+  // Fills in the day of week and day of year.
+  time_t epoch = mktime(&timeinfo);
+  localtime_r(&epoch, &timeinfo);
+  return timeinfo;
+}
+
+static void renderFace(ClockFace* face, const tm& timeinfo, AppState state) {
+  TFT_display.fillScreen(COLOR_BACKGROUND);
+  face->reset();
+  DrawContext ctx = { state, true, timeinfo, false };
+  face->draw(ctx);
+}
+
+class GoldenRun {
+public:
+  GoldenRun(const std::string& goldenDir, const std::string& outDir, bool update)
+    : _goldenDir(goldenDir), _outDir(outDir), _update(update) {}
+
+  void check(const std::string& group, const std::string& name) {
+    const uint16_t* frame = TFT_display.framebuffer();
+    std::string goldenPath = _goldenDir + "/" + name + ".png";
+    writePng((_outDir + "/" + name + ".png").c_str(), frame, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    CaseResult result = { name, group, 0, toleranceFor(group.c_str()), false };
+    if (_update) {
+      if (!writePng(goldenPath.c_str(), frame, SCREEN_WIDTH, SCREEN_HEIGHT)) {
+        fprintf(stderr, "Cannot write %s\n", goldenPath.c_str());
+        result.missing = true;
+      }
+      _results.push_back(result);
+      return;
+    }
+
+    std::vector<uint8_t> golden;
+    int width = 0;
+    int height = 0;
+    if (!readPng(goldenPath.c_str(), golden, width, height) || width != SCREEN_WIDTH || height != SCREEN_HEIGHT) {
+      result.missing = true;
+      _results.push_back(result);
+      return;
+    }
+
+    std::vector<uint32_t>& heat = heatFor(group);
+    std::vector<uint8_t> diff(PANEL_PIXELS * 3);
+    for (size_t i = 0; i < PANEL_PIXELS; i++) {
+      uint8_t rendered[3];
+      rgb565ToRgb888(frame[i], rendered);
+      const uint8_t* expected = &golden[i * 3];
+      if (memcmp(rendered, expected, 3) != 0) {
+        result.differing++;
+        heat[i]++;
+        diff[i * 3] = 255;
+        diff[i * 3 + 1] = 0;
+        diff[i * 3 + 2] = 0;
+      }
+      else {
+        uint8_t gray = (expected[0] + expected[1] + expected[2]) / 12;
+        memset(&diff[i * 3], gray, 3);
+      }
+    }
+    if (result.differing > 0) {
+      writePngRgb((_outDir + "/" + name + "_diff.png").c_str(), diff.data(), SCREEN_WIDTH, SCREEN_HEIGHT);
+    }
+    _results.push_back(result);
+  }
+
+  // Black where nothing changed, through red and yellow to white where a
+  // pixel differed in every case of the group.
+  void writeHeatMaps() {
+    for (size_t g = 0; g < _heatGroups.size(); g++) {
+      const std::vector<uint32_t>& heat = _heat[g];
+      uint32_t peak = *std::max_element(heat.begin(), heat.end());
+      if (peak == 0) {
+        continue;
+      }
+      std::vector<uint8_t> rgb(PANEL_PIXELS * 3, 0);
+      for (size_t i = 0; i < PANEL_PIXELS; i++) {
+        if (heat[i] == 0) {
+          continue;
+        }
+        int level = 64 + (int)(heat[i] * 704 / peak);
+        rgb[i * 3] = (uint8_t)std::min(level, 255);
+        rgb[i * 3 + 1] = (uint8_t)std::min(std::max(level - 256, 0), 255);
+        rgb[i * 3 + 2] = (uint8_t)std::min(std::max(level - 512, 0), 255);
+      }
+      std::string path = _outDir + "/" + _heatGroups[g] + "_heat.png";
+      writePngRgb(path.c_str(), rgb.data(), SCREEN_WIDTH, SCREEN_HEIGHT);
+    }
+  }
+
+  const std::vector<CaseResult>& results() const { return _results; }
+
+private:
+  std::string _goldenDir;
+  std::string _outDir;
+  bool _update;
+  std::vector<CaseResult> _results;
+  std::vector<std::string> _heatGroups;
+  std::vector<std::vector<uint32_t>> _heat;
+
+  std::vector<uint32_t>& heatFor(const std::string& group) {
+    for (size_t g = 0; g < _heatGroups.size(); g++) {
+      if (_heatGroups[g] == group) {
+        return _heat[g];
+      }
+    }
+    _heatGroups.push_back(group);
+    _heat.emplace_back(PANEL_PIXELS, 0);
+    return _heat.back();
+  }
+};
+
+int main(int argc, char** argv) {
+  std::string goldenDir = "golden";
+  std::string outDir = "build/golden";
+  bool update = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+      goldenDir = argv[++i];
+    }
+    else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      outDir = argv[++i];
+    }
+    else if (strcmp(argv[i], "--update") == 0) {
+      update = true;
+    }
+    else {
+      fprintf(stderr, "Usage: %s [--golden dir] [--out dir] [--update]\n", argv[0]);
+      return 2;
+    }
+  }
+  mkdir(outDir.c_str(), 0755);
+  if (update) {
+    mkdir(goldenDir.c_str(), 0755);
+  }
+
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  displaySetup();
+  GoldenRun run(goldenDir, outDir, update);
+
+  for (int i = 0; i < getFaceCount(); i++) {
+    ClockFace* face = getFaceAt(i);
+    setClockFace(face);
+    std::string id = face->getId();
+
+    for (const GoldenTime& t : TIMES) {
+      renderFace(face, makeTime(t), CONNECTED_SYNCED);
+      run.check(id, id + "_" + t.name + "_synced");
+    }
+    for (const GoldenState& s : EXTRA_STATES) {
+      renderFace(face, makeTime(TIMES[0]), s.state);
+      run.check(id, id + "_" + TIMES[0].name + "_" + s.name);
+    }
+  }
+
+  // Full screen messages drawn by display.cpp instead of a face.
+  displayWifiSetupInstructions();
+  run.check("screen", "screen_setup");
+  TFT_display.fillScreen(COLOR_BACKGROUND);
+  displayResetQuestion();
+  run.check("screen", "screen_reset");
+
+  if (update) {
+    printf("Golden images written to %s\n", goldenDir.c_str());
+    return 0;
+  }
+  run.writeHeatMaps();
+
+  int failed = 0;
+  printf("%-36s %10s %10s\n", "case", "differing", "tolerance");
+  for (const CaseResult& r : run.results()) {
+    if (r.missing) {
+      printf("%-36s %10s %10d  FAIL\n", r.name.c_str(), "missing", r.tolerance);
+      failed++;
+      continue;
+    }
+    bool ok = r.differing <= (size_t)r.tolerance;
+    printf("%-36s %10zu %10d%s\n", r.name.c_str(), r.differing, r.tolerance, ok ? "" : "  FAIL");
+    failed += !ok;
+  }
+
+  if (failed > 0) {
+    fprintf(stderr, "%d of %zu cases differ from the golden images, see %s\n", failed, run.results().size(), outDir.c_str());
+    return 1;
+  }
+  printf("All %zu cases match the golden images\n", run.results().size());
+  return 0;
+}
@@ -0,0 +1,21 @@
+// Host replacement for config.cpp: fixed settings, nothing is persisted.
+#include "config.h"
+
+const char* WIFI_HOTSPOT_SSID = "ESP32-Clock";
+const char* WIFI_HOTSPOT_PASSWORD = "clocksetup";
+
+static String defaultFaceId = "orbit";
+
+String getDefaultFaceId() {
+  return defaultFaceId;
+}
+
+void saveDefaultFaceId(const char* id) {
+  if (id != nullptr) {
+    defaultFaceId = String(id);
+  }
+}
+
+bool getPowersafeMode() {
+  return false;
+}
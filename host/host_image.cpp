@@ -0,0 +1,237 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+#include "host_image.h"
+
+static const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+static void writeLe16(uint8_t* buf, uint16_t val) {
+  buf[0] = val & 0xFF;
+  buf[1] = (val >> 8) & 0xFF;
+}
+
+static void writeLe32(uint8_t* buf, uint32_t val) {
+  buf[0] = val & 0xFF;
+  buf[1] = (val >> 8) & 0xFF;
+  buf[2] = (val >> 16) & 0xFF;
+  buf[3] = (val >> 24) & 0xFF;
+}
+
+static void writeBe32(uint8_t* buf, uint32_t val) {
+  buf[0] = (val >> 24) & 0xFF;
+  buf[1] = (val >> 16) & 0xFF;
+  buf[2] = (val >> 8) & 0xFF;
+  buf[3] = val & 0xFF;
+}
+
+static uint32_t readBe32(const uint8_t* buf) {
+  return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+}
+
+static void writePngChunk(FILE* file, const char* type, const uint8_t* data, uint32_t length) {
+  uint8_t header[8];
+  writeBe32(header, length);
+  memcpy(header + 4, type, 4);
+  fwrite(header, 1, sizeof(header), file);
+  if (length > 0) {
+    fwrite(data, 1, length, file);
+  }
+
+  uint32_t crc = crc32(0, header + 4, 4);
+  if (length > 0) {
+    // crc32() with a null buffer returns the initial value instead.
+    crc = crc32(crc, data, length);
+  }
+  uint8_t trailer[4];
+  writeBe32(trailer, crc);
+  fwrite(trailer, 1, sizeof(trailer), file);
+}
+
+static int paeth(int a, int b, int c) {
+  int p = a + b - c;
+  int pa = abs(p - a);
+  int pb = abs(p - b);
+  int pc = abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return a;
+  }
+  return pb <= pc ? b : c;
+}
+
+bool writeBmp(const char* path, const uint16_t* pixels, int width, int height) {
+  FILE* file = fopen(path, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  int rowBytes = (width * 3 + 3) & ~3;
+  uint32_t imageSize = (uint32_t)rowBytes * height;
+
+  uint8_t header[54];
+  memset(header, 0, sizeof(header));
+  header[0] = 'B';
+  header[1] = 'M';
+  writeLe32(header + 2, 54 + imageSize);
+  writeLe32(header + 10, 54);
+  writeLe32(header + 14, 40);
+  writeLe32(header + 18, width);
+  writeLe32(header + 22, (uint32_t)(int32_t)(-height));
+  writeLe16(header + 26, 1);
+  writeLe16(header + 28, 24);
+  fwrite(header, 1, sizeof(header), file);
+
+  uint8_t row[4096];
+  for (int y = 0; y < height; y++) {
+    memset(row, 0, rowBytes);
+    for (int x = 0; x < width; x++) {
+      uint16_t pixel = pixels[y * width + x];
+      uint8_t rgb[3];
+      rgb565ToRgb888(pixel, rgb);
+      row[x * 3 + 0] = rgb[2];
+      row[x * 3 + 1] = rgb[1];
+      row[x * 3 + 2] = rgb[0];
+    }
+    fwrite(row, 1, rowBytes, file);
+  }
+
+  return fclose(file) == 0;
+}
+
+bool writePngRgb(const char* path, const uint8_t* rgb, int width, int height) {
+  size_t rowBytes = (size_t)width * 3;
+  std::vector<uint8_t> raw((rowBytes + 1) * height);
+  for (int y = 0; y < height; y++) {
+    // Filter type 0 (None) on every row.
+    raw[y * (rowBytes + 1)] = 0;
+    memcpy(&raw[y * (rowBytes + 1) + 1], rgb + y * rowBytes, rowBytes);
+  }
+
+  uLongf compressedSize = compressBound(raw.size());
+  std::vector<uint8_t> compressed(compressedSize);
+  if (compress2(compressed.data(), &compressedSize, raw.data(), raw.size(), Z_BEST_COMPRESSION) != Z_OK) {
+    return false;
+  }
+
+  FILE* file = fopen(path, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  uint8_t ihdr[13];
+  writeBe32(ihdr, width);
+  writeBe32(ihdr + 4, height);
+  ihdr[8] = 8;   // bit depth
+  ihdr[9] = 2;   // color type RGB
+  ihdr[10] = 0;  // deflate
+  ihdr[11] = 0;  // adaptive filtering
+  ihdr[12] = 0;  // not interlaced
+
+  fwrite(PNG_SIGNATURE, 1, sizeof(PNG_SIGNATURE), file);
+  writePngChunk(file, "IHDR", ihdr, sizeof(ihdr));
+  writePngChunk(file, "IDAT", compressed.data(), compressedSize);
+  writePngChunk(file, "IEND", nullptr, 0);
+  return fclose(file) == 0;
+}
+
+bool writePng(const char* path, const uint16_t* pixels, int width, int height) {
+  std::vector<uint8_t> rgb((size_t)width * height * 3);
+  for (int i = 0; i < width * height; i++) {
+    rgb565ToRgb888(pixels[i], &rgb[i * 3]);
+  }
+  return writePngRgb(path, rgb.data(), width, height);
+}
+
+bool readPng(const char* path, std::vector<uint8_t>& rgb, int& width, int& height) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), file)) > 0) {
+    data.insert(data.end(), buf, buf + n);
+  }
+  fclose(file);
+  return decodePng(data, rgb, width, height);
+}
+
+bool decodePng(const std::vector<uint8_t>& data, std::vector<uint8_t>& rgb, int& width, int& height) {
+  if (data.size() < sizeof(PNG_SIGNATURE) || memcmp(data.data(), PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0) {
+    return false;
+  }
+
+  int channels = 0;
+  std::vector<uint8_t> idat;
+  size_t pos = sizeof(PNG_SIGNATURE);
+  while (pos + 12 <= data.size()) {
+    uint32_t length = readBe32(&data[pos]);
+    const char* type = (const char*)&data[pos + 4];
+    if (pos + 12 + length > data.size()) {
+      return false;
+    }
+    const uint8_t* chunk = &data[pos + 8];
+    if (crc32(crc32(0, (const uint8_t*)type, 4), chunk, length) != readBe32(chunk + length)) {
+      return false;
+    }
+
+    if (memcmp(type, "IHDR", 4) == 0) {
+      width = readBe32(chunk);
+      height = readBe32(chunk + 4);
+      uint8_t bitDepth = chunk[8];
+      uint8_t colorType = chunk[9];
+      uint8_t interlace = chunk[12];
+      if (bitDepth != 8 || interlace != 0 || (colorType != 2 && colorType != 6)) {
+        return false;
+      }
+      channels = colorType == 2 ? 3 : 4;
+    }
+    else if (memcmp(type, "IDAT", 4) == 0) {
+      idat.insert(idat.end(), chunk, chunk + length);
+    }
+    else if (memcmp(type, "IEND", 4) == 0) {
+      break;
+    }
+    pos += 12 + length;
+  }
+  if (channels == 0 || width <= 0 || height <= 0) {
+    return false;
+  }
+
+  size_t stride = (size_t)width * channels;
+  uLongf rawSize = (stride + 1) * height;
+  std::vector<uint8_t> raw(rawSize);
+  if (uncompress(raw.data(), &rawSize, idat.data(), idat.size()) != Z_OK || rawSize != raw.size()) {
+    return false;
+  }
+
+  std::vector<uint8_t> pixels(stride * height);
+  for (int y = 0; y < height; y++) {
+    uint8_t filter = raw[y * (stride + 1)];
+    const uint8_t* in = &raw[y * (stride + 1) + 1];
+    uint8_t* out = &pixels[y * stride];
+    const uint8_t* prev = y > 0 ? &pixels[(y - 1) * stride] : nullptr;
+    for (size_t i = 0; i < stride; i++) {
+      int a = i >= (size_t)channels ? out[i - channels] : 0;
+      int b = prev != nullptr ? prev[i] : 0;
+      int c = (prev != nullptr && i >= (size_t)channels) ? prev[i - channels] : 0;
+      int value;
+      switch (filter) {
+        case 0: value = in[i]; break;
+        case 1: value = in[i] + a; break;
+        case 2: value = in[i] + b; break;
+        case 3: value = in[i] + ((a + b) >> 1); break;
+        case 4: value = in[i] + paeth(a, b, c); break;
+        default: return false;
+      }
+      out[i] = (uint8_t)value;
+    }
+  }
+
+  rgb.resize((size_t)width * height * 3);
+  for (int i = 0; i < width * height; i++) {
+    memcpy(&rgb[i * 3], &pixels[i * channels], 3);
+  }
+  return true;
+}
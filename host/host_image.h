@@ -0,0 +1,28 @@
+#ifndef HOST_IMAGE_H
+#define HOST_IMAGE_H
+
+#include <cstdint>
+#include <vector>
+
+// Writes a width x height RGB565 buffer as a 24-bit BMP, the same format
+// the screenshot server produces.
+bool writeBmp(const char* path, const uint16_t* pixels, int width, int height);
+
+// Writes a width x height RGB565 buffer as an 8-bit RGB PNG.
+bool writePng(const char* path, const uint16_t* pixels, int width, int height);
+
+// Writes packed 8-bit RGB pixels as a PNG.
+bool writePngRgb(const char* path, const uint8_t* rgb, int width, int height);
+
+// Reads an 8-bit RGB or RGBA, non-interlaced PNG into packed RGB pixels.
+bool readPng(const char* path, std::vector<uint8_t>& rgb, int& width, int& height);
+bool decodePng(const std::vector<uint8_t>& data, std::vector<uint8_t>& rgb, int& width, int& height);
+
+// Expands an RGB565 pixel the way the screenshot server does.
+inline void rgb565ToRgb888(uint16_t pixel, uint8_t* out) {
+  out[0] = (pixel >> 8) & 0xF8;
+  out[1] = (pixel >> 3) & 0xFC;
+  out[2] = (pixel << 3) & 0xF8;
+}
+
+#endif
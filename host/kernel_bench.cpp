@@ -0,0 +1,650 @@
+// Microbenchmarks and reference-equivalence checks for the clock face
+// geometry kernels in clock_face_helpers.
+//
+// The reference namespace below holds frozen copies of the kernels as they
+// were when this tool was written. Each firmware kernel is timed against its
+// reference over every angle, width and fraction the faces can reach, and
+// its output has to match the reference pixel for pixel:
+//
+//   roundAngle         same value for every reachable hand angle
+//   collectHandPixels  same set of pixels for every angle, width and length
+//   drawHandDiff       same panel contents after every step of a full sweep
+//   drawSingleArc      same panel contents for every reachable fraction
+//   drawCounterweight  same panel contents after every step of a full sweep
+//
+// A kernel that produces different pixels fails the run, so a faster kernel
+// can be swapped in once this passes. Pixel write counts are reported next
+// to the timings since an optimized kernel may legitimately write less.
+//
+// Usage: kernel_bench [--quick]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "clock_face_helpers.h"
+#include "display.h"
+#include "display_constants.h"
+
+static const uint16_t BENCH_BACKGROUND = 0x0000;
+static const uint16_t BENCH_HAND = 0xFFFF;
+static const uint16_t BENCH_ARC = 0x07E0;
+static const uint16_t BENCH_TRACK = 0x3186;
+static const uint16_t BENCH_OUTLINE = 0xF800;
+static const uint16_t BENCH_WEIGHT = 0x001F;
+
+// Largest buffer drawHandDiff accepts (HAND_PIXEL_BUF_MAX in the helpers).
+static const int HAND_BUF_MAX = 380;
+static const int COLLECT_BUF_SIZE = 2048;
+static const int HUB_CLIP_RADIUS = 8;
+
+struct HandConfig {
+  const char* name;
+  int length;
+  int width;
+  int bufSize;
+};
+
+// The hands the faces draw.
+static const HandConfig HANDS[] = {
+  { "classic_hour",   50, 5, 300 },
+  { "classic_minute", 93, 3, 320 },
+  { "bauhaus_hour",   55, 6, 350 },
+  { "bauhaus_minute", 95, 4, 380 },
+};
+
+struct ArcConfig {
+  const char* name;
+  int innerR;
+  int outerR;
+};
+
+// The orbit face rings, ARC_STEP_DEG apart.
+static const float ARC_STEP_DEG = 0.3f;
+static const ArcConfig ARCS[] = {
+  { "orbit_minute", 102, 104 },
+  { "orbit_day",    107, 109 },
+  { "orbit_month",  112, 114 },
+  { "orbit_year",   117, 119 },
+};
+
+static const int COUNTERWEIGHT_DIST = 15;
+static const int COUNTERWEIGHT_RADIUS = 5;
+static const int COUNTERWEIGHT_CLIP_R = 90;
+
+static bool isClippedHub(int x, int y) {
+  int dx = x - CENTER_X;
+  int dy = y - CENTER_Y;
+  return dx * dx + dy * dy <= HUB_CLIP_RADIUS * HUB_CLIP_RADIUS;
+}
+
+namespace reference {
+
+float roundAngle(float x) {
+  return std::floor((x * 10) + 0.5f) / 10;
+}
+
+int collectHandPixels(
+  float angleDeg,
+  int length,
+  int width,
+  Pixel* buf,
+  int bufSize,
+  bool (*clipFn)(int x, int y)
+) {
+  float rad = (angleDeg - 90.0f) * PI / 180.0f;
+  float perpRad = rad + PI / 2.0f;
+
+  int ex = CENTER_X + (int)(length * cosf(rad));
+  int ey = CENTER_Y + (int)(length * sinf(rad));
+
+  int count = 0;
+  int half = width / 2;
+  for (int i = -half; i <= half; i++) {
+    int ox = (int)roundf(i * cosf(perpRad));
+    int oy = (int)roundf(i * sinf(perpRad));
+    int x0 = CENTER_X + ox, y0 = CENTER_Y + oy;
+    int x1 = ex + ox, y1 = ey + oy;
+
+    int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+    int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    while (true) {
+      if (!clipFn(x0, y0) && count < bufSize) {
+        buf[count++] = {(int16_t)x0, (int16_t)y0};
+      }
+      if (x0 == x1 && y0 == y1) {
+        break;
+      }
+      int e2 = 2 * err;
+      if (e2 >= dy) {
+        err += dy;
+        x0 += sx;
+      }
+      if (e2 <= dx) {
+        err += dx;
+        y0 += sy;
+      }
+    }
+  }
+  return count;
+}
+
+void drawHandDiff(
+  int length,
+  int width,
+  float newAngle,
+  Pixel* lastPixels,
+  int& lastCount,
+  int bufSize,
+  uint16_t color,
+  uint16_t backgroundColor,
+  bool (*clipFn)(int x, int y)
+) {
+  static Pixel newPixels[HAND_BUF_MAX];
+  int newCount = reference::collectHandPixels(newAngle, length, width, newPixels, bufSize, clipFn);
+
+  for (int i = 0; i < newCount; i++) {
+    TFT_display.drawPixel(newPixels[i].x, newPixels[i].y, color);
+  }
+
+  for (int i = 0; i < lastCount; i++) {
+    bool found = false;
+    for (int j = 0; j < newCount; j++) {
+      if (lastPixels[i].x == newPixels[j].x && lastPixels[i].y == newPixels[j].y) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      TFT_display.drawPixel(lastPixels[i].x, lastPixels[i].y, backgroundColor);
+    }
+  }
+
+  memcpy(lastPixels, newPixels, newCount * sizeof(Pixel));
+  lastCount = newCount;
+}
+
+void drawSingleArc(
+  float fraction,
+  int innerR,
+  int outerR,
+  float stepDeg,
+  uint16_t arcColor,
+  uint16_t trackColor
+) {
+  float filledDeg = fraction * 360.0f;
+  for (float angle = 0.0f; angle < 360.0f; angle += stepDeg) {
+    float rad = (angle - 90.0f) * PI / 180.0f;
+    uint16_t color = (angle < filledDeg) ? arcColor : trackColor;
+    for (int r = innerR; r <= outerR; r++) {
+      int x = CENTER_X + (int)roundf(r * cosf(rad));
+      int y = CENTER_Y + (int)roundf(r * sinf(rad));
+      TFT_display.drawPixel(x, y, color);
+    }
+  }
+}
+
+void drawCounterweight(
+  float hourAngleDeg,
+  int dist,
+  int radius,
+  int clipR,
+  bool& lastValid,
+  int16_t& lastX,
+  int16_t& lastY,
+  uint16_t color,
+  uint16_t outlineColor,
+  uint16_t backgroundColor
+) {
+  float rad = (hourAngleDeg + 180.0f) * PI / 180.0f;
+  int cx = CENTER_X + (int)roundf(dist * cosf(rad));
+  int cy = CENTER_Y + (int)roundf(dist * sinf(rad));
+
+  if (lastValid) {
+    TFT_display.fillCircle(lastX, lastY, radius, backgroundColor);
+    TFT_display.drawCircle(lastX, lastY, radius, outlineColor);
+    lastValid = false;
+  }
+
+  int dx = cx - CENTER_X;
+  int dy = cy - CENTER_Y;
+  if (dx * dx + dy * dy >= clipR * clipR) {
+    return;
+  }
+
+  TFT_display.fillCircle(cx, cy, radius, color);
+  TFT_display.drawCircle(cx, cy, radius, outlineColor);
+  lastX = (int16_t)cx;
+  lastY = (int16_t)cy;
+  lastValid = true;
+}
+
+}  // namespace reference
+
+// Every angle a hand can point at after roundAngle(): hours move in 0.5
+// degree steps, minutes with seconds (classic face) in 0.1 degree steps.
+static std::vector<float> handAngles() {
+  std::vector<float> angles;
+  for (int m = 0; m < 60; m++) {
+    for (int s = 0; s < 60; s++) {
+      angles.push_back(reference::roundAngle(m * 6.0f + s * 0.1f));
+    }
+  }
+  return angles;
+}
+
+static std::vector<float> hourAngles() {
+  std::vector<float> angles;
+  for (int h = 0; h < 12; h++) {
+    for (int m = 0; m < 60; m++) {
+      angles.push_back(reference::roundAngle(h * 30.0f + m * 0.5f));
+    }
+  }
+  return angles;
+}
+
+// Every fraction an orbit ring can show: minutes of the hour, minutes of the
+// day, days of each month length and days of both year lengths.
+static std::vector<float> arcFractions() {
+  std::vector<float> fractions;
+  for (int m = 0; m <= 60; m++) {
+    fractions.push_back(m / 60.0f);
+  }
+  for (int m = 1; m <= 1440; m++) {
+    fractions.push_back(m / 1440.0f);
+  }
+  for (int days = 28; days <= 31; days++) {
+    for (int d = 1; d <= days; d++) {
+      fractions.push_back(d / (float)days);
+    }
+  }
+  for (int days = 365; days <= 366; days++) {
+    for (int d = 1; d <= days; d++) {
+      fractions.push_back(d / (float)days);
+    }
+  }
+  return fractions;
+}
+
+struct Timing {
+  double referenceNs;
+  double kernelNs;
+  uint64_t referencePixels;
+  uint64_t kernelPixels;
+};
+
+static double timeNs(const std::function<void()>& run) {
+  auto begin = std::chrono::steady_clock::now();
+  run();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - begin).count();
+}
+
+static void printTiming(const char* kernel, const char* config, size_t calls, const Timing& t) {
+  printf(
+    "%-18s %-15s %7zu %10.1f %10.1f %7.2fx %12llu %12llu\n",
+    kernel,
+    config,
+    calls,
+    t.referenceNs / calls,
+    t.kernelNs / calls,
+    t.kernelNs > 0 ? t.referenceNs / t.kernelNs : 0.0,
+    (unsigned long long)t.referencePixels,
+    (unsigned long long)t.kernelPixels
+  );
+}
+
+static Timing timePair(const std::function<void()>& referenceRun, const std::function<void()>& kernelRun) {
+  Timing t;
+  TFT_display.fillScreen(BENCH_BACKGROUND);
+  TFT_display.resetStats();
+  t.referenceNs = timeNs(referenceRun);
+  t.referencePixels = TFT_display.stats().pixels;
+
+  TFT_display.fillScreen(BENCH_BACKGROUND);
+  TFT_display.resetStats();
+  t.kernelNs = timeNs(kernelRun);
+  t.kernelPixels = TFT_display.stats().pixels;
+  return t;
+}
+
+static const size_t PANEL_PIXELS = SCREEN_WIDTH * SCREEN_HEIGHT;
+
+// Runs the reference and the kernel step by step on two separate copies of
+// the panel and compares them after each step. Returns the number of steps
+// whose pixels differ.
+class PanelPair {
+public:
+  PanelPair() : _reference(PANEL_PIXELS, BENCH_BACKGROUND), _kernel(PANEL_PIXELS, BENCH_BACKGROUND) {}
+
+  bool step(const std::function<void()>& referenceStep, const std::function<void()>& kernelStep) {
+    TFT_display.loadFramebuffer(_reference.data());
+    referenceStep();
+    memcpy(_reference.data(), TFT_display.framebuffer(), PANEL_PIXELS * sizeof(uint16_t));
+
+    TFT_display.loadFramebuffer(_kernel.data());
+    kernelStep();
+    memcpy(_kernel.data(), TFT_display.framebuffer(), PANEL_PIXELS * sizeof(uint16_t));
+
+    size_t differing = 0;
+    for (size_t i = 0; i < PANEL_PIXELS; i++) {
+      differing += _reference[i] != _kernel[i];
+    }
+    _worstDiff = std::max(_worstDiff, differing);
+    return differing == 0;
+  }
+
+  size_t worstDiff() const { return _worstDiff; }
+
+private:
+  std::vector<uint16_t> _reference;
+  std::vector<uint16_t> _kernel;
+  size_t _worstDiff = 0;
+};
+
+static int failures = 0;
+
+static void report(const char* kernel, const char* config, size_t mismatches, size_t cases, const char* detail) {
+  if (mismatches == 0) {
+    return;
+  }
+  failures++;
+  fprintf(stderr, "FAIL %s %s: %zu of %zu cases differ from the reference%s\n", kernel, config, mismatches, cases, detail);
+}
+
+static void benchRoundAngle(int repeat) {
+  // The unrounded angles the faces compute from the time.
+  std::vector<float> inputs;
+  for (int m = 0; m < 60; m++) {
+    for (int s = 0; s < 60; s++) {
+      inputs.push_back(m * 6.0f + s * 0.1f);
+    }
+  }
+  for (int h = 0; h < 12; h++) {
+    for (int m = 0; m < 60; m++) {
+      inputs.push_back(h * 30.0f + m * 0.5f);
+    }
+  }
+
+  size_t mismatches = 0;
+  for (float x : inputs) {
+    mismatches += roundAngle(x) != reference::roundAngle(x);
+  }
+  report("roundAngle", "all", mismatches, inputs.size(), "");
+
+  volatile float sink = 0;
+  Timing t = timePair(
+    [&]() {
+      for (int r = 0; r < repeat * 100; r++) {
+        for (float x : inputs) {
+          sink = sink + reference::roundAngle(x);
+        }
+      }
+    },
+    [&]() {
+      for (int r = 0; r < repeat * 100; r++) {
+        for (float x : inputs) {
+          sink = sink + roundAngle(x);
+        }
+      }
+    }
+  );
+  printTiming("roundAngle", "all", inputs.size() * repeat * 100, t);
+}
+
+static std::vector<Pixel> uniquePixels(const Pixel* buf, int count) {
+  std::vector<Pixel> pixels(buf, buf + count);
+  auto less = [](const Pixel& a, const Pixel& b) { return a.y != b.y ? a.y < b.y : a.x < b.x; };
+  auto equal = [](const Pixel& a, const Pixel& b) { return a.x == b.x && a.y == b.y; };
+  std::sort(pixels.begin(), pixels.end(), less);
+  pixels.erase(std::unique(pixels.begin(), pixels.end(), equal), pixels.end());
+  return pixels;
+}
+
+static void benchCollectHandPixels(int repeat) {
+  static Pixel referenceBuf[COLLECT_BUF_SIZE];
+  static Pixel kernelBuf[COLLECT_BUF_SIZE];
+  std::vector<float> angles = handAngles();
+  const int lengths[] = { 50, 55, 93, 95 };
+
+  for (int length : lengths) {
+    for (int width = 1; width <= 8; width++) {
+      char config[32];
+      snprintf(config, sizeof(config), "len%d_w%d", length, width);
+
+      size_t mismatches = 0;
+      for (float angle : angles) {
+        int referenceCount = reference::collectHandPixels(angle, length, width, referenceBuf, COLLECT_BUF_SIZE, isClippedHub);
+        int kernelCount = collectHandPixels(angle, length, width, kernelBuf, COLLECT_BUF_SIZE, isClippedHub);
+        std::vector<Pixel> a = uniquePixels(referenceBuf, referenceCount);
+        std::vector<Pixel> b = uniquePixels(kernelBuf, kernelCount);
+        bool same = a.size() == b.size()
+          && std::equal(a.begin(), a.end(), b.begin(), [](const Pixel& p, const Pixel& q) { return p.x == q.x && p.y == q.y; });
+        mismatches += !same;
+      }
+      report("collectHandPixels", config, mismatches, angles.size(), "");
+
+      volatile int sink = 0;
+      Timing t = timePair(
+        [&]() {
+          for (int r = 0; r < repeat; r++) {
+            for (float angle : angles) {
+              sink = sink + reference::collectHandPixels(angle, length, width, referenceBuf, COLLECT_BUF_SIZE, isClippedHub);
+            }
+          }
+        },
+        [&]() {
+          for (int r = 0; r < repeat; r++) {
+            for (float angle : angles) {
+              sink = sink + collectHandPixels(angle, length, width, kernelBuf, COLLECT_BUF_SIZE, isClippedHub);
+            }
+          }
+        }
+      );
+      printTiming("collectHandPixels", config, angles.size() * repeat, t);
+    }
+  }
+}
+
+struct HandState {
+  Pixel pixels[HAND_BUF_MAX];
+  int count = 0;
+};
+
+static void benchDrawHandDiff(int repeat) {
+  std::vector<float> angles = handAngles();
+
+  for (const HandConfig& hand : HANDS) {
+    HandState referenceState;
+    HandState kernelState;
+    PanelPair panels;
+    size_t mismatches = 0;
+
+    // One full sweep as the clock moves, then once more to cover the wrap.
+    for (int pass = 0; pass < 2; pass++) {
+      for (float angle : angles) {
+        bool same = panels.step(
+          [&]() {
+            reference::drawHandDiff(
+              hand.length, hand.width, angle, referenceState.pixels, referenceState.count,
+              hand.bufSize, BENCH_HAND, BENCH_BACKGROUND, isClippedHub
+            );
+          },
+          [&]() {
+            drawHandDiff(
+              hand.length, hand.width, angle, kernelState.pixels, kernelState.count,
+              hand.bufSize, BENCH_HAND, BENCH_BACKGROUND, isClippedHub
+            );
+          }
+        );
+        mismatches += !same;
+      }
+    }
+    char detail[64];
+    snprintf(detail, sizeof(detail), ", up to %zu pixels", panels.worstDiff());
+    report("drawHandDiff", hand.name, mismatches, angles.size() * 2, detail);
+
+    HandState a;
+    HandState b;
+    Timing t = timePair(
+      [&]() {
+        for (int r = 0; r < repeat; r++) {
+          for (float angle : angles) {
+            reference::drawHandDiff(
+              hand.length, hand.width, angle, a.pixels, a.count,
+              hand.bufSize, BENCH_HAND, BENCH_BACKGROUND, isClippedHub
+            );
+          }
+        }
+      },
+      [&]() {
+        for (int r = 0; r < repeat; r++) {
+          for (float angle : angles) {
+            drawHandDiff(
+              hand.length, hand.width, angle, b.pixels, b.count,
+              hand.bufSize, BENCH_HAND, BENCH_BACKGROUND, isClippedHub
+            );
+          }
+        }
+      }
+    );
+    printTiming("drawHandDiff", hand.name, angles.size() * repeat, t);
+  }
+}
+
+static void benchDrawSingleArc(int repeat) {
+  std::vector<float> fractions = arcFractions();
+
+  for (const ArcConfig& arc : ARCS) {
+    PanelPair panels;
+    size_t mismatches = 0;
+    for (float fraction : fractions) {
+      bool same = panels.step(
+        [&]() { reference::drawSingleArc(fraction, arc.innerR, arc.outerR, ARC_STEP_DEG, BENCH_ARC, BENCH_TRACK); },
+        [&]() { drawSingleArc(fraction, arc.innerR, arc.outerR, ARC_STEP_DEG, BENCH_ARC, BENCH_TRACK); }
+      );
+      mismatches += !same;
+    }
+    char detail[64];
+    snprintf(detail, sizeof(detail), ", up to %zu pixels", panels.worstDiff());
+    report("drawSingleArc", arc.name, mismatches, fractions.size(), detail);
+
+    Timing t = timePair(
+      [&]() {
+        for (int r = 0; r < repeat; r++) {
+          for (float fraction : fractions) {
+            reference::drawSingleArc(fraction, arc.innerR, arc.outerR, ARC_STEP_DEG, BENCH_ARC, BENCH_TRACK);
+          }
+        }
+      },
+      [&]() {
+        for (int r = 0; r < repeat; r++) {
+          for (float fraction : fractions) {
+            drawSingleArc(fraction, arc.innerR, arc.outerR, ARC_STEP_DEG, BENCH_ARC, BENCH_TRACK);
+          }
+        }
+      }
+    );
+    printTiming("drawSingleArc", arc.name, fractions.size() * repeat, t);
+  }
+}
+
+struct CounterweightState {
+  bool valid = false;
+  int16_t x = 0;
+  int16_t y = 0;
+};
+
+static void benchDrawCounterweight(int repeat) {
+  std::vector<float> angles = hourAngles();
+  CounterweightState referenceState;
+  CounterweightState kernelState;
+  PanelPair panels;
+  size_t mismatches = 0;
+
+  for (int pass = 0; pass < 2; pass++) {
+    for (float angle : angles) {
+      bool same = panels.step(
+        [&]() {
+          reference::drawCounterweight(
+            angle, COUNTERWEIGHT_DIST, COUNTERWEIGHT_RADIUS, COUNTERWEIGHT_CLIP_R,
+            referenceState.valid, referenceState.x, referenceState.y,
+            BENCH_WEIGHT, BENCH_OUTLINE, BENCH_BACKGROUND
+          );
+        },
+        [&]() {
+          drawCounterweight(
+            angle, COUNTERWEIGHT_DIST, COUNTERWEIGHT_RADIUS, COUNTERWEIGHT_CLIP_R,
+            kernelState.valid, kernelState.x, kernelState.y,
+            BENCH_WEIGHT, BENCH_OUTLINE, BENCH_BACKGROUND
+          );
+        }
+      );
+      mismatches += !same;
+    }
+  }
+  char detail[64];
+  snprintf(detail, sizeof(detail), ", up to %zu pixels", panels.worstDiff());
+  report("drawCounterweight", "bauhaus", mismatches, angles.size() * 2, detail);
+
+  CounterweightState a;
+  CounterweightState b;
+  Timing t = timePair(
+    [&]() {
+      for (int r = 0; r < repeat; r++) {
+        for (float angle : angles) {
+          reference::drawCounterweight(
+            angle, COUNTERWEIGHT_DIST, COUNTERWEIGHT_RADIUS, COUNTERWEIGHT_CLIP_R,
+            a.valid, a.x, a.y, BENCH_WEIGHT, BENCH_OUTLINE, BENCH_BACKGROUND
+          );
+        }
+      }
+    },
+    [&]() {
+      for (int r = 0; r < repeat; r++) {
+        for (float angle : angles) {
+          drawCounterweight(
+            angle, COUNTERWEIGHT_DIST, COUNTERWEIGHT_RADIUS, COUNTERWEIGHT_CLIP_R,
+            b.valid, b.x, b.y, BENCH_WEIGHT, BENCH_OUTLINE, BENCH_BACKGROUND
+          );
+        }
+      }
+    }
+  );
+  printTiming("drawCounterweight", "bauhaus", angles.size() * repeat, t);
+}
+
+int main(int argc, char** argv) {
+  int repeat = 5;
+  if (argc > 1 && strcmp(argv[1], "--quick") == 0) {
+    repeat = 1;
+  }
+  else if (argc > 1) {
+    fprintf(stderr, "Usage: %s [--quick]\n", argv[0]);
+    return 2;
+  }
+
+  displaySetup();
+
+  printf(
+    "%-18s %-15s %7s %10s %10s %8s %12s %12s\n",
+    "kernel", "config", "calls", "ref_ns", "kernel_ns", "speedup", "ref_pixels", "kernel_pixels"
+  );
+  benchRoundAngle(repeat);
+  benchCollectHandPixels(repeat);
+  benchDrawHandDiff(repeat);
+  benchDrawSingleArc(repeat);
+  benchDrawCounterweight(repeat);
+
+  if (failures > 0) {
+    fprintf(stderr, "%d kernel configurations differ from the reference\n", failures);
+    return 1;
+  }
+  printf("All kernels match the reference pixel for pixel\n");
+  return 0;
+}
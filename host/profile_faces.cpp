@@ -0,0 +1,45 @@
+// Runs every clock face for ten minutes of second ticks the way the render
+// loop draws them and prints the render profile a RENDER_PROFILE firmware
+// would serve at /profile.
+//
+// Built against the firmware compiled with -DRENDER_PROFILE=1. Times are
+// host CPU time; calls, pixels and SPI bytes are the same as on the device.
+//
+// Usage: profile_faces
+
+#include <cstdio>
+#include <ctime>
+
+#include "app_state.h"
+#include "clock_face_factory.h"
+#include "display.h"
+#include "render_profile.h"
+
+static const int TICKS = 600;
+
+static void writeFile(const uint8_t* data, size_t length, void* context) {
+  fwrite(data, 1, length, (FILE*)context);
+}
+
+int main() {
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  displaySetup();
+
+  // 10:10 on 2026-03-19, the screenshot build default.
+  time_t when = 1773915000;
+  for (int i = 0; i < getFaceCount(); i++) {
+    ClockFace* face = getFaceAt(i);
+    face->reset();
+    for (int tick = 0; tick < TICKS; tick++) {
+      time_t now = when + tick;
+      DrawContext ctx = { CONNECTED_SYNCED, (tick & 1) != 0, {}, false };
+      localtime_r(&now, &ctx.timeinfo);
+      RENDER_PROFILE_FRAME(face->getId());
+      face->draw(ctx);
+    }
+  }
+
+  renderProfileWrite(writeFile, stdout);
+  return 0;
+}
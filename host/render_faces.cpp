@@ -0,0 +1,51 @@
+// Renders every clock face once through the firmware's redrawDisplay() into
+// the emulated panel, writes build/face_<id>.bmp and prints what the frame
+// cost on the emulated SPI bus.
+//
+// Usage: render_faces [output_dir]
+
+#include <cstdio>
+#include <string>
+
+#include "app_state.h"
+#include "clock_face_factory.h"
+#include "display.h"
+#include "host_image.h"
+
+int main(int argc, char** argv) {
+  std::string outDir = argc > 1 ? argv[1] : "build";
+
+  displaySetup();
+  setAppState(CONNECTED_SYNCED);
+
+  printf("%-14s %10s %10s %12s %14s\n", "face", "calls", "pixels", "spi_txns", "spi_bytes");
+  for (int i = 0; i < getFaceCount(); i++) {
+    ClockFace* face = getFaceAt(i);
+    face->reset();
+    setClockFace(face);
+
+    TFT_display.resetStats();
+    redrawDisplay();
+    const TftStats& stats = TFT_display.stats();
+
+    uint64_t calls = 0;
+    for (int call = 0; call < TFT_CALL_COUNT; call++) {
+      calls += stats.calls[call];
+    }
+    printf(
+      "%-14s %10llu %10llu %12llu %14llu\n",
+      face->getId(),
+      (unsigned long long)calls,
+      (unsigned long long)stats.pixels,
+      (unsigned long long)stats.spiTransactions,
+      (unsigned long long)stats.spiBytes
+    );
+
+    std::string path = outDir + "/face_" + face->getId() + ".bmp";
+    if (!writeBmp(path.c_str(), TFT_display.framebuffer(), SCREEN_WIDTH, SCREEN_HEIGHT)) {
+      fprintf(stderr, "Cannot write %s\n", path.c_str());
+      return 1;
+    }
+  }
+  return 0;
+}
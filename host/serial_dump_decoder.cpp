@@ -0,0 +1,132 @@
+#include "serial_dump_decoder.h"
+
+#include <algorithm>
+#include <zlib.h>
+
+static bool cobsDecode(const std::vector<uint8_t>& in, std::vector<uint8_t>& out) {
+  out.clear();
+  size_t pos = 0;
+  while (pos < in.size()) {
+    uint8_t code = in[pos++];
+    if (code == 0 || pos + code - 1 > in.size()) {
+      return false;
+    }
+    out.insert(out.end(), in.begin() + pos, in.begin() + pos + code - 1);
+    pos += code - 1;
+    if (code != 0xFF && pos < in.size()) {
+      out.push_back(0);
+    }
+  }
+  return true;
+}
+
+static uint16_t readLe16(const uint8_t* buf) {
+  return buf[0] | (buf[1] << 8);
+}
+
+static bool isText(const std::vector<uint8_t>& bytes) {
+  for (uint8_t c : bytes) {
+    if ((c < 0x20 || c > 0x7E) && c != '\r' && c != '\n' && c != '\t') {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SerialDumpDecoder::feed(const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    if (data[i] == 0) {
+      frameEnded();
+    }
+    else {
+      _frame.push_back(data[i]);
+    }
+  }
+}
+
+std::vector<int> SerialDumpDecoder::missingRows() const {
+  std::vector<int> rows;
+  for (int y = 0; y < _height; y++) {
+    if (!_received[y]) {
+      rows.push_back(y);
+    }
+  }
+  return rows;
+}
+
+void SerialDumpDecoder::frameEnded() {
+  if (_frame.empty()) {
+    return;
+  }
+  std::vector<uint8_t> packet;
+  if (cobsDecode(_frame, packet) && packet.size() >= 5) {
+    uint32_t expected = crc32(0, packet.data(), packet.size() - 4);
+    const uint8_t* tail = &packet[packet.size() - 4];
+    uint32_t actual = tail[0] | (tail[1] << 8) | (tail[2] << 16) | ((uint32_t)tail[3] << 24);
+    if (expected == actual) {
+      packet.resize(packet.size() - 4);
+      if (handlePacket(packet)) {
+        _packets++;
+      }
+      else {
+        _badPackets++;
+      }
+      _frame.clear();
+      return;
+    }
+  }
+
+  if (isText(_frame)) {
+    _text.append(_frame.begin(), _frame.end());
+  }
+  else {
+    _badPackets++;
+  }
+  _frame.clear();
+}
+
+bool SerialDumpDecoder::handlePacket(const std::vector<uint8_t>& packet) {
+  const uint8_t* p = packet.data();
+  size_t length = packet.size();
+  switch (p[0]) {
+    case 'H': {
+      if (length != 9) {
+        return false;
+      }
+      int width = readLe16(p + 1);
+      int height = readLe16(p + 3);
+      if (width != _width || height != _height) {
+        _width = width;
+        _height = height;
+        _pixels.assign((size_t)width * height, 0);
+        _received.assign(height, false);
+      }
+      _seq = p[5] | (p[6] << 8) | (p[7] << 16) | ((uint32_t)p[8] << 24);
+      return true;
+    }
+    case 'R': {
+      if (length < 3) {
+        return false;
+      }
+      int y = readLe16(p + 1);
+      if (y >= _height) {
+        return false;
+      }
+      std::vector<uint16_t> row;
+      for (size_t pos = 3; pos + 3 <= length; pos += 3) {
+        row.insert(row.end(), p[pos] + 1, readLe16(p + pos + 1));
+      }
+      if ((int)row.size() != _width || (length - 3) % 3 != 0) {
+        return false;
+      }
+      std::copy(row.begin(), row.end(), _pixels.begin() + (size_t)y * _width);
+      _received[y] = true;
+      return true;
+    }
+    case 'D':
+      _done = true;
+      return length == 3;
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,47 @@
+#ifndef SERIAL_DUMP_DECODER_H
+#define SERIAL_DUMP_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Reads the screenshot packets of SerialDumpEncoder (image_encoder.h) from a
+// raw serial byte stream. Bytes between packets are collected as text, so
+// log lines printed during a dump do not get lost. Rows survive between
+// dumps, which lets a reader fill in damaged rows with "strip" requests.
+class SerialDumpDecoder {
+public:
+  void feed(const uint8_t* data, size_t length);
+
+  // True once an end packet has arrived since the last call to restart().
+  bool done() const { return _done; }
+  void restart() { _done = false; }
+
+  int width() const { return _width; }
+  int height() const { return _height; }
+  uint32_t seq() const { return _seq; }
+  const std::vector<uint16_t>& pixels() const { return _pixels; }
+  std::vector<int> missingRows() const;
+
+  size_t packets() const { return _packets; }
+  size_t badPackets() const { return _badPackets; }
+  const std::string& text() const { return _text; }
+
+private:
+  std::vector<uint8_t> _frame;
+  std::vector<uint16_t> _pixels;
+  std::vector<bool> _received;
+  std::string _text;
+  int _width = 0;
+  int _height = 0;
+  uint32_t _seq = 0;
+  size_t _packets = 0;
+  size_t _badPackets = 0;
+  bool _done = false;
+
+  void frameEnded();
+  bool handlePacket(const std::vector<uint8_t>& packet);
+};
+
+#endif
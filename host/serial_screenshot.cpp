@@ -0,0 +1,200 @@
+// Takes a screenshot over the serial port with the firmware's "screenshot"
+// console command and writes it as a PNG. Works on units without WiFi.
+//
+// The clock answers "OK <baud>", switches to that rate, sends the frame as
+// CRC checked packets and switches back. Rows lost to noise or to log lines
+// printed in the middle of a packet are requested again strip by strip.
+// Log text received during the transfer is printed to stderr.
+//
+// Usage: serial_screenshot <port> [--baud rate] [--out file.png]
+//        serial_screenshot --decode <capture> [--out file.png]
+//
+// --decode reads a raw capture of the serial stream instead of a port.
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "host_image.h"
+#include "serial_dump_decoder.h"
+
+static const int SERIAL_BAUD = 115200;
+static const int DUMP_BAUD = 921600;
+static const int STRIP_HEIGHT = 16;
+static const int MAX_RETRIES = 3;
+static const int TIMEOUT_MS = 5000;
+
+static speed_t toSpeed(int baud) {
+  switch (baud) {
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    case 1000000: return B1000000;
+    case 2000000: return B2000000;
+    default: return 0;
+  }
+}
+
+static bool setBaud(int fd, int baud) {
+  termios tio;
+  if (tcgetattr(fd, &tio) != 0) {
+    return false;
+  }
+  cfmakeraw(&tio);
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 1;
+  cfsetispeed(&tio, toSpeed(baud));
+  cfsetospeed(&tio, toSpeed(baud));
+  return tcsetattr(fd, TCSADRAIN, &tio) == 0;
+}
+
+static long nowMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+// Reads text until a line starting with "OK" or "ERR" arrives.
+static bool waitForReply(int fd, int& baud) {
+  std::string line;
+  long deadline = nowMs() + TIMEOUT_MS;
+  while (nowMs() < deadline) {
+    char c;
+    if (read(fd, &c, 1) != 1) {
+      continue;
+    }
+    if (c != '\n') {
+      line += c;
+      continue;
+    }
+    if (line.compare(0, 3, "OK ") == 0) {
+      baud = atoi(line.c_str() + 3);
+      return true;
+    }
+    if (line.compare(0, 3, "ERR") == 0) {
+      fprintf(stderr, "Clock answered: %s\n", line.c_str());
+      return false;
+    }
+    line.clear();
+  }
+  fprintf(stderr, "No answer from the clock\n");
+  return false;
+}
+
+// Sends one command and reads its packets until the end packet.
+static bool request(int fd, const std::string& command, int baud, SerialDumpDecoder& decoder) {
+  setBaud(fd, SERIAL_BAUD);
+  tcflush(fd, TCIFLUSH);
+  std::string line = command + " " + std::to_string(baud) + "\n";
+  if (write(fd, line.data(), line.size()) != (ssize_t)line.size()) {
+    return false;
+  }
+  int replyBaud = 0;
+  if (!waitForReply(fd, replyBaud) || toSpeed(replyBaud) == 0) {
+    return false;
+  }
+  setBaud(fd, replyBaud);
+
+  decoder.restart();
+  uint8_t buf[4096];
+  long deadline = nowMs() + TIMEOUT_MS;
+  while (!decoder.done() && nowMs() < deadline) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n > 0) {
+      decoder.feed(buf, n);
+    }
+  }
+  setBaud(fd, SERIAL_BAUD);
+  return decoder.done();
+}
+
+int main(int argc, char** argv) {
+  const char* port = NULL;
+  const char* capture = NULL;
+  const char* out = "screenshot.png";
+  int baud = DUMP_BAUD;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--decode") == 0 && i + 1 < argc) {
+      capture = argv[++i];
+    }
+    else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      out = argv[++i];
+    }
+    else if (strcmp(argv[i], "--baud") == 0 && i + 1 < argc) {
+      baud = atoi(argv[++i]);
+    }
+    else if (argv[i][0] != '-' && port == NULL) {
+      port = argv[i];
+    }
+    else {
+      port = NULL;
+      capture = NULL;
+      break;
+    }
+  }
+  if ((port == NULL) == (capture == NULL) || toSpeed(baud) == 0) {
+    fprintf(stderr, "Usage: %s <port> [--baud rate] [--out file.png]\n", argv[0]);
+    fprintf(stderr, "       %s --decode <capture> [--out file.png]\n", argv[0]);
+    return 2;
+  }
+
+  SerialDumpDecoder decoder;
+  if (capture != NULL) {
+    FILE* f = fopen(capture, "rb");
+    if (f == NULL) {
+      fprintf(stderr, "Cannot open %s\n", capture);
+      return 1;
+    }
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+      decoder.feed(buf, n);
+    }
+    fclose(f);
+  }
+  else {
+    int fd = open(port, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+      fprintf(stderr, "Cannot open %s: %s\n", port, strerror(errno));
+      return 1;
+    }
+    long startMs = nowMs();
+    bool ok = request(fd, "screenshot", baud, decoder);
+    for (int retry = 0; ok && retry < MAX_RETRIES && !decoder.missingRows().empty(); retry++) {
+      int lastStrip = -1;
+      for (int row : decoder.missingRows()) {
+        if (row / STRIP_HEIGHT != lastStrip) {
+          lastStrip = row / STRIP_HEIGHT;
+          ok = ok && request(fd, "strip " + std::to_string(lastStrip), baud, decoder);
+        }
+      }
+    }
+    close(fd);
+    fprintf(stderr, "Transfer took %ldms\n", nowMs() - startMs);
+  }
+
+  if (!decoder.text().empty()) {
+    fprintf(stderr, "%s", decoder.text().c_str());
+  }
+  size_t missing = decoder.missingRows().size();
+  fprintf(stderr, "Frame %u: %zu packets, %zu damaged, %zu rows missing\n",
+    decoder.seq(), decoder.packets(), decoder.badPackets(), missing);
+  if (decoder.width() == 0 || missing > 0) {
+    return 1;
+  }
+  if (!writePng(out, decoder.pixels().data(), decoder.width(), decoder.height())) {
+    fprintf(stderr, "Cannot write %s\n", out);
+    return 1;
+  }
+  printf("Wrote %s\n", out);
+  return 0;
+}
@@ -0,0 +1,53 @@
+// Builds the firmware with -DDISABLE_SHADOW_FRAMEBUFFER=1 and draws every
+// face once. Checks that no shadow framebuffer is allocated or reported on
+// /metrics, and that screenshot strips are refused instead of read.
+//
+// Usage: shadow_off_check
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include "app_state.h"
+#include "clock_face_factory.h"
+#include "display.h"
+#include "metrics.h"
+
+static int errors = 0;
+
+static void expect(bool condition, const char* what) {
+  if (!condition) {
+    fprintf(stderr, "FAIL: %s\n", what);
+    errors++;
+  }
+}
+
+int main() {
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  displaySetup();
+
+  alignas(4) static uint16_t strip[SCREEN_WIDTH * SHADOW_STRIP_HEIGHT];
+
+  // 10:10 on 2026-03-19, the screenshot build default.
+  time_t when = 1773915000;
+  tm timeinfo;
+  localtime_r(&when, &timeinfo);
+
+  for (int i = 0; i < getFaceCount(); i++) {
+    ClockFace* face = getFaceAt(i);
+    face->reset();
+    DrawContext ctx = { CONNECTED_SYNCED, true, timeinfo, false };
+    face->draw(ctx);
+  }
+
+  expect(!TFT_display.hasShadow(), "no shadow framebuffer is allocated");
+  expect(!displayCopyShadowStrip(0, strip), "screenshot strips are refused");
+  expect(metricsGet(METRIC_SHADOW_FRAMEBUFFER_BYTES) == 0, "clock_shadow_framebuffer_bytes is 0");
+
+  if (errors > 0) {
+    return 1;
+  }
+  printf("shadow_off_check: %d faces drawn without a shadow framebuffer\n", getFaceCount());
+  return 0;
+}
@@ -0,0 +1,169 @@
+// Plays a render stall through the watchdog: the loop draws for a few
+// seconds, then the web server takes the display mutex and keeps it while
+// the loop waits for it. The web server started waiting first, so the loop
+// is still waiting after the web server got the mutex. Checks that the
+// watchdog notices within its timeout, that the snapshot names the holder
+// and the waiter and ends its
+// breadcrumbs with the last finished frame, that a fixed clock that is not
+// advanced is not taken for a stall, and that a simulated soft reset
+// reports the snapshot at boot.
+//
+// Usage: stall_check
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#include "app_state.h"
+#include "clock_source.h"
+#include "display.h"
+#include "esp_system.h"
+#include "face_manager.h"
+#include "frame_scheduler.h"
+#include "metrics.h"
+#include "render_watchdog.h"
+#include "timing_constants.h"
+#include "freertos/task.h"
+
+static const uint32_t STEP_MS = 50;
+static const uint32_t DRAW_MS = 3000;
+static const uint32_t HOLD_MS = 8000;
+
+static int errors = 0;
+
+static void appendString(const uint8_t* data, size_t length, void* context) {
+  ((std::string*)context)->append((const char*)data, length);
+}
+
+static std::string report() {
+  std::string text;
+  renderWatchdogWriteReport(appendString, &text);
+  return text;
+}
+
+static void expect(bool condition, const char* what) {
+  if (!condition) {
+    fprintf(stderr, "FAIL: %s\n", what);
+    errors++;
+  }
+}
+
+static void step(uint32_t& elapsedMs, bool& stalled) {
+  hostAdvanceMillis(STEP_MS);
+  clockSourceAdvanceMs(STEP_MS);
+  elapsedMs += STEP_MS;
+  if (elapsedMs % RENDER_WATCHDOG_CHECK_MS == 0) {
+    hostSetTask("RenderWatchdog", 0);
+    stalled = renderWatchdogCheck();
+  }
+}
+
+static void drawFor(FrameScheduler& scheduler, uint32_t& elapsedMs, uint32_t durationMs, bool& stalled, bool& everStalled) {
+  for (uint32_t end = elapsedMs + durationMs; elapsedMs < end;) {
+    hostSetTask("loopTask", 1);
+    if (frameSchedulerPoll(scheduler, clockSourceMillis(), getDisplayWallClockUs()) != FRAME_NONE) {
+      takeDisplayMutex();
+      redrawDisplay();
+      giveDisplayMutex();
+    }
+    faceManagerUpdate();
+    step(elapsedMs, stalled);
+    everStalled = everStalled || stalled;
+  }
+}
+
+int main() {
+  setenv("TZ", "UTC0", 1);
+  tzset();
+
+  renderWatchdogSetup();
+  expect(report() == "No render stall recorded.\n", "no stall reported on a clean boot");
+
+  displaySetup();
+  clockSourceSetFixed(1773915000LL * 1000000LL);
+  setConfiguredClockFace();
+  setAppState(CONNECTED_SYNCED);
+
+  FrameScheduler scheduler;
+  frameSchedulerInit(scheduler);
+  uint32_t elapsedMs = 0;
+  bool stalled = false;
+  bool everStalled = false;
+
+  drawFor(scheduler, elapsedMs, DRAW_MS, stalled, everStalled);
+  expect(!everStalled, "no stall while frames are drawn");
+
+  // The web server and then the loop wait for the mutex. The web server
+  // gets it and keeps it; the loop stays blocked in takeDisplayMutex().
+  hostSetTask("WebServer", 0);
+  renderWatchdogMutexWait();
+  hostSetTask("loopTask", 1);
+  uint32_t waitStartMs = renderWatchdogMutexWait();
+  hostSetTask("WebServer", 0);
+  takeDisplayMutex();
+
+  uint32_t holdStartMs = elapsedMs;
+  uint32_t noticedAfterMs = 0;
+  while (elapsedMs - holdStartMs < HOLD_MS) {
+    step(elapsedMs, stalled);
+    if (stalled && noticedAfterMs == 0) {
+      noticedAfterMs = elapsedMs - holdStartMs;
+    }
+  }
+  std::string stallReport = report();
+  printf("%s", stallReport.c_str());
+  expect(noticedAfterMs > 0, "stall noticed");
+  expect(noticedAfterMs <= RENDER_STALL_TIMEOUT_MS + RENDER_WATCHDOG_CHECK_MS, "stall noticed within the timeout and one check");
+  expect(stallReport.find("held by WebServer") != std::string::npos, "mutex holder named");
+  expect(stallReport.find("loopTask waiting") != std::string::npos, "waiter named");
+  expect(stallReport.rfind("frame_done\n") == stallReport.size() - strlen("frame_done\n"), "last breadcrumb is the last finished frame");
+  expect(metricsGet(METRIC_RENDER_STALLS) == 1, "one stall counted");
+
+  hostSetTask("WebServer", 0);
+  giveDisplayMutex();
+  hostSetTask("loopTask", 1);
+  renderWatchdogMutexTaken(waitStartMs);
+  redrawDisplay();
+  giveDisplayMutex();
+  everStalled = false;
+  drawFor(scheduler, elapsedMs, 2 * RENDER_WATCHDOG_CHECK_MS, stalled, everStalled);
+  expect(!stalled, "stall over once frames are drawn again");
+  expect(metricsGet(METRIC_RENDER_STALLS) == 1, "still one stall counted");
+
+  // A fixed clock that nobody advances starts no frames, and needs none.
+  bool frozenStalled = false;
+  for (uint32_t end = elapsedMs + HOLD_MS; elapsedMs < end;) {
+    hostSetTask("loopTask", 1);
+    if (frameSchedulerPoll(scheduler, clockSourceMillis(), getDisplayWallClockUs()) != FRAME_NONE) {
+      takeDisplayMutex();
+      redrawDisplay();
+      giveDisplayMutex();
+    }
+    hostAdvanceMillis(STEP_MS);
+    elapsedMs += STEP_MS;
+    if (elapsedMs % RENDER_WATCHDOG_CHECK_MS == 0) {
+      hostSetTask("RenderWatchdog", 0);
+      frozenStalled = frozenStalled || renderWatchdogCheck();
+    }
+  }
+  expect(!frozenStalled, "no stall while the fixed clock stands still");
+  expect(metricsGet(METRIC_RENDER_STALLS) == 1, "still one stall counted after the frozen clock");
+
+  // The RTC snapshot outlives the reset; the next boot reports and clears it.
+  hostSetResetReason(ESP_RST_TASK_WDT);
+  renderWatchdogSetup();
+  std::string bootReport = report();
+  expect(bootReport.find("before the reset (reset reason 6)") != std::string::npos, "snapshot reported after the reset");
+  expect(metricsGet(METRIC_RENDER_STALL_BEFORE_RESET_MS) >= RENDER_STALL_TIMEOUT_MS, "stall before the reset in the metrics");
+  metricsSet(METRIC_RENDER_STALL_BEFORE_RESET_MS, 0);
+  renderWatchdogSetup();
+  expect(metricsGet(METRIC_RENDER_STALL_BEFORE_RESET_MS) == 0, "snapshot cleared after it was reported");
+
+  printf("\nNoticed %lu ms after the mutex was taken.\n", (unsigned long)noticedAfterMs);
+  if (errors > 0) {
+    fprintf(stderr, "Render stall check failed\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,113 @@
+// Host stand-in for the Arduino core: just enough of the API for the
+// display and clock face sources to build and run on Linux.
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#define PI 3.1415926535897932384626433832795
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define INPUT_PULLUP 0x05
+
+typedef uint8_t byte;
+
+// Host memory has no RTC domain; a plain static keeps its value across a
+// simulated reset, as long as the tool does not exit.
+#define RTC_NOINIT_ATTR
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+int digitalRead(uint8_t pin);
+void pinMode(uint8_t pin, uint8_t mode);
+
+// The render profiler's cycle counter. The host counts nanoseconds of real
+// time, as if the CPU ran at 1000 MHz.
+uint32_t getCpuFrequencyMhz();
+
+class EspClass {
+public:
+  uint32_t getCycleCount();
+};
+
+extern EspClass ESP;
+
+// Host tools drive time explicitly; the clock only moves when told to.
+void hostSetMillis(unsigned long ms);
+void hostAdvanceMillis(unsigned long ms);
+
+class String {
+public:
+  String() {}
+  String(const char* s) : _s(s != nullptr ? s : "") {}
+  String(const std::string& s) : _s(s) {}
+  explicit String(int value) : _s(std::to_string(value)) {}
+
+  const char* c_str() const { return _s.c_str(); }
+  unsigned int length() const { return (unsigned int)_s.length(); }
+
+  String operator+(const String& other) const { return String(_s + other._s); }
+  String operator+(const char* other) const { return String(_s + other); }
+  friend String operator+(const char* lhs, const String& rhs) { return String(std::string(lhs) + rhs._s); }
+  bool operator==(const String& other) const { return _s == other._s; }
+
+private:
+  std::string _s;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+
+  size_t write(const char* s) {
+    size_t n = 0;
+    while (*s) {
+      n += write((uint8_t)*s++);
+    }
+    return n;
+  }
+
+  size_t write(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+      write(data[i]);
+    }
+    return length;
+  }
+
+  size_t print(const char* s) { return write(s); }
+  size_t print(const String& s) { return write(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value) { return printf("%d", value); }
+  size_t print(unsigned int value) { return printf("%u", value); }
+  size_t print(long value) { return printf("%ld", value); }
+  size_t print(unsigned long value) { return printf("%lu", value); }
+  size_t print(double value) { return printf("%.2f", value); }
+
+  size_t println() { return write((uint8_t)'\n'); }
+  template<typename T>
+  size_t println(T value) { size_t n = print(value); return n + println(); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  size_t write(uint8_t c) override;
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif
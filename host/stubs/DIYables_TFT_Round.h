@@ -0,0 +1,110 @@
+// Headless emulator of the DIYables_TFT_Round drawing API.
+//
+// Draws into a 240x240 RGB565 framebuffer instead of a GC9A01 panel and counts
+// what the real driver would do. Like the real library every primitive is
+// built on the virtual drawPixel(), so subclasses such as ShadowTFT see
+// the same calls as on the device.
+//
+// SPI cost model: drawPixel() is one transaction of CASET + RASET + RAMWR
+// commands with their arguments (11 bytes) plus 2 bytes of pixel data.
+// fillScreen() is one transaction with the window set once.
+#ifndef HOST_DIYABLES_TFT_ROUND_H
+#define HOST_DIYABLES_TFT_ROUND_H
+
+#include <cstdint>
+#include "Arduino.h"
+
+enum TftCall {
+  TFT_CALL_DRAW_PIXEL,
+  TFT_CALL_FILL_SCREEN,
+  TFT_CALL_DRAW_LINE,
+  TFT_CALL_DRAW_FAST_HLINE,
+  TFT_CALL_DRAW_FAST_VLINE,
+  TFT_CALL_DRAW_RECT,
+  TFT_CALL_FILL_RECT,
+  TFT_CALL_DRAW_CIRCLE,
+  TFT_CALL_FILL_CIRCLE,
+  TFT_CALL_DRAW_RGB_BITMAP,
+  TFT_CALL_WRITE_CHAR,
+  TFT_CALL_COUNT
+};
+
+struct TftStats {
+  uint64_t calls[TFT_CALL_COUNT];
+  uint64_t pixels;
+  uint64_t spiTransactions;
+  uint64_t spiBytes;
+};
+
+class DIYables_TFT : public Print {
+public:
+  static const int16_t EMU_WIDTH = 240;
+  static const int16_t EMU_HEIGHT = 240;
+  static const uint32_t SPI_WINDOW_BYTES = 11;
+
+  DIYables_TFT();
+  virtual ~DIYables_TFT() {}
+
+  static uint16_t colorRGB(uint8_t r, uint8_t g, uint8_t b) {
+    return (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+  }
+
+  void begin() {}
+  void setRotation(uint8_t rotation) { _rotation = rotation; }
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color);
+  virtual void fillScreen(uint16_t color);
+
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+  void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+  void drawRGBBitmap(int16_t x, int16_t y, const uint16_t* bitmap, int16_t w, int16_t h);
+
+  void setCursor(int16_t x, int16_t y) { _cursorX = x; _cursorY = y; }
+  void setTextSize(uint8_t size) { _textSize = size > 0 ? size : 1; }
+  void setTextColor(uint16_t color) { _textColor = color; _textBg = color; }
+  void setTextColor(uint16_t color, uint16_t bg) { _textColor = color; _textBg = bg; }
+  void setTextWrap(bool wrap) { _wrap = wrap; }
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  // Emulator only.
+  const uint16_t* framebuffer() const { return _framebuffer; }
+  void loadFramebuffer(const uint16_t* pixels);
+  uint16_t pixelAt(int16_t x, int16_t y) const { return _framebuffer[y * EMU_WIDTH + x]; }
+  const TftStats& stats() const { return _stats; }
+  void resetStats();
+
+protected:
+  void countCall(TftCall call) { _stats.calls[call]++; }
+
+private:
+  uint16_t _framebuffer[EMU_WIDTH * EMU_HEIGHT];
+  TftStats _stats;
+  uint8_t _rotation;
+  int16_t _cursorX;
+  int16_t _cursorY;
+  uint8_t _textSize;
+  uint16_t _textColor;
+  uint16_t _textBg;
+  bool _wrap;
+
+  void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size);
+  void fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t corners, int16_t delta, uint16_t color);
+};
+
+class DIYables_TFT_GC9A01_Round : public DIYables_TFT {
+public:
+  DIYables_TFT_GC9A01_Round(uint8_t resPin, uint8_t dcPin, uint8_t csPin) {
+    (void)resPin;
+    (void)dcPin;
+    (void)csPin;
+  }
+};
+
+#endif
@@ -0,0 +1,7 @@
+// Host stand-in: config.h only needs the header to exist.
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include "Arduino.h"
+
+#endif
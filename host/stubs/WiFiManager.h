@@ -0,0 +1,7 @@
+// Host stand-in: config.h only needs the header to exist.
+#ifndef HOST_WIFIMANAGER_H
+#define HOST_WIFIMANAGER_H
+
+#include "Arduino.h"
+
+#endif
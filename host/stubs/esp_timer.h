@@ -0,0 +1,9 @@
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <cstdint>
+
+// Microseconds since boot, following the simulated millis() clock.
+int64_t esp_timer_get_time();
+
+#endif
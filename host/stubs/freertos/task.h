@@ -0,0 +1,31 @@
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+void vTaskDelay(TickType_t ticks);
+void vTaskDelete(TaskHandle_t task);
+// The running task is the one set with hostSetTask(), loopTask by default.
+// Its handle stays valid for later hostSetTask() calls with the same name.
+TaskHandle_t xTaskGetCurrentTaskHandle();
+char* pcTaskGetName(TaskHandle_t task);
+
+// Lets a host tool act as another task, for code that records which task
+// and core it runs on.
+void hostSetTask(const char* name, BaseType_t core);
+
+// Tasks are not run on the host; host tools call the work functions directly.
+BaseType_t xTaskCreatePinnedToCore(
+  TaskFunction_t function,
+  const char* name,
+  uint32_t stackDepth,
+  void* parameter,
+  UBaseType_t priority,
+  TaskHandle_t* handle,
+  BaseType_t core
+);
+
+#endif
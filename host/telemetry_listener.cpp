@@ -0,0 +1,112 @@
+// Stands in for the fleet collector: listens for the statsd datagrams a
+// clock pushes after its NTP syncs (see telemetry.h) and prints them. Lines
+// are grouped by clock, with gauges, counter changes and events apart, so a
+// push can be checked by eye.
+//
+// Usage: telemetry_listener [--port n] [--count datagrams]
+//
+// Runs until interrupted, or until --count datagrams have arrived.
+
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static const int DEFAULT_PORT = 8125;
+
+// Prints one statsd line as "kind  clock  name  value  [tags]".
+static void printLine(const std::string& line) {
+  size_t colon = line.find(':');
+  size_t bar = line.find('|', colon);
+  if (colon == std::string::npos || bar == std::string::npos) {
+    printf("  ?        %s\n", line.c_str());
+    return;
+  }
+  std::string name = line.substr(0, colon);
+  std::string value = line.substr(colon + 1, bar - colon - 1);
+  std::string rest = line.substr(bar + 1);
+  const char* kind = rest.compare(0, 1, "g") == 0 ? "gauge" : "counter";
+  if (name.compare(0, 12, "clock.event.") == 0) {
+    kind = "event";
+  }
+
+  std::string tags;
+  std::string when;
+  size_t tagStart = rest.find("|#");
+  if (tagStart != std::string::npos) {
+    size_t tagEnd = rest.find('|', tagStart + 2);
+    tags = rest.substr(tagStart + 2, tagEnd == std::string::npos ? std::string::npos : tagEnd - tagStart - 2);
+  }
+  size_t timeStart = rest.find("|T");
+  if (timeStart != std::string::npos) {
+    time_t epoch = (time_t)strtoul(rest.c_str() + timeStart + 2, NULL, 10);
+    char buf[32];
+    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", gmtime(&epoch));
+    when = std::string(" at ") + buf + " UTC";
+  }
+  printf("  %-8s %-44s %12s  %s%s\n", kind, name.c_str(), value.c_str(), tags.c_str(), when.c_str());
+}
+
+int main(int argc, char** argv) {
+  int port = DEFAULT_PORT;
+  long count = -1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      port = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+      count = atol(argv[++i]);
+    }
+    else {
+      fprintf(stderr, "Usage: %s [--port n] [--count datagrams]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  if (sock < 0 || bind(sock, (sockaddr*)&address, sizeof(address)) != 0) {
+    perror("bind");
+    return 1;
+  }
+  printf("Listening for telemetry on UDP port %d\n", port);
+  fflush(stdout);
+
+  char datagram[65536];
+  for (long received = 0; count < 0 || received < count; received++) {
+    sockaddr_in from = {};
+    socklen_t fromLength = sizeof(from);
+    ssize_t length = recvfrom(sock, datagram, sizeof(datagram), 0, (sockaddr*)&from, &fromLength);
+    if (length < 0) {
+      perror("recvfrom");
+      return 1;
+    }
+    char sender[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &from.sin_addr, sender, sizeof(sender));
+    printf("%s: %zd bytes\n", sender, length);
+
+    std::string text(datagram, length);
+    size_t start = 0;
+    while (start < text.size()) {
+      size_t end = text.find('\n', start);
+      if (end == std::string::npos) {
+        end = text.size();
+      }
+      if (end > start) {
+        printLine(text.substr(start, end - start));
+      }
+      start = end + 1;
+    }
+    fflush(stdout);
+  }
+  close(sock);
+  return 0;
+}
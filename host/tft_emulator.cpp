@@ -0,0 +1,336 @@
+#include <cstring>
+#include <utility>
+#include "DIYables_TFT_Round.h"
+
+// Classic 5x7 GLCD font, printable ASCII only. One byte per column, LSB on top.
+static const uint8_t FONT_FIRST = 0x20;
+static const uint8_t FONT_LAST = 0x7E;
+static const uint8_t font5x7[][5] = {
+  {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+  {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+  {0x36, 0x49, 0x56, 0x20, 0x50}, {0x00, 0x08, 0x07, 0x03, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+  {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x2A, 0x1C, 0x7F, 0x1C, 0x2A}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+  {0x00, 0x80, 0x70, 0x30, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x00, 0x60, 0x60, 0x00},
+  {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+  {0x72, 0x49, 0x49, 0x49, 0x46}, {0x21, 0x41, 0x49, 0x4D, 0x33}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+  {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x31}, {0x41, 0x21, 0x11, 0x09, 0x07},
+  {0x36, 0x49, 0x49, 0x49, 0x36}, {0x46, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x00, 0x14, 0x00, 0x00},
+  {0x00, 0x40, 0x34, 0x00, 0x00}, {0x00, 0x08, 0x14, 0x22, 0x41}, {0x14, 0x14, 0x14, 0x14, 0x14},
+  {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x59, 0x09, 0x06}, {0x3E, 0x41, 0x5D, 0x59, 0x4E},
+  {0x7C, 0x12, 0x11, 0x12, 0x7C}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+  {0x7F, 0x41, 0x41, 0x41, 0x3E}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01},
+  {0x3E, 0x41, 0x41, 0x51, 0x73}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+  {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+  {0x7F, 0x02, 0x1C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+  {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+  {0x26, 0x49, 0x49, 0x49, 0x32}, {0x03, 0x01, 0x7F, 0x01, 0x03}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+  {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+  {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x59, 0x49, 0x4D, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x41},
+  {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x41, 0x7F}, {0x04, 0x02, 0x01, 0x02, 0x04},
+  {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x03, 0x07, 0x08, 0x00}, {0x20, 0x54, 0x54, 0x78, 0x40},
+  {0x7F, 0x28, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x28}, {0x38, 0x44, 0x44, 0x28, 0x7F},
+  {0x38, 0x54, 0x54, 0x54, 0x18}, {0x00, 0x08, 0x7E, 0x09, 0x02}, {0x18, 0xA4, 0xA4, 0x9C, 0x78},
+  {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x40, 0x3D, 0x00},
+  {0x7F, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x78, 0x04, 0x78},
+  {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0xFC, 0x18, 0x24, 0x24, 0x18},
+  {0x18, 0x24, 0x24, 0x18, 0xFC}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x24},
+  {0x04, 0x04, 0x3F, 0x44, 0x24}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+  {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x4C, 0x90, 0x90, 0x90, 0x7C},
+  {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x77, 0x00, 0x00},
+  {0x00, 0x41, 0x36, 0x08, 0x00}, {0x02, 0x01, 0x02, 0x04, 0x02},
+};
+
+// Only calls made by the firmware are counted, not the ones primitives make
+// internally while drawing.
+static int callDepth = 0;
+
+struct CallScope {
+  CallScope() { callDepth++; }
+  ~CallScope() { callDepth--; }
+};
+
+DIYables_TFT::DIYables_TFT()
+  : _rotation(0),
+    _cursorX(0),
+    _cursorY(0),
+    _textSize(1),
+    _textColor(0xFFFF),
+    _textBg(0xFFFF),
+    _wrap(true) {
+  memset(_framebuffer, 0, sizeof(_framebuffer));
+  resetStats();
+}
+
+void DIYables_TFT::resetStats() {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void DIYables_TFT::loadFramebuffer(const uint16_t* pixels) {
+  memcpy(_framebuffer, pixels, sizeof(_framebuffer));
+}
+
+void DIYables_TFT::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (callDepth == 0) {
+    countCall(TFT_CALL_DRAW_PIXEL);
+  }
+  if (x < 0 || y < 0 || x >= EMU_WIDTH || y >= EMU_HEIGHT) {
+    return;
+  }
+  _framebuffer[y * EMU_WIDTH + x] = color;
+  _stats.pixels++;
+  _stats.spiTransactions++;
+  _stats.spiBytes += SPI_WINDOW_BYTES + 2;
+}
+
+void DIYables_TFT::fillScreen(uint16_t color) {
+  if (callDepth == 0) {
+    countCall(TFT_CALL_FILL_SCREEN);
+  }
+  for (int i = 0; i < EMU_WIDTH * EMU_HEIGHT; i++) {
+    _framebuffer[i] = color;
+  }
+  _stats.pixels += EMU_WIDTH * EMU_HEIGHT;
+  _stats.spiTransactions++;
+  _stats.spiBytes += SPI_WINDOW_BYTES + (uint64_t)EMU_WIDTH * EMU_HEIGHT * 2;
+}
+
+void DIYables_TFT::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+  if (callDepth == 0) {
+    countCall(TFT_CALL_DRAW_LINE);
+  }
+  CallScope scope;
+
+  bool steep = abs(y1 - y0) > abs(x1 - x0);
+  if (steep) {
+    std::swap(x0, y0);
+    std::swap(x1, y1);
+  }
+  if (x0 > x1) {
+    std::swap(x0, x1);
+    std::swap(y0, y1);
+  }
+
+  int16_t dx = x1 - x0;
+  int16_t dy = abs(y1 - y0);
+  int16_t err = dx / 2;
+  int16_t ystep = y0 < y1 ? 1 : -1;
+
+  for (; x0 <= x1; x0++) {
+    if (steep) {
+      drawPixel(y0, x0, color);
+    }
+    else {
+      drawPixel(x0, y0, color);
+    }
+    err -= dy;
+    if (err < 0) {
+      y0 += ystep;
+      err += dx;
+    }
+  }
+}
+
+void DIYables_TFT::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  if (callDepth == 0) {
+    countCall(TFT_CALL_DRAW_FAST_HLINE);
+  }
+  CallScope scope;
+  for (int16_t i = 0; i < w; i++) {
+    drawPixel(x + i, y, color);
+  }
+}
+
+void DIYables_TFT::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  if (callDepth == 0) {
+    countCall(TFT_CALL_DRAW_FAST_VLINE);
+  }
+  CallScope scope;
+  for (int16_t i = 0; i < h; i++) {
+    drawPixel(x, y + i, color);
+  }
+}
+
+void DIYables_TFT::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  if (callDepth == 0) {
+    countCall(TFT_CALL_DRAW_RECT);
+  }
+  CallScope scope;
+  drawFastHLine(x, y, w, color);
+  drawFastHLine(x, y + h - 1, w, color);
+  drawFastVLine(x, y, h, color);
+  drawFastVLine(x + w - 1, y, h, color);
+}
+
+void DIYables_TFT::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  if (callDepth == 0) {
+    countCall(TFT_CALL_FILL_RECT);
+  }
+  CallScope scope;
+  for (int16_t j = 0; j < h; j++) {
+    for (int16_t i = 0; i < w; i++) {
+      drawPixel(x + i, y + j, color);
+    }
+  }
+}
+
+void DIYables_TFT::drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+  if (callDepth == 0) {
+    countCall(TFT_CALL_DRAW_CIRCLE);
+  }
+  CallScope scope;
+
+  int16_t f = 1 - r;
+  int16_t ddF_x = 1;
+  int16_t ddF_y = -2 * r;
+  int16_t x = 0;
+  int16_t y = r;
+
+  drawPixel(x0, y0 + r, color);
+  drawPixel(x0, y0 - r, color);
+  drawPixel(x0 + r, y0, color);
+  drawPixel(x0 - r, y0, color);
+
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+
+    drawPixel(x0 + x, y0 + y, color);
+    drawPixel(x0 - x, y0 + y, color);
+    drawPixel(x0 + x, y0 - y, color);
+    drawPixel(x0 - x, y0 - y, color);
+    drawPixel(x0 + y, y0 + x, color);
+    drawPixel(x0 - y, y0 + x, color);
+    drawPixel(x0 + y, y0 - x, color);
+    drawPixel(x0 - y, y0 - x, color);
+  }
+}
+
+void DIYables_TFT::fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+  if (callDepth == 0) {
+    countCall(TFT_CALL_FILL_CIRCLE);
+  }
+  CallScope scope;
+  drawFastVLine(x0, y0 - r, 2 * r + 1, color);
+  fillCircleHelper(x0, y0, r, 3, 0, color);
+}
+
+void DIYables_TFT::fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t corners, int16_t delta, uint16_t color) {
+  int16_t f = 1 - r;
+  int16_t ddF_x = 1;
+  int16_t ddF_y = -2 * r;
+  int16_t x = 0;
+  int16_t y = r;
+  int16_t px = x;
+  int16_t py = y;
+
+  delta++;
+
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+    if (x < (y + 1)) {
+      if (corners & 1) {
+        drawFastVLine(x0 + x, y0 - y, 2 * y + delta, color);
+      }
+      if (corners & 2) {
+        drawFastVLine(x0 - x, y0 - y, 2 * y + delta, color);
+      }
+    }
+    if (y != py) {
+      if (corners & 1) {
+        drawFastVLine(x0 + py, y0 - px, 2 * px + delta, color);
+      }
+      if (corners & 2) {
+        drawFastVLine(x0 - py, y0 - px, 2 * px + delta, color);
+      }
+      py = y;
+    }
+    px = x;
+  }
+}
+
+void DIYables_TFT::drawRGBBitmap(int16_t x, int16_t y, const uint16_t* bitmap, int16_t w, int16_t h) {
+  if (callDepth == 0) {
+    countCall(TFT_CALL_DRAW_RGB_BITMAP);
+  }
+  CallScope scope;
+  for (int16_t j = 0; j < h; j++) {
+    for (int16_t i = 0; i < w; i++) {
+      drawPixel(x + i, y + j, bitmap[j * w + i]);
+    }
+  }
+}
+
+size_t DIYables_TFT::write(uint8_t c) {
+  if (callDepth == 0) {
+    countCall(TFT_CALL_WRITE_CHAR);
+  }
+  CallScope scope;
+
+  if (c == '\n') {
+    _cursorX = 0;
+    _cursorY += _textSize * 8;
+    return 1;
+  }
+  if (c == '\r') {
+    return 1;
+  }
+  if (_wrap && (_cursorX + _textSize * 6) > EMU_WIDTH) {
+    _cursorX = 0;
+    _cursorY += _textSize * 8;
+  }
+  drawChar(_cursorX, _cursorY, c, _textColor, _textBg, _textSize);
+  _cursorX += _textSize * 6;
+  return 1;
+}
+
+void DIYables_TFT::drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size) {
+  const uint8_t* glyph = font5x7[0];
+  if (c >= FONT_FIRST && c <= FONT_LAST) {
+    glyph = font5x7[c - FONT_FIRST];
+  }
+
+  for (int8_t i = 0; i < 5; i++) {
+    uint8_t line = glyph[i];
+    for (int8_t j = 0; j < 8; j++, line >>= 1) {
+      if (line & 1) {
+        if (size == 1) {
+          drawPixel(x + i, y + j, color);
+        }
+        else {
+          fillRect(x + i * size, y + j * size, size, size, color);
+        }
+      }
+      else if (bg != color) {
+        if (size == 1) {
+          drawPixel(x + i, y + j, bg);
+        }
+        else {
+          fillRect(x + i * size, y + j * size, size, size, bg);
+        }
+      }
+    }
+  }
+
+  // Spacing column.
+  if (bg != color) {
+    if (size == 1) {
+      drawFastVLine(x + 5, y, 8, bg);
+    }
+    else {
+      fillRect(x + 5 * size, y, size, 8 * size, bg);
+    }
+  }
+}
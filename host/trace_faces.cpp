@@ -0,0 +1,63 @@
+// Records a display trace the way a DISPLAY_TRACE firmware does: every face
+// runs for two minutes of second ticks from a clear screen, one trace frame
+// per tick. Writes the trace and the final panel contents, so trace_replay
+// can be checked against what was actually drawn.
+//
+// Built against the firmware compiled with -DDISPLAY_TRACE=1 and linked
+// without PIE, so the call sites in the trace resolve with
+//   addr2line -f -C -e build/trace_faces <address>
+//
+// Usage: trace_faces [output_dir]
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+
+#include "app_state.h"
+#include "clock_face_factory.h"
+#include "display.h"
+#include "display_trace.h"
+#include "host_image.h"
+
+static const int TICKS = 120;
+
+static void writeFile(const uint8_t* data, size_t length, void* context) {
+  fwrite(data, 1, length, (FILE*)context);
+}
+
+int main(int argc, char** argv) {
+  std::string outDir = argc > 1 ? argv[1] : "build";
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  displaySetup();
+
+  // 10:10 on 2026-03-19, the screenshot build default.
+  time_t when = 1773915000;
+  for (int i = 0; i < getFaceCount(); i++) {
+    ClockFace* face = getFaceAt(i);
+    face->reset();
+    TFT_display.fillScreen(COLOR_BACKGROUND);
+    for (int tick = 0; tick < TICKS; tick++) {
+      displayTraceFrame();
+      time_t now = when + tick;
+      DrawContext ctx = { CONNECTED_SYNCED, (tick & 1) != 0, {}, false };
+      localtime_r(&now, &ctx.timeinfo);
+      face->draw(ctx);
+    }
+  }
+
+  std::string tracePath = outDir + "/faces.trace";
+  FILE* f = fopen(tracePath.c_str(), "wb");
+  if (f == NULL) {
+    fprintf(stderr, "Cannot write %s\n", tracePath.c_str());
+    return 1;
+  }
+  displayTraceWrite(writeFile, f);
+  long size = ftell(f);
+  fclose(f);
+
+  std::string framePath = outDir + "/faces_trace_last.png";
+  writePng(framePath.c_str(), TFT_display.framebuffer(), SCREEN_WIDTH, SCREEN_HEIGHT);
+  printf("Wrote %s (%ld bytes) and %s\n", tracePath.c_str(), size, framePath.c_str());
+  return 0;
+}
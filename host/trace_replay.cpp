@@ -0,0 +1,289 @@
+// Replays a display trace from a DISPLAY_TRACE firmware (served at /trace)
+// or from trace_faces on the emulated panel.
+//
+// Writes the replayed image, an overdraw heat map of how often each pixel
+// was written, and prints the call sites that cost the most SPI traffic per
+// frame. Call sites are return addresses; resolve them with addr2line
+// against the firmware ELF (or build/trace_faces for host traces).
+//
+// A trace from a full ring starts in the middle of the history, so the
+// image only shows what was drawn within the trace.
+//
+// Usage: trace_replay <file.trace> [--out prefix] [--top n] [--expect file.png]
+//
+// --expect fails the run unless the replayed image matches the PNG.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DIYables_TFT_Round.h"
+#include "display_trace.h"
+#include "host_image.h"
+#include "icons.h"
+
+static const char* OP_NAMES[TRACE_OP_COUNT] = {
+  "frame",
+  "drawPixel",
+  "fillScreen",
+  "drawLine",
+  "drawRect",
+  "fillRect",
+  "drawCircle",
+  "fillCircle",
+  "drawRGBBitmap",
+  "setCursor",
+  "setTextSize",
+  "setTextColor",
+  "print",
+};
+
+// The firmware's bitmaps, found again by the hash the trace stores.
+struct KnownBitmap {
+  const uint16_t* pixels;
+  int count;
+};
+
+static const KnownBitmap BITMAPS[] = {
+  { IconWifiBitmap, (int)(sizeof(IconWifiBitmap) / sizeof(uint16_t)) },
+  { IconWifiOffBitmap, (int)(sizeof(IconWifiOffBitmap) / sizeof(uint16_t)) },
+  { IconSyncBitmap, (int)(sizeof(IconSyncBitmap) / sizeof(uint16_t)) },
+};
+
+// Counts every pixel write for the overdraw map.
+class ReplayPanel : public DIYables_TFT_GC9A01_Round {
+public:
+  ReplayPanel() : DIYables_TFT_GC9A01_Round(0, 0, 0), writes(EMU_WIDTH * EMU_HEIGHT, 0) {}
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+    DIYables_TFT_GC9A01_Round::drawPixel(x, y, color);
+    if (x >= 0 && x < EMU_WIDTH && y >= 0 && y < EMU_HEIGHT) {
+      writes[y * EMU_WIDTH + x]++;
+    }
+  }
+
+  void fillScreen(uint16_t color) override {
+    DIYables_TFT_GC9A01_Round::fillScreen(color);
+    for (uint32_t& w : writes) {
+      w++;
+    }
+  }
+
+  std::vector<uint32_t> writes;
+};
+
+struct SiteCost {
+  uint32_t caller;
+  uint8_t op;
+  uint64_t calls;
+  uint64_t pixels;
+  uint64_t spiBytes;
+  uint64_t deviceUs;
+};
+
+static bool readTrace(const char* path, std::vector<DisplayTraceRecord>& records) {
+  FILE* f = fopen(path, "rb");
+  if (f == NULL) {
+    return false;
+  }
+  DisplayTraceHeader header;
+  bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+    memcmp(header.magic, DISPLAY_TRACE_MAGIC, sizeof(header.magic)) == 0 &&
+    header.version == DISPLAY_TRACE_VERSION &&
+    header.recordSize == sizeof(DisplayTraceRecord);
+  if (ok) {
+    records.resize(header.count);
+    ok = fread(records.data(), sizeof(DisplayTraceRecord), header.count, f) == header.count;
+  }
+  fclose(f);
+  return ok;
+}
+
+static void replay(ReplayPanel& panel, const DisplayTraceRecord& r) {
+  int16_t a[4];
+  memcpy(a, r.args, sizeof(a));
+  switch (r.op) {
+    case TRACE_DRAW_PIXEL:      panel.drawPixel(a[0], a[1], r.value); break;
+    case TRACE_FILL_SCREEN:     panel.fillScreen(r.value); break;
+    case TRACE_DRAW_LINE:       panel.drawLine(a[0], a[1], a[2], a[3], r.value); break;
+    case TRACE_DRAW_RECT:       panel.drawRect(a[0], a[1], a[2], a[3], r.value); break;
+    case TRACE_FILL_RECT:       panel.fillRect(a[0], a[1], a[2], a[3], r.value); break;
+    case TRACE_DRAW_CIRCLE:     panel.drawCircle(a[0], a[1], a[2], r.value); break;
+    case TRACE_FILL_CIRCLE:     panel.fillCircle(a[0], a[1], a[2], r.value); break;
+    case TRACE_SET_CURSOR:      panel.setCursor(a[0], a[1]); break;
+    case TRACE_SET_TEXT_SIZE:   panel.setTextSize(r.value); break;
+    case TRACE_SET_TEXT_COLOR:  panel.setTextColor(r.value & 0xFFFF, r.value >> 16); break;
+    case TRACE_WRITE_CHAR:      panel.write((uint8_t)r.value); break;
+    case TRACE_DRAW_RGB_BITMAP: {
+      for (const KnownBitmap& b : BITMAPS) {
+        if (b.count == a[2] * a[3] && displayTraceBitmapHash(b.pixels, b.count) == r.value) {
+          panel.drawRGBBitmap(a[0], a[1], b.pixels, a[2], a[3]);
+          return;
+        }
+      }
+      // Not one of the firmware's icons: mark the area instead.
+      panel.fillRect(a[0], a[1], a[2], a[3], DIYables_TFT::colorRGB(255, 0, 255));
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+// Black where nothing was written, through red and yellow to white at the
+// most written pixel.
+static void writeOverdraw(const std::string& path, const std::vector<uint32_t>& writes) {
+  uint32_t peak = std::max<uint32_t>(1, *std::max_element(writes.begin(), writes.end()));
+  std::vector<uint8_t> rgb(writes.size() * 3, 0);
+  for (size_t i = 0; i < writes.size(); i++) {
+    if (writes[i] == 0) {
+      continue;
+    }
+    int level = 64 + (int)((uint64_t)writes[i] * 704 / peak);
+    rgb[i * 3] = (uint8_t)std::min(level, 255);
+    rgb[i * 3 + 1] = (uint8_t)std::min(std::max(level - 256, 0), 255);
+    rgb[i * 3 + 2] = (uint8_t)std::min(std::max(level - 512, 0), 255);
+  }
+  writePngRgb(path.c_str(), rgb.data(), DIYables_TFT::EMU_WIDTH, DIYables_TFT::EMU_HEIGHT);
+}
+
+int main(int argc, char** argv) {
+  const char* tracePath = NULL;
+  std::string outPrefix = "build/trace";
+  const char* expectPath = NULL;
+  size_t top = 15;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      outPrefix = argv[++i];
+    }
+    else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+      top = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--expect") == 0 && i + 1 < argc) {
+      expectPath = argv[++i];
+    }
+    else if (argv[i][0] != '-' && tracePath == NULL) {
+      tracePath = argv[i];
+    }
+    else {
+      tracePath = NULL;
+      break;
+    }
+  }
+  if (tracePath == NULL) {
+    fprintf(stderr, "Usage: %s <file.trace> [--out prefix] [--top n] [--expect file.png]\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<DisplayTraceRecord> records;
+  if (!readTrace(tracePath, records)) {
+    fprintf(stderr, "%s is not a display trace\n", tracePath);
+    return 1;
+  }
+
+  static ReplayPanel panel;
+  std::map<std::pair<uint32_t, uint8_t>, SiteCost> sites;
+  SiteCost total = {};
+  uint64_t frames = 0;
+  for (const DisplayTraceRecord& r : records) {
+    if (r.op == TRACE_FRAME) {
+      frames++;
+      continue;
+    }
+    if (r.op >= TRACE_OP_COUNT) {
+      continue;
+    }
+    TftStats before = panel.stats();
+    replay(panel, r);
+    const TftStats& after = panel.stats();
+
+    SiteCost& site = sites[std::make_pair(r.caller, r.op)];
+    site.caller = r.caller;
+    site.op = r.op;
+    site.calls++;
+    site.pixels += after.pixels - before.pixels;
+    site.spiBytes += after.spiBytes - before.spiBytes;
+    site.deviceUs += r.durationUs;
+    total.calls++;
+    total.pixels += after.pixels - before.pixels;
+    total.spiBytes += after.spiBytes - before.spiBytes;
+    total.deviceUs += r.durationUs;
+  }
+  frames = std::max<uint64_t>(frames, 1);
+
+  std::vector<SiteCost> ranked;
+  for (const auto& entry : sites) {
+    ranked.push_back(entry.second);
+  }
+  std::sort(ranked.begin(), ranked.end(), [](const SiteCost& a, const SiteCost& b) {
+    return a.spiBytes > b.spiBytes;
+  });
+
+  uint64_t written = 0;
+  uint64_t distinct = 0;
+  for (uint32_t w : panel.writes) {
+    written += w;
+    distinct += w > 0;
+  }
+  printf("%zu records, %llu frames, %llu pixel writes to %llu pixels (%.2fx overdraw)\n",
+    records.size(),
+    (unsigned long long)frames,
+    (unsigned long long)written,
+    (unsigned long long)distinct,
+    distinct > 0 ? (double)written / distinct : 0.0);
+  printf("\nPer frame, by SPI bytes:\n");
+  printf("%-12s %-14s %10s %10s %12s %10s %7s\n", "call_site", "call", "calls", "pixels", "spi_bytes", "device_us", "share");
+  for (size_t i = 0; i < ranked.size() && i < top; i++) {
+    const SiteCost& s = ranked[i];
+    printf(
+      "0x%08x   %-14s %10.1f %10.1f %12.1f %10.1f %6.1f%%\n",
+      s.caller,
+      OP_NAMES[s.op],
+      (double)s.calls / frames,
+      (double)s.pixels / frames,
+      (double)s.spiBytes / frames,
+      (double)s.deviceUs / frames,
+      total.spiBytes > 0 ? 100.0 * s.spiBytes / total.spiBytes : 0.0
+    );
+  }
+  printf(
+    "%-12s %-14s %10.1f %10.1f %12.1f %10.1f\n",
+    "total", "",
+    (double)total.calls / frames,
+    (double)total.pixels / frames,
+    (double)total.spiBytes / frames,
+    (double)total.deviceUs / frames
+  );
+
+  writePng((outPrefix + ".png").c_str(), panel.framebuffer(), DIYables_TFT::EMU_WIDTH, DIYables_TFT::EMU_HEIGHT);
+  writeOverdraw(outPrefix + "_overdraw.png", panel.writes);
+  printf("\nWrote %s.png and %s_overdraw.png\n", outPrefix.c_str(), outPrefix.c_str());
+
+  if (expectPath != NULL) {
+    std::vector<uint8_t> expected;
+    int width = 0;
+    int height = 0;
+    if (!readPng(expectPath, expected, width, height) || width != DIYables_TFT::EMU_WIDTH || height != DIYables_TFT::EMU_HEIGHT) {
+      fprintf(stderr, "Cannot read %s\n", expectPath);
+      return 1;
+    }
+    size_t differing = 0;
+    for (size_t i = 0; i < panel.writes.size(); i++) {
+      uint8_t rgb[3];
+      rgb565ToRgb888(panel.framebuffer()[i], rgb);
+      differing += memcmp(rgb, &expected[i * 3], 3) != 0;
+    }
+    if (differing > 0) {
+      fprintf(stderr, "Replayed image differs from %s in %zu pixels\n", expectPath, differing);
+      return 1;
+    }
+    printf("Replayed image matches %s\n", expectPath);
+  }
+  return 0;
+}
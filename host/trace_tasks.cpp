@@ -0,0 +1,212 @@
+// Runs 90 seconds of the render loop with the task trace compiled in and
+// writes the ring as build/tasks.json, the file /tasks would serve. The
+// other tasks are played by switching the task the stubs report: the NTP
+// task syncs twice on core 0 while the loop keeps drawing, and the web
+// server copies the shadow framebuffer strip by strip once. The ring wraps
+// during the run, so the oldest frames are gone. Open the file in
+// https://ui.perfetto.dev or chrome://tracing.
+//
+// Fails when the JSON has an end before its begin on a task, a span left
+// open, time running backwards on a task or a task without its name.
+//
+// Usage: trace_tasks [build dir]
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "app_state.h"
+#include "clock_source.h"
+#include "config.h"
+#include "display.h"
+#include "face_manager.h"
+#include "frame_scheduler.h"
+#include "task_trace.h"
+#include "freertos/task.h"
+
+static const uint32_t STEP_MS = 50;
+static const uint32_t RUN_MS = 90UL * 1000UL;
+// All after the first half minute, which the ring has forgotten by the end.
+static const uint32_t NTP_FIRST_MS = 45UL * 1000UL;
+static const uint32_t NTP_INTERVAL_MS = 25UL * 1000UL;
+static const uint32_t NTP_SYNC_MS = 400;
+static const uint32_t ROTATION_AT_MS = 55UL * 1000UL;
+static const uint32_t SCREENSHOT_AT_MS = 65UL * 1000UL;
+
+struct SpanStats {
+  int count;
+  long long maxUs;
+};
+
+static void appendString(const uint8_t* data, size_t length, void* context) {
+  ((std::string*)context)->append((const char*)data, length);
+}
+
+static void runLoop(FrameScheduler& scheduler) {
+  hostSetTask("loopTask", 1);
+  FrameReason reason = frameSchedulerPoll(scheduler, clockSourceMillis(), getDisplayWallClockUs());
+  if (reason != FRAME_NONE || consumeAppStateChange()) {
+    takeDisplayMutex();
+    redrawDisplay();
+    giveDisplayMutex();
+  }
+  faceManagerUpdate();
+}
+
+int main(int argc, char** argv) {
+  std::string buildDir = argc > 1 ? argv[1] : "build";
+  setenv("TZ", "UTC0", 1);
+  tzset();
+
+  taskTraceSetup();
+  displaySetup();
+  clockSourceSetFixed(1773915000LL * 1000000LL);
+  setConfiguredClockFace();
+  setAppState(CONNECTED_SYNCED);
+
+  FrameScheduler scheduler;
+  frameSchedulerInit(scheduler);
+  static uint16_t strip[SCREEN_WIDTH * SHADOW_STRIP_HEIGHT];
+  uint32_t syncEndMs = 0;
+
+  for (uint32_t elapsedMs = 0; elapsedMs < RUN_MS; elapsedMs += STEP_MS) {
+    // The trace is stamped with esp_timer, the frames with the clock source.
+    hostAdvanceMillis(STEP_MS);
+    clockSourceAdvanceMs(STEP_MS);
+
+    if (elapsedMs >= NTP_FIRST_MS && (elapsedMs - NTP_FIRST_MS) % NTP_INTERVAL_MS == 0) {
+      hostSetTask("NtpTask", 0);
+      taskTraceBegin("ntp_sync");
+      setAppState(CONNECTED_SYNCING);
+      syncEndMs = elapsedMs + NTP_SYNC_MS;
+    }
+    else if (syncEndMs != 0 && elapsedMs >= syncEndMs) {
+      hostSetTask("NtpTask", 0);
+      setAppState(CONNECTED_SYNCED);
+      taskTraceEnd("ntp_sync");
+      syncEndMs = 0;
+    }
+
+    if (elapsedMs == ROTATION_AT_MS) {
+      hostSetTask("loopTask", 1);
+      taskTraceInstant("encoder_rotation", 1);
+      faceManagerOnRotation(1);
+    }
+
+    if (elapsedMs == SCREENSHOT_AT_MS) {
+      hostSetTask("WebServer", 0);
+      for (int s = 0; s < SHADOW_STRIP_COUNT; s++) {
+        displayCopyShadowStrip(s, strip);
+      }
+    }
+
+    runLoop(scheduler);
+  }
+
+  std::string json;
+  taskTraceWrite(appendString, &json);
+  std::string path = buildDir + "/tasks.json";
+  FILE* out = fopen(path.c_str(), "wb");
+  if (out == NULL) {
+    perror(path.c_str());
+    return 1;
+  }
+  fwrite(json.data(), 1, json.size(), out);
+  fclose(out);
+
+  // One element per line, as taskTraceWrite() writes them.
+  std::map<int, std::vector<std::pair<std::string, long long>>> open;
+  std::map<int, long long> lastTs;
+  std::map<int, std::string> threadNames;
+  std::map<std::string, SpanStats> spans;
+  std::map<std::string, int> instants;
+  int events = 0;
+  int errors = 0;
+  size_t start = 0;
+  while (start < json.size()) {
+    size_t end = json.find('\n', start);
+    std::string line = json.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    start = end == std::string::npos ? json.size() : end + 1;
+
+    char name[64];
+    char phase;
+    if (sscanf(line.c_str(), ",{\"name\":\"%63[^\"]\",\"ph\":\"%c\"", name, &phase) != 2 &&
+        sscanf(line.c_str(), "{\"name\":\"%63[^\"]\",\"ph\":\"%c\"", name, &phase) != 2) {
+      continue;
+    }
+    int tid = -1;
+    long long ts = 0;
+    const char* tidText = strstr(line.c_str(), "\"tid\":");
+    const char* tsText = strstr(line.c_str(), "\"ts\":");
+    if (tidText != NULL) {
+      tid = atoi(tidText + 6);
+    }
+    if (tsText != NULL) {
+      ts = atoll(tsText + 5);
+    }
+
+    if (phase == 'M') {
+      const char* threadName = strstr(line.c_str(), "\"args\":{\"name\":\"");
+      if (strcmp(name, "thread_name") == 0 && threadName != NULL) {
+        threadName += 16;
+        threadNames[tid] = std::string(threadName, strcspn(threadName, "\""));
+      }
+      continue;
+    }
+
+    events++;
+    if (threadNames.count(tid) == 0) {
+      fprintf(stderr, "event %s on unnamed task %d\n", name, tid);
+      errors++;
+    }
+    if (lastTs.count(tid) != 0 && ts < lastTs[tid]) {
+      fprintf(stderr, "time runs backwards on %s at %s\n", threadNames[tid].c_str(), name);
+      errors++;
+    }
+    lastTs[tid] = ts;
+
+    if (phase == 'B') {
+      open[tid].push_back(std::make_pair(std::string(name), ts));
+    }
+    else if (phase == 'E') {
+      if (open[tid].empty() || open[tid].back().first != name) {
+        fprintf(stderr, "end of %s without its begin on %s\n", name, threadNames[tid].c_str());
+        errors++;
+        continue;
+      }
+      SpanStats& stats = spans[name];
+      stats.count++;
+      long long us = ts - open[tid].back().second;
+      stats.maxUs = us > stats.maxUs ? us : stats.maxUs;
+      open[tid].pop_back();
+    }
+    else {
+      instants[name]++;
+    }
+  }
+  for (const auto& entry : open) {
+    for (const auto& span : entry.second) {
+      fprintf(stderr, "%s left open on %s\n", span.first.c_str(), threadNames[entry.first].c_str());
+      errors++;
+    }
+  }
+
+  printf("%d events on %zu tasks written to %s\n\n", events, threadNames.size(), path.c_str());
+  printf("%-20s %6s %10s\n", "span", "count", "max_us");
+  for (const auto& entry : spans) {
+    printf("%-20s %6d %10lld\n", entry.first.c_str(), entry.second.count, entry.second.maxUs);
+  }
+  printf("\n%-20s %6s\n", "instant", "count");
+  for (const auto& entry : instants) {
+    printf("%-20s %6d\n", entry.first.c_str(), entry.second);
+  }
+
+  if (errors > 0 || threadNames.size() != 3) {
+    fprintf(stderr, "Task trace check failed\n");
+    return 1;
+  }
+  return 0;
+}
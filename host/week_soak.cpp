@@ -0,0 +1,215 @@
+// Runs the clock for a simulated week on the fixed clock source, in steps of
+// the render loop's poll interval: the frame scheduler and redrawDisplay(),
+// the NTP task's sync schedule and the face manager's grace period, all on
+// the time clock_source.cpp hands out.
+//
+// Fails when a wall-clock second is drawn twice or skipped, when NTP syncs
+// come further apart than NTP_SYNC_INTERVAL_MS plus one task check, when a
+// grace period does not revert on time, or when a rotation is not on screen
+// by the end of the step it happened in. Prints the most expensive frames
+// outside face switches with their local time, one per distinct cost, which
+// is where the rollovers (midnight, DST, New Year) show up.
+//
+// Usage: week_soak [--start YYYY-MM-DD] [--days n] [--face id]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "app_state.h"
+#include "clock_face_factory.h"
+#include "clock_source.h"
+#include "config.h"
+#include "display.h"
+#include "face_manager.h"
+#include "frame_scheduler.h"
+#include "input_latency.h"
+#include "timing_constants.h"
+
+// Europe/Budapest, the timezone the clock ships with.
+static const char* SOAK_TZ = "CET-1CEST,M3.5.0,M10.5.0/3";
+
+static const uint32_t STEP_MS = 50;
+static const unsigned long ROTATION_INTERVAL_MS = 2UL * 60UL * 60UL * 1000UL;
+static const size_t TOP_FRAMES = 8;
+
+struct FrameCost {
+  int64_t wallUs;
+  uint64_t spiBytes;
+  uint64_t pixels;
+};
+
+static std::string localTime(int64_t wallUs) {
+  time_t seconds = (time_t)(wallUs / 1000000LL);
+  tm timeinfo;
+  localtime_r(&seconds, &timeinfo);
+  char buf[32];
+  strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S %Z", &timeinfo);
+  return buf;
+}
+
+int main(int argc, char** argv) {
+  // Saturday before the spring DST change, so a week covers it.
+  int year = 2026;
+  int month = 3;
+  int day = 28;
+  int days = 7;
+  const char* faceId = "classic";
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--start") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%d-%d-%d", &year, &month, &day) == 3) {
+      i++;
+    }
+    else if (strcmp(argv[i], "--days") == 0 && i + 1 < argc) {
+      days = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--face") == 0 && i + 1 < argc) {
+      faceId = argv[++i];
+    }
+    else {
+      fprintf(stderr, "Usage: %s [--start YYYY-MM-DD] [--days n] [--face id]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  setenv("TZ", SOAK_TZ, 1);
+  tzset();
+  tm start = {};
+  start.tm_year = year - 1900;
+  start.tm_mon = month - 1;
+  start.tm_mday = day;
+  start.tm_isdst = -1;
+  int64_t startWallUs = (int64_t)mktime(&start) * 1000000LL;
+
+  displaySetup();
+  clockSourceSetFixed(startWallUs);
+  saveDefaultFaceId(faceId);
+  setConfiguredClockFace();
+  setAppState(CONNECTED_SYNCED);
+
+  FrameScheduler scheduler;
+  frameSchedulerInit(scheduler);
+  unsigned long lastNtpCheckMs = clockSourceMillis();
+  unsigned long lastSyncMs = 0;
+  unsigned long worstSyncGapMs = 0;
+  int syncs = 0;
+  unsigned long lastRotationMs = clockSourceMillis();
+  unsigned long graceStartMs = 0;
+  int rotations = 0;
+  int lateReverts = 0;
+  int lateInputs = 0;
+  int64_t lastSecond = -1;
+  int skipped = 0;
+  int repeated = 0;
+  uint64_t frames = 0;
+  bool switching = true;
+  std::vector<FrameCost> costliest;
+
+  const uint64_t steps = (uint64_t)days * 24 * 60 * 60 * 1000 / STEP_MS;
+  for (uint64_t step = 0; step < steps; step++) {
+    if (inputLatencyAwaitingFrame()) {
+      lateInputs++;
+    }
+    // esp_timer, which stamps the inputs, runs along with the clock source.
+    hostAdvanceMillis(STEP_MS);
+    clockSourceAdvanceMs(STEP_MS);
+    unsigned long nowMs = clockSourceMillis();
+    int64_t wallUs = getDisplayWallClockUs();
+
+    // NTP task.
+    if (nowMs - lastNtpCheckMs >= NTP_TASK_CHECK_INTERVAL_MS) {
+      lastNtpCheckMs = nowMs;
+      if (isNtpSyncDue()) {
+        if (syncs > 0) {
+          worstSyncGapMs = std::max(worstSyncGapMs, nowMs - lastSyncMs);
+        }
+        updateLastNtpSync();
+        lastSyncMs = nowMs;
+        syncs++;
+      }
+    }
+
+    // Someone turns the encoder every couple of hours and walks away.
+    if (nowMs - lastRotationMs >= ROTATION_INTERVAL_MS) {
+      lastRotationMs = nowMs;
+      inputLatencyBegin(INPUT_ROTATION, inputLatencyNowUs());
+      faceManagerOnRotation(1);
+      graceStartMs = nowMs;
+      rotations++;
+      switching = true;
+    }
+    faceManagerUpdate();
+    if (graceStartMs != 0 && !faceManagerIsGracePeriodActive()) {
+      if (nowMs - graceStartMs > FACE_GRACE_PERIOD_MS + STEP_MS) {
+        lateReverts++;
+      }
+      graceStartMs = 0;
+    }
+
+    if (inputLatencyAwaitingFrame()) {
+      frameSchedulerRequest(scheduler);
+    }
+    FrameReason reason = frameSchedulerPoll(scheduler, nowMs, wallUs);
+    if (reason == FRAME_NONE && !consumeAppStateChange()) {
+      continue;
+    }
+    TFT_display.resetStats();
+    redrawDisplay();
+    frames++;
+
+    if (reason == FRAME_SECOND) {
+      int64_t second = wallUs / 1000000LL;
+      if (lastSecond >= 0 && second > lastSecond + 1) {
+        skipped += (int)(second - lastSecond - 1);
+      }
+      else if (second == lastSecond) {
+        repeated++;
+      }
+      lastSecond = second;
+    }
+
+    // Face switches repaint everything and would fill the list.
+    if (switching || faceManagerIsGracePeriodActive()) {
+      switching = faceManagerIsGracePeriodActive();
+      continue;
+    }
+    // One entry per cost, the first frame that had it, so the list shows
+    // different kinds of frames instead of every minute's hand move.
+    const TftStats& stats = TFT_display.stats();
+    FrameCost cost = { wallUs, stats.spiBytes, stats.pixels };
+    if (std::any_of(costliest.begin(), costliest.end(), [&](const FrameCost& c) { return c.spiBytes == cost.spiBytes; })) {
+      continue;
+    }
+    costliest.push_back(cost);
+    std::stable_sort(costliest.begin(), costliest.end(), [](const FrameCost& a, const FrameCost& b) {
+      return a.spiBytes > b.spiBytes;
+    });
+    if (costliest.size() > TOP_FRAMES) {
+      costliest.pop_back();
+    }
+  }
+
+  uint64_t simulatedMs = steps * STEP_MS;
+  int expectedSyncs = 1 + (int)(simulatedMs / (NTP_SYNC_INTERVAL_MS + NTP_TASK_CHECK_INTERVAL_MS));
+  printf("%d days of %s from %s, %llu frames\n", days, faceId, localTime(startWallUs).c_str(), (unsigned long long)frames);
+  printf("seconds skipped %d, drawn twice %d\n", skipped, repeated);
+  printf("NTP syncs %d (at least %d), longest gap %lus\n", syncs, expectedSyncs, worstSyncGapMs / 1000);
+  printf("grace periods %d, reverted late %d, shown late %d\n", rotations, lateReverts, lateInputs);
+  printf("\n%-28s %10s %10s\n", "costliest frames", "pixels", "spi_bytes");
+  for (const FrameCost& cost : costliest) {
+    printf("%-28s %10llu %10llu\n", localTime(cost.wallUs).c_str(), (unsigned long long)cost.pixels, (unsigned long long)cost.spiBytes);
+  }
+
+  bool ok = skipped == 0 && repeated == 0 && lateReverts == 0 && lateInputs == 0 && syncs >= expectedSyncs &&
+    worstSyncGapMs <= NTP_SYNC_INTERVAL_MS + NTP_TASK_CHECK_INTERVAL_MS;
+  if (!ok) {
+    fprintf(stderr, "Soak run failed\n");
+    return 1;
+  }
+  printf("Soak run passed\n");
+  return 0;
+}